@@ -17,12 +17,20 @@
 /* Maximum disk size we can handle (3GB) */
 #define DISKSIZE	0xC0000000
 
+/* Disks: 0 = primary channel master (boot disk), 1 = secondary channel master */
+#define IDE_MAX_DISKS	2
+
 /* ide.c */
 //bool	ide_probe_disk1(void);
 //void	ide_set_disk(int diskno);
 void ide_init();
+bool ide_probe_disk(int disk);
 int	ide_read(uint32 secno, void *dst, uint32 nsecs);
 int	ide_write(uint32 secno, const void *src, uint32 nsecs);
+int	ide_start(int disk, uint32 secno, uint32 nsecs, bool write);
+int	ide_read_sector(int disk, void *dst);
+int	ide_write_sector(int disk, const void *src);
+int	ide_flush(int disk);
 
 #define DISK_INT_BLK_METHOD LCK_SLEEP 	//Specify the method of handling the block/release on DISK
 struct Channel DISKchannel;				//channel of waiting for DISK
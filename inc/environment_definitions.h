@@ -72,6 +72,31 @@ struct WorkingSetElement {
 LIST_HEAD(WS_List, WorkingSetElement);		// Declares 'struct WS_list'
 //======================================================================
 
+//Scheduler statistics (see sched_stats.c & sys_get_sched_stats()). The times are in K cycles (rdtsc >> 10).
+//The wake-to-run latencies (from getting ready after blocking, or being created, till running) are counted
+//in a histogram of SCHED_LAT_BUCKETS powers of 4: bucket b counts [4^b, 4^(b+1)) K cycles, the last one the rest
+#define SCHED_LAT_BUCKETS 12
+struct EnvSchedStats
+{
+	uint32 readyTime;				//waiting in a ready queue
+	uint32 runTime;					//running on a CPU
+	uint32 blockedTime;				//blocked (sleeping on a channel, a timer or the next real-time period)
+	uint32 dispatches;				//# of times it's run
+	uint32 wakeups;					//# of times it got ready after blocking
+	uint32 maxWakeLatency;
+	uint32 wakeLatencyHist[SCHED_LAT_BUCKETS];
+};
+struct SchedStats
+{
+	uint32 switches;				//# of envs dispatched by all the CPUs
+	uint32 timedSwitches;			//# of them right after another env left the CPU (timed below)
+	uint32 switchCost;				//sum of the times from an env leaving the CPU till the next one is dispatched
+	uint32 maxSwitchCost;
+	uint32 wakeups;
+	uint32 wakeLatencyHist[SCHED_LAT_BUCKETS];	//of all the envs
+};
+//======================================================================
+
 //2024 (ref: xv6 OS - x86 version)
 // Saved registers for kernel context switches.
 // Don't need to save all the segment registers (%cs, etc),
@@ -105,8 +130,13 @@ struct Env {
 	int32 env_parent_id;			// env_id of this env's parent
 	unsigned env_status;			// Status of the environment
 	int priority;					// Current priority
+	uint32 enqueueTime;				// Ticks when it was inserted in its ready queue
+	int cpu;						// CPU whose ready queues hold it (the last one it ran on)
 	char prog_name[PROGNAMELEN];	// Program name (to print it via USER.cprintf in multitasking)
 	void* channel;					// Address of the channel that it's blocked (sleep) on it
+	uint32 wakeupTime;				// ms of the timer wheel to wake it up at (while it's in sys_sleep())
+	uint32 futexKey;				// Physical address of the futex word that it's blocked on (see futex_wait())
+	uint8 killed;					// It's killed while running on another CPU: it exits on leaving the kernel (see sched_kill_env())
 
 	//================
 	/*ADDRESS SPACE*/
@@ -123,6 +153,7 @@ struct Env {
 	uint32 * da_Start;
 	uint32 * brk;
 	uint32 * rlimit;
+	struct ShareMapping* shareMappings;	//ranges of the user heap where shared objects are attached (kernel only)
 
 	//=======================================================================
 	//for page file management
@@ -169,6 +200,27 @@ struct Env {
 	//==================
 	/*CPU BSD Sched...*/
 	//==================
+	int nice;						//[-20, 20]: the higher, the less CPU share
+	fixed_point_t recent_cpu;		//decayed ticks of CPU it received recently
+
+	//=====================
+	/*CPU Stride Sched...*/
+	//=====================
+	uint32 tickets;					//its CPU share is proportional to its tickets (inherited by its children)
+	uint32 stride;					//STRIDE1 / tickets: its pass advances by this on each quantum it runs
+	uint32 pass;					//virtual time of its next quantum: the min pass is run first
+	int strideIndex;				//its index in the stride heap of its CPU (-1 if it's not there)
+
+	//=====================
+	/*REAL-TIME (EDF)...*/
+	//=====================
+	uint32 rtPeriod;				//ms between the releases of its jobs (0: best-effort env)
+	uint32 rtBudget;				//ms of CPU time of each job
+	uint32 rtDeadline;				//end of the period of its current job (ms of the timer wheel)
+	int32 rtRemaining;				//ms of the budget of its current job still to run
+	uint8 rtThrottled;				//its budget is exhausted before its job is done
+	uint32 rtJobs;					//# of jobs released
+	uint32 rtMisses;				//# of jobs not done by their deadlines
 
 	//================
 	/*STATISTICS...*/
@@ -183,6 +235,10 @@ struct Env {
 	//2020
 	uint32 nPageIn, nPageOut, nNewPageAdded;
 	uint32 nClocks ;
+	struct EnvSchedStats schedStats;
+	uint64 statStamp;				//rdtsc when it last got ready, ran or left its CPU (0: never)
+	uint8 statBlocked;				//it left its CPU blocked (its time till it gets ready is blocked time)
+	uint8 statWoken;				//it got ready after blocking (or it's new): its wait is a wake-to-run latency
 
 
 	//================
@@ -16,6 +16,7 @@
 #include <inc/x86.h>
 #include <inc/environment_definitions.h>
 #include <inc/semaphore.h>
+#include <inc/ring.h>
 #include <inc/memlayout.h>
 #include <inc/syscall.h>
 #include <inc/uheap.h>
@@ -94,6 +95,7 @@ int 	sys_createSharedObject(char* shareName, uint32 size, uint8 isWritable, void
 int 	sys_getSizeOfSharedObject(int32 ownerID, char* shareName);
 int 	sys_getSharedObject(int32 ownerID, char* shareName, void* virtual_address );
 int 	sys_freeSharedObject(int32 sharedObjectID, void *startVA);
+void*	sys_attach_shared(int32 ownerID, char* shareName, uint32* size);
 
 //etc...
 uint32	sys_rcr2();
@@ -111,12 +113,15 @@ int 	sys_check_LRU_lists_free(uint32* list_content, int list_size);
 int 	sys_check_WS_list(uint32* WS_list_content, int actual_WS_list_size, uint32 last_WS_element_content, bool chk_in_order);
 //2024
 void 	sys_utilities(char* utilityName, int value);
-void sys_enqueue(struct Env_Queue* queue, struct Env* env);
-struct Env* sys_dequeue(struct Env_Queue* queue);
-void sys_init_queue(struct Env_Queue* queue);
-struct Env* sys_get_cpu_proc();
-void sys_sched_insert_ready(struct Env* env);
 void sys_env_set_priority(int32 envId,int priority);
+void sys_sleep(uint32 milliSeconds);
+int sys_rt_set_params(uint32 periodInMS, uint32 budgetInMS);
+void sys_rt_wait_period();
+int sys_get_sched_stats(int32 envId, struct SchedStats* stats, struct EnvSchedStats* envStats);
+int sys_futex_wait(volatile uint32* addr, uint32 expected);
+int sys_futex_wake(volatile uint32* addr, int n);
+int sys_futex_wake_yield(volatile uint32* addr);
+int sys_ring_doorbell(volatile uint32* bell, int n);
 
 
 
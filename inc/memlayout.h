@@ -28,7 +28,7 @@
  * Virtual memory map:                                Permissions
  *                                                    kernel/user
  *    4 GB --------->  +------------------------------+
- * 					   |      Invalid Memory (*)	  |  PAGE_SIZE
+ * 					   |   Local APIC registers (*)	  | RW/--  PAGE_SIZE
  * KERNEL_HEAP_MAX ->  +------------------------------+
  *                     |     Kernel Heap (KHEAP)      | RW/--
  *                     :              .               :
@@ -112,7 +112,8 @@
 #define KERN_STACK_TOP		VPT							//scheduler kernel stacks (one per CPU)
 #define KERNEL_STACK_SIZE	(8*PAGE_SIZE)   			// size of a kernel stack (either for cpu scheduler stack or user kernel stack)
 #define USER_LIMIT			(KERN_STACK_TOP - PTSIZE)
-#define NCPUS 1
+#define NCPUS 4							//max number of CPUs (the ones found in the MP tables are used)
+#define MPENTRY_PADDR		0x7000						//the APs start executing the trampoline (kern/cpu/mpentry.S) here
 
 /*
  * User read-only mappings! Anything below here til USER_TOP are readonly to user.
@@ -155,6 +156,8 @@
 //2016
 #define KERNEL_HEAP_START 0xF6000000
 #define KERNEL_HEAP_MAX 0xFFFFF000
+//the memory-mapped registers of the local APIC of each CPU (uncached) are at the last page
+#define LAPIC_VA KERNEL_HEAP_MAX
 //KHEAP pages number
 #define NUM_OF_KHEAP_PAGES ((KERNEL_HEAP_MAX-KERNEL_HEAP_START)/PAGE_SIZE)
 
@@ -217,6 +220,15 @@ struct FrameInfo {
 	uint32 bufferedVA;
 	unsigned char isBuffered;
 	uint32 va;
+
+	// Swap cache link: for a free RAM frame, the page file frame whose
+	// identical contents it still holds; for a page file frame, the free
+	// RAM frame that still holds its contents. NULL if there is none.
+	struct FrameInfo *swapLink;
+
+	// Reverse map of a frame of a shared object: every (env, VA) mapping
+	// it, so it can be unmapped from all of them on its eviction.
+	struct RmapEntry *rmap;
 };
 
 #endif /* !__ASSEMBLER__ */
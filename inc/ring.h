@@ -0,0 +1,60 @@
+// user-level ring buffers (message queues) over shared memory
+#ifndef FOS_INC_RING_H
+#define FOS_INC_RING_H
+
+#include <inc/types.h>
+
+#define RING_CACHE_LINE 64
+
+//Kinds of ring
+#define RING_SPSC	0		//a single producer & a single consumer: plain loads & stores
+#define RING_MPMC	1		//any # of producers & consumers: each slot has a sequence # (bounded MPMC
+							//queue of D. Vyukov), the slots are claimed by cmpxchg
+
+//An env blocks on a doorbell while the ring is empty (consumers) or full (producers): it announces
+//itself in sleepers, re-checks the ring, then waits on the bell word (sys_futex_wait()). The other
+//side rings it (sys_ring_doorbell(): the kernel bumps the word & wakes up a sleeper) only if there's
+//a sleeper & the ring has just gone from empty to non-empty (or from full to non-full; MPMC: whenever
+//there's a sleeper), so the messages pass without any syscall while both sides keep up
+struct __ringbell
+{
+	volatile uint32 bell;
+	volatile uint32 sleepers;
+} __attribute__((aligned(RING_CACHE_LINE)));
+
+//The ring is a single shared object: this header, followed by its slots. The head & the tail are
+//free running counters (the slot of a counter is its value modulo the # of slots), each one in its
+//own cache line so the producers & the consumers don't bounce the same line
+struct __ringdata
+{
+	uint32 numOfSlots;				//a power of 2
+	uint32 msgSize;					//bytes of each message
+	uint32 slotSize;				//bytes of each slot (its sequence # in MPMC, then the message)
+	uint8 kind;
+
+	// For debugging: Name of the ring.
+	char name[64];
+
+	volatile uint32 tail __attribute__((aligned(RING_CACHE_LINE)));		//next slot to write
+	volatile uint32 head __attribute__((aligned(RING_CACHE_LINE)));		//next slot to read
+	struct __ringbell notEmpty;		//blocked consumers
+	struct __ringbell notFull;		//blocked producers
+
+	uint8 slots[] __attribute__((aligned(RING_CACHE_LINE)));
+};
+
+struct ring
+{
+	struct __ringdata* ringdata;	//NULL if it's not created/found
+};
+
+struct ring create_ring(char *ringName, uint32 numOfSlots, uint32 msgSize, uint8 kind);
+struct ring get_ring(int32 ownerEnvID, char* ringName);
+
+int ring_try_push(struct ring r, const void* msg);
+int ring_try_pop(struct ring r, void* msg);
+void ring_push(struct ring r, const void* msg);
+void ring_pop(struct ring r, void* msg);
+uint32 ring_count(struct ring r);
+
+#endif /*FOS_INC_RING_H*/
@@ -4,16 +4,19 @@
 
 #include <inc/environment_definitions.h>
 
+//The semaphore is a futex word in shared memory: wait & signal take/give a unit of its count by
+//atomic instructions in user space, & enter the kernel only to block while the count is 0
+//(sys_futex_wait()) or to wake up a blocked env (sys_futex_wake())
 struct __semdata
 {
-	//queue of all blocked envs on this Semaphore
-	struct Env_Queue queue;
+	//semaphore value (never negative): the futex word
+	volatile uint32 count;
 
-	//semaphore value
-	int count;
+	//# of envs blocked (or about to block) on it: signal enters the kernel only if there's any
+	volatile uint32 waiters;
 
-	//lock variable protecting this count
-	uint32 lock;
+	//signal hands the CPU straight to the woken env (directed yield)
+	uint8 directedYield;
 
 	// For debugging: Name of semaphore.
 	char name[64];
@@ -28,5 +31,6 @@ struct semaphore get_semaphore(int32 ownerEnvID, char* semaphoreName);
 void wait_semaphore(struct semaphore sem);
 void signal_semaphore(struct semaphore sem);
 int semaphore_count(struct semaphore sem);
+void semaphore_set_directed_yield(struct semaphore sem, uint8 enabled);
 
 #endif /*FOS_INC_SEMAPHORE_H*/
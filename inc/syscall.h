@@ -54,12 +54,15 @@ enum
 	SYS_is_user_page_taken,
 	SYS_is_user_page_first,
 	SYS_user_get_free_pages,
-	SYS_init_queue,
-	SYS_enqueue,
-	SYS_dequeue,
-	SYS_get_current_proc,
-	SYS_insert_ready,
 	SYS_env_set_priority,
+	SYS_sleep,
+	SYS_rt_set_params,
+	SYS_rt_wait_period,
+	SYS_get_sched_stats,
+	SYS_futex_wait,
+	SYS_futex_wake,
+	SYS_attach_shared,
+	SYS_ring_doorbell,
 
 	//=====================================================================
 	NSYSCALLS
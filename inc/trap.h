@@ -28,6 +28,9 @@
 // These are arbitrarily chosen, but with care not to overlap
 // processor defined exceptions or interrupt vectors.
 #define T_SYSCALL   48		// system call
+#define T_IPI_TLB   50		// IPI: invalidate a TLB entry (see tlb_shootdown())
+#define T_IPI_RESCHED 51	// IPI: wake up an idle CPU to run a ready env
+#define T_LAPIC_SPURIOUS 63	// spurious interrupt of the local APIC
 #define T_DEFAULT   500		// catchall
 
 #ifndef __ASSEMBLER__
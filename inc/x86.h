@@ -29,7 +29,11 @@ static __inline void lcr2(uint32 val) __attribute__((always_inline));
 //2024
 static __inline void cli() __attribute__((always_inline));
 static __inline void sti() __attribute__((always_inline));
+static __inline void sti_hlt() __attribute__((always_inline));
+static __inline void pause() __attribute__((always_inline));
 static __inline uint32 xchg(volatile uint32 *addr, uint32 newval) __attribute__((always_inline));
+static __inline uint32 cmpxchg(volatile uint32 *addr, uint32 expected, uint32 newval) __attribute__((always_inline));
+static __inline uint32 xadd(volatile uint32 *addr, uint32 inc) __attribute__((always_inline));
 static __inline void lgdt(struct Segdesc *p, int size) __attribute__((always_inline));
 static __inline void lidt(struct Gatedesc *p, int size) __attribute__((always_inline));
 //****************
@@ -48,6 +52,7 @@ static __inline void write_esp(uint32 esp) __attribute__((always_inline));
 static __inline void write_ebp(uint32 ebp) __attribute__((always_inline));
 static __inline void cpuid(uint32 info, uint32 *eaxp, uint32 *ebxp, uint32 *ecxp, uint32 *edxp);
 static __inline uint64 read_tsc(void) __attribute__((always_inline));
+static __inline uint32 bsf(uint32 val) __attribute__((always_inline));
 
 static __inline void
 breakpoint(void)
@@ -310,6 +315,15 @@ read_tsc(void)
         return tsc;
 }
 
+//index of the least significant set bit (val must not be zero)
+static __inline uint32
+bsf(uint32 val)
+{
+        uint32 idx;
+        __asm __volatile("bsfl %1,%0" : "=r" (idx) : "rm" (val));
+        return idx;
+}
+
 /*2024: newly added functions from xv6-x86 code el7 :)
  * https://github.com/mit-pdos/xv6-public
  */
@@ -327,6 +341,20 @@ sti(void)
 	__asm __volatile("sti");
 }
 
+//set interrupt flag & halt till the next interrupt (no interrupt can be missed in between)
+static __inline void
+sti_hlt(void)
+{
+	__asm __volatile("sti; hlt" : : : "memory");
+}
+
+//spin-wait loop hint
+static __inline void
+pause(void)
+{
+	__asm __volatile("pause" : : : "memory");
+}
+
 //atomic xchange
 //Example: xchg(&(globalIntVar), 1);
 static __inline uint32
@@ -342,6 +370,30 @@ xchg(volatile uint32 *addr, uint32 newval)
   return result;
 }
 
+//atomic compare & exchange: set *addr to newval if it's expected. Returns its old value
+//(it's set iff the returned value is expected)
+static __inline uint32
+cmpxchg(volatile uint32 *addr, uint32 expected, uint32 newval)
+{
+  uint32 result;
+  __asm __volatile("lock; cmpxchgl %2, %1" :
+               "=a" (result), "+m" (*addr) :
+               "r" (newval), "0" (expected) :
+               "cc", "memory");
+  return result;
+}
+
+//atomic fetch & add: add inc to *addr. Returns its old value
+static __inline uint32
+xadd(volatile uint32 *addr, uint32 inc)
+{
+  __asm __volatile("lock; xaddl %0, %1" :
+               "+r" (inc), "+m" (*addr) :
+               :
+               "cc", "memory");
+  return inc;
+}
+
 //load GDT register
 static __inline void
 lgdt(struct Segdesc *p, int size)
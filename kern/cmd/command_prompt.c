@@ -301,6 +301,16 @@ int m;
 char *p ;
 void get_into_prompt()
 {
+	//Only the boot CPU runs the command prompt. An AP gets here only on a kernel panic: halt it
+	if (mycpu() != &CPUS[0])
+	{
+		cli();
+		mycpu()->scheduler_status = SCH_STOPPED;
+		mycpu()->proc = NULL;
+		while (1)
+			asm volatile("hlt");
+	}
+
 	while (1)
 	{
 		//disable interrupt if it's already enabled
@@ -13,9 +13,18 @@
 #include <kern/proc/user_environment.h>
 #include <kern/proc/priority_manager.h>
 #include "../cpu/sched.h"
+#include "../cpu/kclock.h"
+#include "../cpu/timer_wheel.h"
+#include "../cpu/sched_edf.h"
+#include "../cpu/sched_stats.h"
+#include "../conc/futex.h"
 #include "../disk/pagefile_manager.h"
+#include "../disk/zswap.h"
+#include "../disk/io_scheduler.h"
+#include "../disk/block_device.h"
 #include "../mem/kheap.h"
 #include "../mem/memory_manager.h"
+#include "../mem/shared_memory_manager.h"
 #include "../tests/tst_handler.h"
 #include "../tests/utilities.h"
 
@@ -54,6 +63,15 @@ struct Command commands[] =
 		{"modbuff", "enable modified buffer", command_enable_modified_buffer, 0},
 		{"modbufflength?", "get modified buffer length", command_get_modified_buffer_length, 0},
 		{"tkrealloc", "test krealloc function",command_tst_krealloc,0},
+		{"nozswap", "write back the compressed swap pool and disable it", command_disable_zswap, 0},
+		{"iostat", "display the block device and disk request queue stats (transfers, depth, merges & latency)", command_io_stats, 0},
+		{"bsdstat", "display the load average of the BSD scheduler and the nice, recent_cpu & priority of each env", command_bsd_stats, 0},
+		{"tickstat", "display the tickless clock stats (stretched quantums, clock interrupts avoided & idle halts) and the timer wheel stats", command_tickless_stats, 0},
+		{"edfstat", "display the utilization of the real-time (EDF) class and the period, budget, jobs & deadline misses of each of its envs", command_edf_stats, 0},
+		{"schedstat", "display the context switches (# & cost), the wake-to-run latency histogram and the ready, running & blocked times of each env", command_sched_stats, 0},
+		{"futexstat", "display the futex stats (blocked envs, waits returned on a changed word, wakeups & doorbells)", command_futex_stats, 0},
+		{"lockstat", "display the lock contention profile: acquisitions, contended ones, spin & hold times of each lock class with its top call sites", command_lock_stats, 0},
+		{"stridestat", "display the tickets, stride & pass of each env and its share of the CPU against the share of its tickets", command_stride_stats, 0},
 
 		//*****************************//
 		/* COMMANDS WITH ONE ARGUMENT */
@@ -61,11 +79,16 @@ struct Command commands[] =
 		{ "kill", "kill the given environment (by its ID) from the system", command_kill_program, 1},
 		{ "rm", "reads one byte from specific physical location" ,command_readmem_k, 1},
 		{ "schedRR", "switch the scheduler to RR with given quantum", command_sch_RR, 1},
+		{ "schedSTRIDE", "switch the scheduler to STRIDE (proportional-share by tickets) with given quantum", command_sch_STRIDE, 1},
 		{"schedTest", "Used for turning on/off the scheduler test", command_sch_test, 1},
 		{"lru", "set replacement algorithm to LRU", command_set_page_rep_LRU, 1},
 
 		{"modbufflength", "set the length of the modified buffer", command_set_modified_buffer_length, 1},
 		{ "setStarvThr", "set the the starvation threshold of priority scheduler", command_set_starve_thresh, 1},
+		{"zswap", "enable the compressed swap pool with the given # pages (0 = default)", command_enable_zswap, 1},
+		{"tickless", "turn on/off the tickless clock (1/0)", command_set_tickless, 1},
+		{"lockprof", "turn on (resetting the counters) / off the lock contention profiler (1/0)", command_set_lock_profiler, 1},
+		{"pfdev", "put the page file on the given block device backend (ide/ram), while it's empty", command_set_page_file_device, 1},
 
 		//******************************//
 		/* COMMANDS WITH TWO ARGUMENTS */
@@ -73,6 +96,7 @@ struct Command commands[] =
 		{ "wm", "writes one byte to specific physical location" ,command_writemem_k, 2},
 		{ "schedBSD", "switch the scheduler to BSD with given # queues & quantum", command_sch_BSD, 2},
 		{ "setPri", "set the priority of the given environment (by its ID)", command_set_priority, 2},
+		{ "tickets", "set the stride tickets of the given environment (by its ID)", command_set_tickets, 2},
 		{"nclock", "set replacement algorithm to Nth chance CLOCK (type=1: NORMAL Ver. type=2: MODIFIED Ver.", command_set_page_rep_nthCLOCK, 2},
 
 		//********************************//
@@ -354,6 +378,9 @@ int command_meminfo(int number_of_arguments, char **arguments)
 			counters.freeBuffered+ counters.freeNotBuffered+ counters.modified, counters.freeBuffered, counters.freeNotBuffered, counters.modified);
 
 	cprintf("Num of calls for kheap_virtual_address [in last run] = %d\n", numOfKheapVACalls);
+	pf_swap_cache_print_stats();
+	zswap_print_stats();
+	sharing_print_stats();
 
 	return 0;
 }
@@ -756,6 +783,14 @@ int command_sch_PRIRR(int number_of_arguments, char **arguments)
 	cprintf("\n");
 	return 0;
 }
+int command_sch_STRIDE(int number_of_arguments, char **arguments)
+{
+	uint8 quantum = strtol(arguments[1], NULL, 10);
+
+	sched_init_STRIDE(quantum);
+	cprintf("Scheduler is now set to STRIDE with quantum %d ms\n", quantums[0]);
+	return 0;
+}
 int command_set_starve_thresh(int number_of_arguments, char **arguments)
 {
 	uint32 starvationThresh = strtol(arguments[1], NULL, 10);
@@ -771,6 +806,21 @@ int command_set_priority(int number_of_arguments, char **arguments)
 
 	return 0;
 }
+int command_set_tickets(int number_of_arguments, char **arguments)
+{
+	int32 envId = strtol(arguments[1],NULL, 10);
+	int32 tickets = strtol(arguments[2],NULL, 10);
+
+	struct Env* e ;
+	if (envid2env(envId, &e, 0) < 0 || e == NULL)
+	{
+		cprintf("no environment with ID %d\n", envId);
+		return 0;
+	}
+	env_set_tickets(e, tickets);
+	cprintf("[%d] %s: tickets = %d, stride = %d\n", e->env_id, e->prog_name, e->tickets, e->stride);
+	return 0;
+}
 int command_print_sch_method(int number_of_arguments, char **arguments)
 {
 	if (isSchedMethodMLFQ())
@@ -794,6 +844,10 @@ int command_print_sch_method(int number_of_arguments, char **arguments)
 	{
 		cprintf("Scheduler is now set to PRIORITY RR with %d priorities & quantum = %d\n", num_of_ready_queues, quantums[0]);
 	}
+	else if (isSchedMethodSTRIDE())
+	{
+		cprintf("Current scheduler method is STRIDE with quantum %d ms\n", quantums[0]);
+	}
 	else
 		cprintf("Current scheduler method is UNDEFINED\n");
 
@@ -1025,6 +1079,207 @@ int command_get_modified_buffer_length(int number_of_arguments, char **arguments
 	return 0;
 }
 
+int command_enable_zswap(int number_of_arguments, char **arguments)
+{
+	uint32 poolPages = strtol(arguments[1], NULL, 10);
+	if (zswap_enable(poolPages) != 0)
+	{
+		cprintf("zswap: no enough kernel heap space for the compressed pool\n");
+		return 0;
+	}
+	cprintf("Compressed swap is now ENABLED\n");
+	return 0;
+}
+
+int command_disable_zswap(int number_of_arguments, char **arguments)
+{
+	zswap_disable();
+	cprintf("Compressed swap is now DISABLED\n");
+	return 0;
+}
+
+int command_io_stats(int number_of_arguments, char **arguments)
+{
+	blk_print_stats();
+	io_print_stats();
+	return 0;
+}
+
+//print a value given in hundredths with 2 decimals
+static void print_hundredths(int val)
+{
+	if (val < 0)
+	{
+		cprintf("-");
+		val = -val;
+	}
+	cprintf("%d.%02d", val / 100, val % 100);
+}
+
+int command_bsd_stats(int number_of_arguments, char **arguments)
+{
+	if (!isSchedMethodBSD())
+	{
+		cprintf("The current scheduler is not BSD\n");
+		return 0;
+	}
+	cprintf("load average = ");
+	print_hundredths(get_load_average());
+	cprintf("\n");
+	for (int i = 0; i < NENV; i++)
+	{
+		struct Env* e = &envs[i];
+		if (e->env_status == ENV_FREE)
+			continue;
+		cprintf("[%d] %s: status = %d, nice = %d, priority = %d, recent_cpu = ", e->env_id, e->prog_name, e->env_status, env_get_nice(e), e->priority);
+		print_hundredths(env_get_recent_cpu(e));
+		cprintf("\n");
+	}
+	return 0;
+}
+
+int command_tickless_stats(int number_of_arguments, char **arguments)
+{
+	cprintf("tickless clock is %s\n", Tickless.enabled ? "ON" : "OFF");
+	cprintf("stretches = %d, clock interrupts avoided = %d, idle halts with the clock off = %d\n",
+			Tickless.stretches, Tickless.ticksAvoided, Tickless.idleHalts);
+	cprintf("timer wheel: sleeping envs = %d, sleeps = %d, wakeups = %d, cascades = %d\n",
+			TimerWheel.numOfSleepers, TimerWheel.sleeps, TimerWheel.wakeups, TimerWheel.cascades);
+	return 0;
+}
+
+int command_edf_stats(int number_of_arguments, char **arguments)
+{
+	cprintf("real-time envs = %d, utilization = %d/%d, rejected = %d, throttles = %d\n",
+			EDF.numOfEnvs, EDF.utilization, EDF_UTIL_SCALE, EDF.rejected, EDF.throttles);
+	for (int i = 0; i < NENV; i++)
+	{
+		struct Env* e = &envs[i];
+		if (e->env_status == ENV_FREE || e->rtPeriod == 0)
+			continue;
+		cprintf("[%d] %s: status = %d, period = %d ms, budget = %d ms, jobs = %d, misses = %d\n",
+				e->env_id, e->prog_name, e->env_status, e->rtPeriod, e->rtBudget, e->rtJobs, e->rtMisses);
+	}
+	return 0;
+}
+
+static void print_lat_hist(uint32* hist)
+{
+	for (int b = 0; b < SCHED_LAT_BUCKETS; b++)
+	{
+		if (hist[b] == 0)
+			continue;
+		if (b < SCHED_LAT_BUCKETS - 1)
+			cprintf(" [<%dK: %d]", 1 << (2 * (b + 1)), hist[b]);
+		else
+			cprintf(" [>=%dK: %d]", 1 << (2 * b), hist[b]);
+	}
+	cprintf("\n");
+}
+
+int command_sched_stats(int number_of_arguments, char **arguments)
+{
+	struct SchedStats stats = GlobalSchedStats;
+	cprintf("context switches = %d, cost (from an env leaving the CPU till the next one runs): avg = %d K cycles, max = %d K cycles (over %d)\n",
+			stats.switches, stats.timedSwitches ? stats.switchCost / stats.timedSwitches : 0, stats.maxSwitchCost, stats.timedSwitches);
+	cprintf("directed yields: handoffs = %d, misses = %d\n", DirectedYield.handoffs, DirectedYield.misses);
+	cprintf("wake-to-run latency (K cycles) of %d wakeups:", stats.wakeups);
+	print_lat_hist(stats.wakeLatencyHist);
+	for (int i = 0; i < NENV; i++)
+	{
+		struct Env* e = &envs[i];
+		if (e->env_status == ENV_FREE)
+			continue;
+		struct EnvSchedStats* s = &(e->schedStats);
+		cprintf("[%d] %s: status = %d, ready = %d, running = %d, blocked = %d (K cycles), dispatches = %d, wakeups = %d (max latency = %dK):",
+				e->env_id, e->prog_name, e->env_status, s->readyTime, s->runTime, s->blockedTime, s->dispatches, s->wakeups, s->maxWakeLatency);
+		print_lat_hist(s->wakeLatencyHist);
+	}
+	return 0;
+}
+
+int command_futex_stats(int number_of_arguments, char **arguments)
+{
+	cprintf("futexes: waits = %d, mismatches = %d, wakeups = %d, doorbells = %d\n", Futexes.waits, Futexes.mismatches, Futexes.wakeups, Futexes.doorbells);
+	return 0;
+}
+
+//The share of each env is its part of the clock ticks received by all the live envs, against its
+//part of all their tickets
+int command_stride_stats(int number_of_arguments, char **arguments)
+{
+	if (!isSchedMethodSTRIDE())
+		cprintf("The current scheduler is not STRIDE\n");
+	uint32 totalTickets = 0, totalClocks = 0;
+	for (int i = 0; i < NENV; i++)
+	{
+		struct Env* e = &envs[i];
+		if (e->env_status == ENV_FREE || e->env_status == ENV_EXIT)
+			continue;
+		totalTickets += e->tickets;
+		totalClocks += e->nClocks;
+	}
+	for (int i = 0; i < NENV; i++)
+	{
+		struct Env* e = &envs[i];
+		if (e->env_status == ENV_FREE || e->env_status == ENV_EXIT)
+			continue;
+		cprintf("[%d] %s: status = %d, tickets = %d, stride = %d, pass = %u, clocks = %d, share = ",
+				e->env_id, e->prog_name, e->env_status, e->tickets, e->stride, e->pass, e->nClocks);
+		//(scaled down first so it fits in 32 bits)
+		uint32 div = totalClocks / 100000 + 1;
+		print_hundredths(totalClocks ? (e->nClocks / div) * 10000 / (totalClocks / div) : 0);
+		cprintf("%% (tickets: ");
+		print_hundredths(e->tickets * 10000 / totalTickets);
+		cprintf("%%)\n");
+	}
+	return 0;
+}
+
+int command_lock_stats(int number_of_arguments, char **arguments)
+{
+	lockstat_print();
+	return 0;
+}
+
+int command_set_lock_profiler(int number_of_arguments, char **arguments)
+{
+	int status = strtol(arguments[1], NULL, 10);
+	lockstat_enable(status != 0);
+	cprintf("Lock profiler is TURNED %s\n", LockStat.enabled ? "ON" : "OFF");
+	return 0;
+}
+
+int command_set_page_file_device(int number_of_arguments, char **arguments)
+{
+	uint8 backend;
+	if (strcmp(arguments[1], "ide") == 0)
+		backend = BLK_IDE;
+	else if (strcmp(arguments[1], "ram") == 0)
+		backend = BLK_RAMDISK;
+	else
+	{
+		cprintf("pfdev: unknown backend %s (ide/ram)\n", arguments[1]);
+		return 0;
+	}
+	int ret = pf_set_backend(backend);
+	if (ret == E_INVAL)
+		cprintf("pfdev: no %s device is attached\n", arguments[1]);
+	else if (ret != 0)
+		cprintf("pfdev: the page file is in use, kill all the environments first\n");
+	else
+		cprintf("\nPage file is now on %s (%d frames)\n", PageFileDevices.devices[0]->name, PageFileDevices.numOfFrames - 1);
+	return 0;
+}
+
+int command_set_tickless(int number_of_arguments, char **arguments)
+{
+	int status = strtol(arguments[1], NULL, 10);
+	Tickless.enabled = (status != 0);
+	cprintf("Tickless clock is TURNED %s\n", Tickless.enabled ? "ON" : "OFF");
+	return 0;
+}
+
 int command_tst(int number_of_arguments, char **arguments)
 {
 	return tst_handler(number_of_arguments, arguments);
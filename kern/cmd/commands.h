@@ -86,12 +86,26 @@ int command_enable_buffering(int number_of_arguments, char **arguments);
 
 int command_set_modified_buffer_length(int number_of_arguments, char **arguments);
 int command_get_modified_buffer_length(int number_of_arguments, char **arguments);
+int command_enable_zswap(int number_of_arguments, char **arguments);
+int command_disable_zswap(int number_of_arguments, char **arguments);
+int command_io_stats(int number_of_arguments, char **arguments);
+int command_bsd_stats(int number_of_arguments, char **arguments);
+int command_tickless_stats(int number_of_arguments, char **arguments);
+int command_set_tickless(int number_of_arguments, char **arguments);
+int command_edf_stats(int number_of_arguments, char **arguments);
+int command_stride_stats(int number_of_arguments, char **arguments);
+int command_sched_stats(int number_of_arguments, char **arguments);
+int command_futex_stats(int number_of_arguments, char **arguments);
+int command_lock_stats(int number_of_arguments, char **arguments);
+int command_set_lock_profiler(int number_of_arguments, char **arguments);
+int command_set_page_file_device(int number_of_arguments, char **arguments);
 
 //2018
 int command_sch_RR(int number_of_arguments, char **arguments);
 int command_sch_MLFQ(int number_of_arguments, char **arguments);
 int command_sch_BSD(int number_of_arguments, char **arguments);
 int command_sch_PRIRR(int number_of_arguments, char **arguments);
+int command_sch_STRIDE(int number_of_arguments, char **arguments);
 int command_print_sch_method(int number_of_arguments, char **arguments);
 int command_sch_test(int number_of_arguments, char **arguments);
 
@@ -101,5 +115,6 @@ int command_tst(int number_of_arguments, char **arguments);
 //2024
 int command_set_priority(int number_of_arguments, char **arguments);
 int command_set_starve_thresh(int number_of_arguments, char **arguments);
+int command_set_tickets(int number_of_arguments, char **arguments);
 
 #endif /* KERN_CMD_COMMANDS_H_ */
@@ -7,6 +7,7 @@
 #include "channel.h"
 #include <kern/proc/user_environment.h>
 #include <kern/cpu/sched.h>
+#include <kern/cpu/cpu.h>
 #include <inc/string.h>
 #include <inc/disk.h>
 
@@ -18,6 +19,7 @@ void init_channel(struct Channel *chan, char *name)
 {
 	strcpy(chan->name, name);
 	init_queue(&(chan->queue));
+	chan->directedYield = 0;
 }
 
 //===============================
@@ -66,6 +68,19 @@ void wakeup_one(struct Channel *chan)
 
 		// Insert it into the ready queue
 		sched_insert_ready(env);
+
+		// Directed yield: the woken process runs next on this CPU with the rest of the quantum of
+		// the running one, right away unless the caller holds another lock (then at the next switch)
+		struct Env *cur_env = get_cpu_proc();
+		if (chan->directedYield && cur_env != NULL)
+		{
+			mycpu()->yieldTo = env;
+			if (mycpu()->ncli == 1)
+			{
+				cur_env->env_status = ENV_READY;
+				sched();
+			}
+		}
 	}
 	else cprintf("No processes to wake up\n");
 	release_spinlock(&ProcessQueues.qlock);
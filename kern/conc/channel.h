@@ -17,6 +17,7 @@ struct Channel
 {
 	struct Env_Queue queue;	//queue of blocked processes waiting on this channel
 	char name[NAMELEN];     //channel name
+	uint8 directedYield;	//wakeup_one() hands the CPU straight to the woken process (see yield_to())
 };
 void init_channel(struct Channel *chan, char *name);
 //===================================================================================
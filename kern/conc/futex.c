@@ -0,0 +1,161 @@
+/*
+ * futex.c
+ *
+ * Wait/wake on a word of user memory, keyed by its physical address.
+ */
+
+#include "futex.h"
+
+#include <inc/error.h>
+#include <inc/mmu.h>
+#include <kern/proc/user_environment.h>
+#include <kern/mem/memory_manager.h>
+#include <kern/cpu/sched.h>
+#include <kern/cpu/cpu.h>
+
+//Physical address of the given word of the current env (0 if its page is not in the memory)
+static uint32 futex_key(volatile uint32* uaddr)
+{
+	struct Env* cur_env = get_cpu_proc();
+	uint32 va = (uint32)uaddr;
+	if (cur_env == NULL || va >= USER_LIMIT || va % sizeof(uint32) != 0)
+		return 0;
+	uint32* ptr_page_table = NULL;
+	struct FrameInfo* ptr_frame_info = get_frame_info(cur_env->env_page_directory, va, &ptr_page_table);
+	if (ptr_frame_info == NULL)
+		return 0;
+	return to_physical_address(ptr_frame_info) + PGOFF(va);
+}
+
+void futex_init()
+{
+	for (int b = 0; b < FUTEX_BUCKETS; b++)
+	{
+		init_channel(&Futexes.buckets[b].chan, "futex bucket");
+		init_spinlock(&Futexes.buckets[b].lock, "futex bucket lock");
+	}
+	Futexes.waits = Futexes.mismatches = Futexes.wakeups = Futexes.doorbells = 0;
+}
+
+//Block the current env till the given word is woken up, if it still holds the expected value.
+//The word is checked under the lock of its bucket, so a wakeup after it's changed is never lost.
+//Its key is checked again there too, so it can't sleep on a frame that an eviction has just found
+//free of waiters (see futex_frame_has_waiters()).
+//Returns 0 once woken up, E_INVAL if it has changed (or its page is not in the memory: try again)
+int futex_wait(volatile uint32* uaddr, uint32 expected)
+{
+	uint32 key = futex_key(uaddr);
+	if (key == 0)
+		return E_INVAL;
+	struct FutexBucket* bucket = futex_bucket(key);
+
+	int ret = 0;
+	acquire_spinlock(&bucket->lock);
+	{
+		if (futex_key(uaddr) != key || *uaddr != expected)
+		{
+			Futexes.mismatches++;
+			ret = E_INVAL;
+		}
+		else
+		{
+			Futexes.waits++;
+			get_cpu_proc()->futexKey = key;
+			sleep(&bucket->chan, &bucket->lock);
+		}
+	}
+	release_spinlock(&bucket->lock);
+	return ret;
+}
+
+//Wake up (at most) n envs blocked on the given key of the given bucket, in their FIFO order (the lock
+//of the bucket must be held). The first one woken up is set in *first (if given)
+static int __futex_wake(struct FutexBucket* bucket, uint32 key, int n, struct Env** first)
+{
+	int woken = 0;
+	acquire_spinlock(&ProcessQueues.qlock);
+	{
+		//the queue is FIFO from its tail (see enqueue())
+		struct Env *e, *prev;
+		for (e = LIST_LAST(&bucket->chan.queue); e != NULL && woken < n; e = prev)
+		{
+			prev = LIST_PREV(e);
+			if (e->futexKey != key)
+				continue;
+			LIST_REMOVE(&bucket->chan.queue, e);
+			e->futexKey = 0;
+			e->channel = NULL;
+			e->env_status = ENV_READY;
+			sched_insert_ready(e);
+			if (first != NULL && *first == NULL)
+				*first = e;
+			woken++;
+		}
+		Futexes.wakeups += woken;
+	}
+	release_spinlock(&ProcessQueues.qlock);
+	return woken;
+}
+
+//Wake up (at most) n envs blocked on the given word, in their FIFO order. With directedYield,
+//the current env donates the rest of its quantum to the (first) woken one. Returns the # woken up
+int futex_wake(volatile uint32* uaddr, int n, uint8 directedYield)
+{
+	uint32 key = futex_key(uaddr);
+	if (key == 0)
+		return E_INVAL;
+	struct FutexBucket* bucket = futex_bucket(key);
+
+	struct Env* first = NULL;
+	acquire_spinlock(&bucket->lock);
+	int woken = __futex_wake(bucket, key, n, &first);
+	release_spinlock(&bucket->lock);
+
+	if (directedYield && first != NULL)
+		yield_to(first);
+	return woken;
+}
+
+//Ring the given doorbell: bump the word & wake up (at most) n envs blocked on it. It's bumped under
+//the lock of its bucket, so a waiter that has read its old value either blocks before (& is woken
+//up) or finds it changed. Returns the # woken up
+int futex_doorbell(volatile uint32* uaddr, int n)
+{
+	uint32 key = futex_key(uaddr);
+	if (key == 0 || !(pt_get_page_permissions(get_cpu_proc()->env_page_directory, (uint32)uaddr) & PERM_WRITEABLE))
+		return E_INVAL;
+	struct FutexBucket* bucket = futex_bucket(key);
+
+	acquire_spinlock(&bucket->lock);
+	(*uaddr)++;
+	Futexes.doorbells++;
+	int woken = __futex_wake(bucket, key, n, NULL);
+	release_spinlock(&bucket->lock);
+	return woken;
+}
+
+//Whether any env is blocked on a word of the given frame. The waiters are keyed by the physical
+//address of their word, so the frame can't be evicted under them: the first fault after it's read
+//back would map another frame, & the next wake would miss them. The caller unmaps the frame from
+//all the envs first, so no new waiter can find its key once this returns 0
+int futex_frame_has_waiters(uint32 pa)
+{
+	int found = 0;
+	for (int b = 0; b < FUTEX_BUCKETS && !found; b++)
+	{
+		struct FutexBucket* bucket = &Futexes.buckets[b];
+		acquire_spinlock(&bucket->lock);
+		acquire_spinlock(&ProcessQueues.qlock);
+		for (struct Env* e = LIST_FIRST(&bucket->chan.queue); e != NULL; e = LIST_NEXT(e))
+		{
+			if (ROUNDDOWN(e->futexKey, PAGE_SIZE) == pa)
+			{
+				found = 1;
+				break;
+			}
+		}
+		release_spinlock(&ProcessQueues.qlock);
+		release_spinlock(&bucket->lock);
+	}
+	return found;
+}
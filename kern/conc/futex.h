@@ -0,0 +1,55 @@
+/*
+ * futex.h
+ *
+ * Fast user-space mutexes: the user-level locks & semaphores (lib/semaphore.c) work on a word of
+ * shared memory with atomic instructions, & enter the kernel only to block on that word while it
+ * still holds an expected value (futex_wait()) or to wake up the envs blocked on it (futex_wake()).
+ * A doorbell (futex_doorbell()) is a futex word that the kernel bumps as it wakes up its waiters:
+ * the ring buffers of lib/ring.c ring it when they go from empty to non-empty (or full to non-full).
+ *
+ * Ref: H. Franke, R. Russell & M. Kirkwood, "Fuss, Futexes and Furwocks: Fast Userlevel Locking in Linux"
+ */
+
+#ifndef FOS_KERN_FUTEX_H
+#define FOS_KERN_FUTEX_H
+#ifndef FOS_KERNEL
+# error "This is a FOS kernel header; user programs should not #include it"
+#endif
+
+#include <inc/types.h>
+#include <kern/conc/channel.h>
+#include <kern/conc/spinlock.h>
+
+//The word is identified by its physical address (Env.futexKey), so the envs that share it at
+//different virtual addresses meet on the same key. Each key is hashed to one of the buckets, & its
+//waiters sleep on the channel of its bucket (with the waiters of the other keys of the bucket)
+#define FUTEX_HASH_BITS 6
+#define FUTEX_BUCKETS (1 << FUTEX_HASH_BITS)
+
+struct FutexBucket
+{
+	struct Channel chan;			//envs blocked on the keys of this bucket
+	struct spinlock lock;			//protects the check of the words of its keys against their sleep
+};
+
+struct
+{
+	struct FutexBucket buckets[FUTEX_BUCKETS];
+	uint32 waits;					//stats: envs blocked,
+	uint32 mismatches;				//waits returned right away as the word has changed,
+	uint32 wakeups;					//& envs woken up
+	uint32 doorbells;				//doorbells rung
+} Futexes;
+
+static inline struct FutexBucket* futex_bucket(uint32 key)
+{
+	return &Futexes.buckets[((key >> 2) * 0x9E3779B1) >> (32 - FUTEX_HASH_BITS)];
+}
+
+void futex_init();
+int futex_wait(volatile uint32* uaddr, uint32 expected);
+int futex_wake(volatile uint32* uaddr, int n, uint8 directedYield);
+int futex_doorbell(volatile uint32* uaddr, int n);
+int futex_frame_has_waiters(uint32 pa);
+
+#endif //FOS_KERN_FUTEX_H
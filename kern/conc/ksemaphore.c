@@ -10,31 +10,70 @@
 #include "ksemaphore.h"
 #include "channel.h"
 #include "../cpu/cpu.h"
+#include "../cpu/sched.h"
 #include "../proc/user_environment.h"
 
 void init_ksemaphore(struct ksemaphore *ksem, int value, char *name)
 {
-	//[PROJECT'24.MS3]
-	//COMMENT THE FOLLOWING LINE BEFORE START CODING
-	panic("init_ksemaphore is not implemented yet");
-	//Your Code is Here...
+	assert(value >= 0);
+	init_channel(&(ksem->chan), "ksemaphore channel");
+	init_spinlock(&(ksem->lk), "lock of ksemaphore");
+	strcpy(ksem->name, name);
+	ksem->count = value;
+	ksem->waits = ksem->blocks = 0;
+	ksem->totalWait = ksem->maxWait = 0;
 }
 
 void wait_ksemaphore(struct ksemaphore *ksem)
 {
-	//[PROJECT'24.MS3]
-	//COMMENT THE FOLLOWING LINE BEFORE START CODING
-	panic("wait_ksemaphore is not implemented yet");
-	//Your Code is Here...
-
+	acquire_spinlock(&(ksem->lk));
+	{
+		ksem->waits++;
+		if (ksem->count > 0)
+		{
+			ksem->count--;
+		}
+		else
+		{
+			//block till a signal hands its unit to this process (the count is not touched, so
+			//a process that waits meanwhile can't take it first)
+			uint64 start = read_tsc();
+			sleep(&(ksem->chan), &(ksem->lk));
+			uint32 wait = (uint32)((read_tsc() - start) >> 10);
+			ksem->blocks++;
+			ksem->totalWait += wait;
+			if (wait > ksem->maxWait)
+				ksem->maxWait = wait;
+		}
+	}
+	release_spinlock(&(ksem->lk));
 }
 
 void signal_ksemaphore(struct ksemaphore *ksem)
 {
-	//[PROJECT'24.MS3]
-	//COMMENT THE FOLLOWING LINE BEFORE START CODING
-	panic("signal_ksemaphore is not implemented yet");
-	//Your Code is Here...
-}
+	acquire_spinlock(&(ksem->lk));
+	{
+		//a process that has decided to block is on the channel once the qlock is free
+		//(sleep() holds it from releasing lk till switching out)
+		acquire_spinlock(&ProcessQueues.qlock);
+		int numOfBlocked = queue_size(&(ksem->chan.queue));
+		release_spinlock(&ProcessQueues.qlock);
 
+		if (numOfBlocked > 0)
+			wakeup_one(&(ksem->chan));		//hand-off
+		else
+			ksem->count++;
+	}
+	release_spinlock(&(ksem->lk));
+}
 
+void print_ksemaphore_stats(struct ksemaphore *ksem)
+{
+	acquire_spinlock(&(ksem->lk));
+	{
+		cprintf("%s: count = %d, waits = %d, blocked = %d, wait time: avg = %d K cycles, max = %d K cycles\n",
+				ksem->name, ksem->count, ksem->waits, ksem->blocks,
+				ksem->blocks ? ksem->totalWait / ksem->blocks : 0, ksem->maxWait);
+	}
+	release_spinlock(&(ksem->lk));
+}
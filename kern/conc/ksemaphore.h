@@ -8,16 +8,23 @@
 
 struct ksemaphore
 {
-	int count;       			// Semaphore value
+	int count;       			// Semaphore value (never negative: a signal hands its unit straight to a blocked process, if any)
 	struct spinlock lk; 		// spinlock protecting this count
 	struct Channel chan;		// channel to hold all blocked processes on this semaphore
 
 	// For debugging:
 	char name[NAMELEN];        	// Name of semaphore.
+
+	// Stats (protected by lk):
+	uint32 waits;				// # of waits,
+	uint32 blocks;				// # of them that blocked (& were handed a unit by a signal)
+	uint32 totalWait;			// sum of their blocked times (in K cycles)
+	uint32 maxWait;				// max blocked time (in K cycles)
 };
 
 void init_ksemaphore(struct ksemaphore *ksem, int value, char *name);
 void wait_ksemaphore(struct ksemaphore *ksem);
 void signal_ksemaphore(struct ksemaphore *ksem);
+void print_ksemaphore_stats(struct ksemaphore *ksem);
 
 #endif /*KERN_CONC_KSEMAPHORE_H_*/
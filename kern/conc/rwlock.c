@@ -0,0 +1,197 @@
+/*
+ * rwlock.c
+ *
+ * Reader-writer spin & sleep locks, with writer preference.
+ */
+
+#include "rwlock.h"
+
+#include <inc/x86.h>
+#include <inc/assert.h>
+#include <inc/string.h>
+#include <inc/environment_definitions.h>
+#include <kern/cpu/cpu.h>
+#include <kern/cpu/mp.h>
+#include <kern/cpu/sched.h>
+#include <kern/proc/user_environment.h>
+
+//==================================================================================//
+//=============================== RW SPIN LOCK =====================================//
+//==================================================================================//
+//A single word holds the readers, the waiting writers & the writer, so a reader acquires it by
+//a single cmpxchg (the readers don't serialize on an internal lock)
+
+void init_rwspinlock(struct rwspinlock *lk, char *name)
+{
+	lk->state = 0;
+	strcpy(lk->name, name);
+	lk->cpu = NULL;
+	lk->readAcquisitions = lk->writeAcquisitions = 0;
+}
+
+void acquire_read_rwspinlock(struct rwspinlock *lk)
+{
+	if (holding_write_rwspinlock(lk))
+		panic("acquire_read_rwspinlock: lock \"%s\" is already held by the same CPU.", lk->name);
+
+	pushcli();
+	for (;;)
+	{
+		uint32 state = lk->state;
+		//no writer, neither holding nor waiting
+		if ((state & (RW_WRITER | RW_WAITERS_MASK)) == 0)
+		{
+			if ((state & RW_READERS_MASK) == RW_READERS_MASK)
+				panic("acquire_read_rwspinlock: too many readers of lock \"%s\"", lk->name);
+			if (cmpxchg(&lk->state, state, state + 1) == state)
+				break;
+			continue;
+		}
+		// While spinning (with interrupts disabled), serve any TLB shootdown (see acquire_spinlock())
+		tlb_shootdown_poll();
+		pause();
+	}
+	__sync_synchronize();
+	lk->readAcquisitions++;
+}
+
+void release_read_rwspinlock(struct rwspinlock *lk)
+{
+	if ((lk->state & RW_READERS_MASK) == 0)
+		panic("release_read_rwspinlock: lock \"%s\" is not held by a reader", lk->name);
+	__sync_synchronize();
+	xadd(&lk->state, (uint32)-1);
+	popcli();
+}
+
+void acquire_write_rwspinlock(struct rwspinlock *lk)
+{
+	if (holding_write_rwspinlock(lk))
+		panic("acquire_write_rwspinlock: lock \"%s\" is already held by the same CPU.", lk->name);
+
+	pushcli();
+	//announce it: no new readers from now on
+	xadd(&lk->state, RW_WAITER_ONE);
+	for (;;)
+	{
+		uint32 state = lk->state;
+		if ((state & (RW_WRITER | RW_READERS_MASK)) == 0 &&
+				cmpxchg(&lk->state, state, (state - RW_WAITER_ONE) | RW_WRITER) == state)
+			break;
+		tlb_shootdown_poll();
+		pause();
+	}
+	__sync_synchronize();
+	lk->cpu = mycpu();
+	lk->writeAcquisitions++;
+}
+
+void release_write_rwspinlock(struct rwspinlock *lk)
+{
+	if (!holding_write_rwspinlock(lk))
+		panic("release_write_rwspinlock: lock \"%s\" is not held by this CPU", lk->name);
+	lk->cpu = NULL;
+	__sync_synchronize();
+	xadd(&lk->state, (uint32)-RW_WRITER);
+	popcli();
+}
+
+int holding_write_rwspinlock(struct rwspinlock *lk)
+{
+	int r;
+	pushcli();
+	r = (lk->state & RW_WRITER) && lk->cpu == mycpu();
+	popcli();
+	return r;
+}
+
+//==================================================================================//
+//=============================== RW SLEEP LOCK ====================================//
+//==================================================================================//
+//The waiters re-check the state once woken up: a release wakes up one writer if any is waiting
+//(it'd block the readers again anyway), or else all the readers
+
+void init_rwsleeplock(struct rwsleeplock *lk, char *name)
+{
+	init_spinlock(&(lk->lk), "lock of rw sleep lock");
+	init_channel(&(lk->readersChan), "rw sleep lock readers");
+	init_channel(&(lk->writersChan), "rw sleep lock writers");
+	lk->readers = lk->waitingWriters = 0;
+	lk->writer = 0;
+	lk->pid = 0;
+	strcpy(lk->name, name);
+	lk->readAcquisitions = lk->writeAcquisitions = lk->sleeps = 0;
+}
+
+void acquire_read_rwsleeplock(struct rwsleeplock *lk)
+{
+	acquire_spinlock(&(lk->lk));
+	{
+		while (lk->writer || lk->waitingWriters > 0)
+		{
+			lk->sleeps++;
+			sleep(&(lk->readersChan), &(lk->lk));
+		}
+		lk->readers++;
+		lk->readAcquisitions++;
+	}
+	release_spinlock(&(lk->lk));
+}
+
+void release_read_rwsleeplock(struct rwsleeplock *lk)
+{
+	acquire_spinlock(&(lk->lk));
+	{
+		if (lk->readers == 0)
+			panic("release_read_rwsleeplock: lock \"%s\" is not held by a reader", lk->name);
+		lk->readers--;
+		if (lk->readers == 0 && lk->waitingWriters > 0)
+			wakeup_one(&(lk->writersChan));
+	}
+	release_spinlock(&(lk->lk));
+}
+
+void acquire_write_rwsleeplock(struct rwsleeplock *lk)
+{
+	struct Env* cur_env = get_cpu_proc();
+	acquire_spinlock(&(lk->lk));
+	{
+		lk->waitingWriters++;
+		while (lk->writer || lk->readers > 0)
+		{
+			lk->sleeps++;
+			sleep(&(lk->writersChan), &(lk->lk));
+		}
+		lk->waitingWriters--;
+		lk->writer = 1;
+		lk->pid = (cur_env != NULL) ? cur_env->env_id : 0;
+		lk->writeAcquisitions++;
+	}
+	release_spinlock(&(lk->lk));
+}
+
+void release_write_rwsleeplock(struct rwsleeplock *lk)
+{
+	acquire_spinlock(&(lk->lk));
+	{
+		if (!lk->writer)
+			panic("release_write_rwsleeplock: lock \"%s\" is not held by a writer", lk->name);
+		lk->writer = 0;
+		lk->pid = 0;
+		if (lk->waitingWriters > 0)
+			wakeup_one(&(lk->writersChan));
+		else
+			wakeup_all(&(lk->readersChan));
+	}
+	release_spinlock(&(lk->lk));
+}
+
+int holding_write_rwsleeplock(struct rwsleeplock *lk)
+{
+	struct Env* cur_env = get_cpu_proc();
+	int r;
+	acquire_spinlock(&(lk->lk));
+	r = lk->writer && cur_env != NULL && lk->pid == cur_env->env_id;
+	release_spinlock(&(lk->lk));
+	return r;
+}
@@ -0,0 +1,67 @@
+/*
+ * rwlock.h
+ *
+ * Reader-writer locks for the read-mostly kernel tables: any number of readers hold the lock at
+ * once, or a single writer. Both locks prefer the writers: once a writer is waiting, new readers
+ * wait behind it (the held readers drain), so a stream of readers can't starve the writers.
+ *	rwspinlock:		spins (with interrupts disabled, like a spinlock), for short critical sections
+ *	rwsleeplock:	blocks the waiters (like a sleeplock), for long ones, in the context of a process
+ * A reader must not acquire the same lock again while holding it (it'd wait behind a waiting writer).
+ */
+
+#ifndef FOS_KERN_RWLOCK_H
+#define FOS_KERN_RWLOCK_H
+#ifndef FOS_KERNEL
+# error "This is a FOS kernel header; user programs should not #include it"
+#endif
+
+#include <inc/types.h>
+#include <inc/environment_definitions.h>
+#include <kern/conc/spinlock.h>
+#include <kern/conc/channel.h>
+
+//State word of the rwspinlock, updated by cmpxchg/xadd only
+#define RW_READERS_MASK	0x0000FFFF			//# of readers holding it
+#define RW_WAITER_ONE	0x00010000			//# of waiting writers (in bits 16..30)
+#define RW_WAITERS_MASK	0x7FFF0000
+#define RW_WRITER		0x80000000			//held by a writer
+
+struct rwspinlock
+{
+	volatile uint32 state;
+	char name[NAMELEN];
+	struct cpu *cpu;						//the cpu of the writer holding it (for debugging)
+	uint32 readAcquisitions;				//stats (approximate: not updated atomically)
+	uint32 writeAcquisitions;
+};
+
+void init_rwspinlock(struct rwspinlock *lk, char *name);
+void acquire_read_rwspinlock(struct rwspinlock *lk);
+void release_read_rwspinlock(struct rwspinlock *lk);
+void acquire_write_rwspinlock(struct rwspinlock *lk);
+void release_write_rwspinlock(struct rwspinlock *lk);
+int holding_write_rwspinlock(struct rwspinlock *lk);
+
+struct rwsleeplock
+{
+	struct spinlock lk;						//protects all the below
+	struct Channel readersChan;				//blocked readers, woken up all at once
+	struct Channel writersChan;				//blocked writers, woken up one at a time
+	uint32 readers;							//# of readers holding it
+	uint32 waitingWriters;
+	bool writer;							//held by a writer
+	int pid;								//the writer holding it (for debugging)
+	char name[NAMELEN];
+	uint32 readAcquisitions;				//stats
+	uint32 writeAcquisitions;
+	uint32 sleeps;
+};
+
+void init_rwsleeplock(struct rwsleeplock *lk, char *name);
+void acquire_read_rwsleeplock(struct rwsleeplock *lk);
+void release_read_rwsleeplock(struct rwsleeplock *lk);
+void acquire_write_rwsleeplock(struct rwsleeplock *lk);
+void release_write_rwsleeplock(struct rwsleeplock *lk);
+int holding_write_rwsleeplock(struct rwsleeplock *lk);
+
+#endif //FOS_KERN_RWLOCK_H
@@ -10,6 +10,7 @@
 #include "sleeplock.h"
 #include "channel.h"
 #include "../cpu/cpu.h"
+#include "../cpu/sched.h"
 #include "../proc/user_environment.h"
 
 void init_sleeplock(struct sleeplock *lk, char *name)
@@ -19,6 +20,9 @@ void init_sleeplock(struct sleeplock *lk, char *name)
 	strcpy(lk->name, name);
 	lk->locked = 0;
 	lk->pid = 0;
+	lk->owner = NULL;
+	lk->adaptive = 1;
+	lk->acquisitions = lk->contended = lk->spinAcquired = lk->sleeps = 0;
 }
 
 int holding_sleeplock(struct sleeplock *lk)
@@ -29,19 +33,80 @@ int holding_sleeplock(struct sleeplock *lk)
 	release_spinlock(&(lk->lk));
 	return r;
 }
+
+void sleeplock_set_adaptive(struct sleeplock *lk, uint8 adaptive)
+{
+	acquire_spinlock(&(lk->lk));
+	lk->adaptive = adaptive;
+	release_spinlock(&(lk->lk));
+}
+
+void print_sleeplock_stats(struct sleeplock *lk)
+{
+	acquire_spinlock(&(lk->lk));
+	cprintf("%s: acquisitions = %d, contended = %d (acquired by spinning = %d, slept = %d)\n",
+			lk->name, lk->acquisitions, lk->contended, lk->spinAcquired, lk->sleeps);
+	release_spinlock(&(lk->lk));
+}
 //==========================================================================
 
+//# of processes blocked on the lock (lk must be held). A process that has decided to block is on
+//the channel once the qlock is free (sleep() holds it from releasing lk till switching out)
+static int sleeplock_num_of_blocked(struct sleeplock *lk)
+{
+	acquire_spinlock(&ProcessQueues.qlock);
+	int n = queue_size(&(lk->chan.queue));
+	release_spinlock(&ProcessQueues.qlock);
+	return n;
+}
+
+//The owner is running on another CPU (racy, it's just a hint)
+static inline int sleeplock_owner_running(struct sleeplock *lk)
+{
+	struct Env* owner = lk->owner;
+	return owner != NULL && owner->env_status == ENV_RUNNING && owner->cpu != mycpu_index();
+}
+
 void acquire_sleeplock(struct sleeplock *lk)
 {
+	struct Env* cur_env = get_cpu_proc();
+
 	// Acquire the internal spinlock
 	acquire_spinlock(&lk->lk);
+	lk->acquisitions++;
 
-	// Check if the lock is already held
-	while (lk->locked) sleep(&lk->chan, &lk->lk); // Sleep on the lock's channel if it's held
+	if (lk->locked)
+	{
+		lk->contended++;
+
+		// Adaptive: poll (with the internal spinlock released) while the owner is running elsewhere
+		if (lk->adaptive && ncpu > 1 && sleeplock_num_of_blocked(lk) == 0)
+		{
+			for (int i = 0; i < SLEEPLOCK_SPIN_LIMIT && lk->locked && sleeplock_owner_running(lk); i++)
+			{
+				release_spinlock(&lk->lk);
+				pause();
+				acquire_spinlock(&lk->lk);
+			}
+			if (!lk->locked)
+				lk->spinAcquired++;
+		}
+
+		// Sleep on the lock's channel till the release hands it to this process
+		if (lk->locked)
+		{
+			lk->sleeps++;
+			sleep(&lk->chan, &lk->lk);
+			assert(lk->locked && lk->pid == cur_env->env_id);
+			release_spinlock(&lk->lk);
+			return;
+		}
+	}
 
 	// Lock is free, so acquire it
 	lk->locked = 1;
-	lk->pid = get_cpu_proc()->env_id;
+	lk->pid = cur_env->env_id;
+	lk->owner = cur_env;
 
 	// Release the internal spinlock
 	release_spinlock(&lk->lk);
@@ -55,9 +120,25 @@ void release_sleeplock(struct sleeplock *lk)
 	// Check if the current process holds the lock
 	if (lk->locked && lk->pid == get_cpu_proc()->env_id)
 	{
-		lk->locked = 0; // Release the lock
-		lk->pid = 0;
-		wakeup_all(&lk->chan); // Wake up any waiting processes
+		// Hand the lock to the longest blocked process (the one that wakeup_one() wakes up), if any.
+		// It stays locked, so no other process can take it meanwhile
+		struct Env* next = NULL;
+		acquire_spinlock(&ProcessQueues.qlock);
+		next = LIST_LAST(&(lk->chan.queue));
+		release_spinlock(&ProcessQueues.qlock);
+
+		if (next != NULL)
+		{
+			lk->pid = next->env_id;
+			lk->owner = next;
+			wakeup_one(&lk->chan);
+		}
+		else
+		{
+			lk->locked = 0; // Release the lock
+			lk->pid = 0;
+			lk->owner = NULL;
+		}
 	}
 
 	// Release the internal spinlock
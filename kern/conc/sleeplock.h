@@ -8,6 +8,8 @@
 #include <kern/conc/channel.h>
 #include <kern/cpu/sched_helpers.h>
 
+#define SLEEPLOCK_SPIN_LIMIT 1000	//max polls of an adaptive lock whose owner is running on another CPU before sleeping
+
 //===================================================================================
 //TODO: [PROJECT'24.MS1 - #00 GIVENS] [4] LOCKS - SleepLock struct & helper functions
 struct sleeplock
@@ -18,10 +20,24 @@ struct sleeplock
 	// For debugging:
 	char name[NAMELEN];    	// Name of lock.
 	int pid;           		// Process holding lock
+	struct Env* owner;		// and its env (to check whether it's running)
+
+	// A release hands the lock straight to the longest blocked process (FIFO), if any.
+	// If adaptive, an acquire first spins while the owner is running on another CPU
+	// (it's likely to release the lock soon) & there're no blocked processes to overtake
+	uint8 adaptive;
+
+	// Contention counters (protected by lk):
+	uint32 acquisitions;
+	uint32 contended;		// the lock was held
+	uint32 spinAcquired;	// of these: acquired by spinning (adaptive)
+	uint32 sleeps;			// of these: blocked till handed the lock
 };
 
 void init_sleeplock(struct sleeplock *lk, char *name);
 int  holding_sleeplock(struct sleeplock *lk);
+void sleeplock_set_adaptive(struct sleeplock *lk, uint8 adaptive);
+void print_sleeplock_stats(struct sleeplock *lk);
 //===================================================================================
 
 void acquire_sleeplock(struct sleeplock *lk);
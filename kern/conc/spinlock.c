@@ -12,13 +12,88 @@
 #include "inc/assert.h"
 #include "spinlock.h"
 #include "../cpu/cpu.h"
+#include "../cpu/mp.h"
 #include "../proc/user_environment.h"
+#include "../trap/kdebug.h"
+
+//MCS nodes of each CPU. The interrupts are disabled while a CPU acquires a lock, so its nodes
+//are never allocated concurrently. A lock keeps the node of its holder (lk->mcsNode), since the
+//locks are not always released in the reverse order of their acquisition
+static struct mcs_node mcsNodes[NCPUS][MCS_NODES_PER_CPU];
+
+static struct mcs_node* mcs_alloc_node()
+{
+	struct mcs_node* nodes = mcsNodes[mycpu_index()];
+	for (int i = 0; i < MCS_NODES_PER_CPU; i++)
+	{
+		if (!nodes[i].inUse)
+		{
+			nodes[i].inUse = 1;
+			return &nodes[i];
+		}
+	}
+	panic("mcs_alloc_node: more than %d spinlocks are held by the same CPU", MCS_NODES_PER_CPU);
+	return NULL;
+}
+
+//Class of the locks of the given name (added if it's new). NULL if the table is full
+static struct LockClass* lockstat_class(char *name)
+{
+	struct LockClass* cls = NULL;
+	while (xchg(&LockStat.tableLock, 1) != 0)
+		pause();
+	for (int i = 0; i < LockStat.numOfClasses; i++)
+	{
+		if (strcmp(LockStat.classes[i].name, name) == 0)
+		{
+			cls = &LockStat.classes[i];
+			break;
+		}
+	}
+	if (cls == NULL && LockStat.numOfClasses < LOCKSTAT_MAX_CLASSES)
+	{
+		cls = &LockStat.classes[LockStat.numOfClasses++];
+		memset(cls, 0, sizeof(struct LockClass));
+		strcpy(cls->name, name);
+	}
+	LockStat.tableLock = 0;
+	return cls;
+}
+
+//Charge a contended acquisition to its call site: the sites of the class are kept by the
+//space-saving algorithm (a new site replaces the one with the min count, & inherits it)
+static void lockstat_contended(struct LockClass* cls, uint32 pc, uint32 spinTime)
+{
+	struct LockSite* site = NULL;
+	struct LockSite* minSite = &cls->sites[0];
+	for (int i = 0; i < LOCKSTAT_SITES; i++)
+	{
+		if (cls->sites[i].pc == pc)
+		{
+			site = &cls->sites[i];
+			break;
+		}
+		if (cls->sites[i].contended < minSite->contended)
+			minSite = &cls->sites[i];
+	}
+	if (site == NULL)
+	{
+		site = minSite;
+		site->pc = pc;
+		site->spinTime = 0;
+	}
+	site->contended++;
+	site->spinTime += spinTime;
+}
 
 void init_spinlock(struct spinlock *lk, char *name)
 {
 	strcpy(lk->name, name);
 	lk->locked = 0;
 	lk->cpu = 0;
+	lk->ticketNext = lk->ticketOwner = 0;
+	lk->mcsTail = lk->mcsNode = NULL;
+	lk->stat = lockstat_class(name);
 }
 
 // Acquire the lock.
@@ -34,8 +109,46 @@ void acquire_spinlock(struct spinlock *lk)
 
 	//cprintf("\nAttempt to acquire SPIN lock [%s] by [%d]\n", lk->name, myproc() != NULL? myproc()->env_id : 0);
 
+	uint8 profile = LockStat.enabled && lk->stat != NULL;
+	uint64 spinStart = profile ? read_tsc() : 0;
+	int contended = 0;
+
+	// While spinning (with interrupts disabled), serve any TLB shootdown requested by
+	// another CPU, which may be the lock holder waiting for us to invalidate a page
+#if SPINLOCK_IMPL == SPINLOCK_TICKET
+	uint32 myTicket = xadd(&lk->ticketNext, 1);
+	while (lk->ticketOwner != myTicket)
+	{
+		contended = 1;
+		tlb_shootdown_poll();
+		pause();
+	}
+	lk->locked = 1;
+#elif SPINLOCK_IMPL == SPINLOCK_MCS
+	struct mcs_node* node = mcs_alloc_node();
+	node->next = NULL;
+	node->waiting = 1;
+	struct mcs_node* pred = (struct mcs_node*) xchg((volatile uint32*)&lk->mcsTail, (uint32)node);
+	if (pred != NULL)
+	{
+		contended = 1;
+		pred->next = node;
+		while (node->waiting)
+		{
+			tlb_shootdown_poll();
+			pause();
+		}
+	}
+	lk->mcsNode = node;
+	lk->locked = 1;
+#else
 	// The xchg is atomic.
-	while(xchg(&lk->locked, 1) != 0) ;
+	while(xchg(&lk->locked, 1) != 0)
+	{
+		contended = 1;
+		tlb_shootdown_poll();
+	}
+#endif
 
 	//cprintf("SPIN lock [%s] is ACQUIRED  by [%d]\n", lk->name, myproc() != NULL? myproc()->env_id : 0);
 
@@ -48,6 +161,20 @@ void acquire_spinlock(struct spinlock *lk)
 	lk->cpu = mycpu();
 	getcallerpcs(&lk, lk->pcs);
 
+	if (profile)
+	{
+		lk->acquireTime = read_tsc();
+		xadd(&lk->stat->acquisitions, 1);
+		if (contended)
+		{
+			uint32 spinTime = (uint32)((lk->acquireTime - spinStart) >> 10);
+			xadd(&lk->stat->contended, 1);
+			xadd(&lk->stat->spinTime, spinTime);
+			lockstat_contended(lk->stat, lk->pcs[0], spinTime);
+		}
+	}
+	else
+		lk->acquireTime = 0;
 }
 
 // Release the lock.
@@ -58,6 +185,8 @@ void release_spinlock(struct spinlock *lk)
 		printcallstack(lk);
 		panic("release: lock \"%s\" is either not held or held by another CPU!", lk->name);
 	}
+	if (lk->acquireTime != 0 && LockStat.enabled)
+		xadd(&lk->stat->holdTime, (uint32)((read_tsc() - lk->acquireTime) >> 10));
 	lk->pcs[0] = 0;
 	lk->cpu = 0;
 
@@ -68,10 +197,35 @@ void release_spinlock(struct spinlock *lk)
 	// stores; __sync_synchronize() tells them both not to.
 	__sync_synchronize();
 
+#if SPINLOCK_IMPL == SPINLOCK_TICKET
+	// Only the holder writes the owner ticket: serve the next one
+	lk->locked = 0;
+	__sync_synchronize();
+	lk->ticketOwner++;
+#elif SPINLOCK_IMPL == SPINLOCK_MCS
+	// Hand the lock over to the next waiter, if any (it may be just enqueuing itself)
+	struct mcs_node* node = lk->mcsNode;
+	lk->mcsNode = NULL;
+	lk->locked = 0;
+	__sync_synchronize();
+	if (node->next == NULL)
+	{
+		if (cmpxchg((volatile uint32*)&lk->mcsTail, (uint32)node, 0) != (uint32)node)
+		{
+			while (node->next == NULL)
+				pause();
+			node->next->waiting = 0;
+		}
+	}
+	else
+		node->next->waiting = 0;
+	node->inUse = 0;
+#else
 	// Release the lock, equivalent to lk->locked = 0.
 	// This code can't use a C assignment, since it might
 	// not be atomic. A real OS would use C atomics here.
 	asm volatile("movl $0, %0" : "+m" (lk->locked) : );
+#endif
 
 	popcli();
 }
@@ -120,3 +274,61 @@ int holding_spinlock(struct spinlock *lock)
 	return r;
 }
 
+//=======================================================================
+//Lock contention profiler
+//=======================================================================
+//Turn on (with all the counters reset) or off the profiling of the locks
+void lockstat_enable(uint8 enabled)
+{
+	if (enabled)
+	{
+		LockStat.enabled = 0;
+		for (int i = 0; i < LockStat.numOfClasses; i++)
+		{
+			struct LockClass* cls = &LockStat.classes[i];
+			cls->acquisitions = cls->contended = cls->spinTime = cls->holdTime = 0;
+			memset(cls->sites, 0, sizeof(cls->sites));
+		}
+	}
+	LockStat.enabled = enabled;
+}
+
+//Print the classes in the descending order of their spin times (i.e. the locks that limit the
+//scalability first), with the top call sites of their contended acquisitions
+void lockstat_print()
+{
+	cprintf("lockstat is %s (%s spinlocks), %d lock classes\n", LockStat.enabled ? "ON" : "OFF",
+			SPINLOCK_IMPL == SPINLOCK_TICKET ? "ticket" : (SPINLOCK_IMPL == SPINLOCK_MCS ? "MCS" : "test-and-set"),
+			LockStat.numOfClasses);
+	uint8 printed[LOCKSTAT_MAX_CLASSES] = {0};
+	for (int n = 0; n < LockStat.numOfClasses; n++)
+	{
+		struct LockClass* top = NULL;
+		int topIdx = -1;
+		for (int i = 0; i < LockStat.numOfClasses; i++)
+		{
+			if (!printed[i] && (top == NULL || LockStat.classes[i].spinTime > top->spinTime ||
+					(LockStat.classes[i].spinTime == top->spinTime && LockStat.classes[i].acquisitions > top->acquisitions)))
+			{
+				top = &LockStat.classes[i];
+				topIdx = i;
+			}
+		}
+		printed[topIdx] = 1;
+		if (top->acquisitions == 0)
+			continue;
+		cprintf("%s: acquisitions = %d, contended = %d, spin = %d K cycles, hold = %d K cycles (avg = %d)\n",
+				top->name, top->acquisitions, top->contended, top->spinTime, top->holdTime, top->holdTime / top->acquisitions);
+		for (int s = 0; s < LOCKSTAT_SITES; s++)
+		{
+			struct LockSite* site = &top->sites[s];
+			if (site->contended == 0)
+				continue;
+			struct Eipdebuginfo info;
+			debuginfo_eip((uint32*)site->pc, &info);
+			cprintf("\t%.*s+%d (%s:%d): contended = %d, spin = %d K cycles\n",
+					info.eip_fn_namelen, info.eip_fn_name, site->pc - (uint32)info.eip_fn_addr,
+					info.eip_file, info.eip_line, site->contended, site->spinTime);
+		}
+	}
+}
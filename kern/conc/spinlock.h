@@ -6,16 +6,75 @@
 #ifndef KERN_CONC_SPINLOCK_H_
 #define KERN_CONC_SPINLOCK_H_
 
+//Implementation of the spinlocks (same API):
+//	SPINLOCK_TAS:		test-and-set on a single word (no fairness: the next holder is whoever wins the xchg)
+//	SPINLOCK_TICKET:	FIFO by tickets (all the waiters spin on the same word)
+//	SPINLOCK_MCS:		FIFO queue of per-CPU nodes (each waiter spins on its own node)
+//Ref: J. Mellor-Crummey & M. Scott, "Algorithms for Scalable Synchronization on Shared-Memory Multiprocessors"
+#define SPINLOCK_TAS	0
+#define SPINLOCK_TICKET	1
+#define SPINLOCK_MCS	2
+#define SPINLOCK_IMPL	SPINLOCK_TICKET
+
+#define MCS_NODES_PER_CPU 8			//max # of spinlocks held (or being acquired) by a CPU at once
+
+struct mcs_node
+{
+	struct mcs_node* volatile next;	//next waiter in the queue
+	volatile uint32 waiting;		//cleared by the predecessor when it hands the lock over
+	uint8 inUse;
+};
+
+//=======================================================================
+//Lock contention profiler (lockstat): the locks are profiled by class, i.e. by the name they're
+//initialized with (e.g. all the locks of the futex buckets are a single class)
+#define LOCKSTAT_MAX_CLASSES 64
+#define LOCKSTAT_SITES 4			//top call sites of the contended acquisitions of each class
+
+struct LockSite
+{
+	uint32 pc;						//caller of acquire_spinlock()
+	uint32 contended;
+	uint32 spinTime;				//K cycles spent spinning from this site
+};
+
+struct LockClass
+{
+	char name[NAMELEN];
+	uint32 acquisitions;
+	uint32 contended;				//the lock was held (the acquirer had to spin)
+	uint32 spinTime;				//K cycles spent spinning
+	uint32 holdTime;				//K cycles held
+	struct LockSite sites[LOCKSTAT_SITES];
+};
+
+struct
+{
+	struct LockClass classes[LOCKSTAT_MAX_CLASSES];
+	uint32 numOfClasses;
+	volatile uint32 tableLock;		//protects the addition of the classes (it can't be a spinlock)
+	uint8 enabled;					//the counters are updated by the holders of the locks of each class,
+									//atomically, except for the sites (approximate)
+} LockStat;
+
 //=======================================================================
 //TODO: [PROJECT'24.MS1 - #00 GIVENS] [4] LOCKS - SpinLock Implementation
 struct spinlock {
-  uint32 locked;       	// Is the lock held?
+  uint32 locked;       	// Is the lock held? (the lock word itself with SPINLOCK_TAS)
+  volatile uint32 ticketNext;		// SPINLOCK_TICKET: next ticket to take
+  volatile uint32 ticketOwner;		// and the ticket of the holder
+  struct mcs_node* volatile mcsTail;// SPINLOCK_MCS: last waiter (NULL if free)
+  struct mcs_node* mcsNode;			// and the node of the holder
 
   // For debugging:
   char name[NAMELEN];	// Name of lock.
   struct cpu *cpu;   	// The cpu holding the lock.
   uint32 pcs[10];      	// The call stack (an array of program counters)
                      	// that locked the lock.
+
+  // For profiling (lockstat):
+  struct LockClass* stat;	// its class (NULL if it's not profiled)
+  uint64 acquireTime;		// rdtsc when it's acquired
 };
 void init_spinlock(struct spinlock *lk, char *name);
 void acquire_spinlock(struct spinlock *lk);
@@ -25,4 +84,7 @@ void printcallstack(struct spinlock *lk);
 int holding_spinlock(struct spinlock *lock);
 //=======================================================================
 
+void lockstat_enable(uint8 enabled);
+void lockstat_print();
+
 #endif /*KERN_CONC_SPINLOCK_H_*/
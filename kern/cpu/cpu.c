@@ -6,6 +6,7 @@
  */
 #include <kern/cpu/cpu.h>
 #include <kern/cpu/sched.h>
+#include <kern/cpu/lapic.h>
 #include <inc/x86.h>
 #include <inc/stdio.h>
 #include <inc/assert.h>
@@ -18,29 +19,33 @@ extern void idt_init(void);
 // rescheduled between reading lapicid and running through the loop.
 struct cpu* mycpu()
 {
-	return &CPUS[0]; //main CPU
+	//the main CPU is the only one if no other CPUs are found in the MP tables (see mp.c)
+	if (ncpu <= 1 || lapic == NULL)
+		return &CPUS[0]; //main CPU
 
 	/*this code is for multi-cpu
 	 * ref: xv6 OS (x86 ver)
 	 */
-//	if(read_eflags()&FL_IF)
-//	    panic("mycpu called with interrupts enabled\n");
-
-//	int apicid, i;
-//  apicid = lapicid();
-//  // APIC IDs are not guaranteed to be contiguous. Maybe we should have
-//  // a reverse map, or reserve a register to store &cpus[i].
-//  for (i = 0; i < ncpu; ++i) {
-//    if (cpus[i].apicid == apicid)
-//      return &cpus[i];
-//  }
-//  panic("unknown apicid\n");
+	int apicid, i;
+	apicid = lapic_id();
+	// APIC IDs are not guaranteed to be contiguous. Maybe we should have
+	// a reverse map, or reserve a register to store &cpus[i].
+	for (i = 0; i < ncpu; ++i) {
+		if (CPUS[i].apicid == apicid)
+			return &CPUS[i];
+	}
+	panic("unknown apicid\n");
+}
+
+int mycpu_index()
+{
+	return mycpu() - CPUS;
 }
 
 // Common CPU setup code.
 void cpu_init(int cpuIndx)
 {
-  struct cpu* c = mycpu();
+  struct cpu* c = &CPUS[cpuIndx];
   c->proc = NULL;
   c->ncli = 0;
   c->intena = read_eflags() & FL_IF ? 1 : 0;
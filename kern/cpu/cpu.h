@@ -22,10 +22,24 @@ struct cpu {
   int intena;                  	// Were interrupts enabled before pushcli? (for locking)
   struct Env *proc;           	// The process running on this cpu or null
   int scheduler_status ;		// Status of the scheduler at this CPU
+  uint32 timerCount;			// Local APIC timer (APs only): counts of the current quantum,
+  uint32 timerRemaining;		// its remaining counts while it's stopped
+  uint8 timerRunning;			// and whether it's counting down
+  uint8 quantum;				// Clock of this CPU: ms of its current quantum (tick),
+  uint16 tickStretch;			// # of quantums covered by its armed one-shot (tickless, see kclock.c)
+  uint8 clockOff;				// and whether it's kept off (idle) till it's armed again
+  struct Env *yieldTo;			// Env that its proc has donated the rest of its quantum to (directed yield, see yield_to())
+  uint64 statLeave;				// rdtsc when its last env left it, till the next one is dispatched (see sched_stats.c)
+  uint32 lastFaultVA, lastFaultEIP;	// Last page fault taken on this CPU & the one before it: the same va
+  uint32 beforeLastFaultVA, beforeLastFaultEIP;	// faulted 3 successive times by the same env panics (see fault_handler())
+  struct Env* lastFaultedEnv;
+  int8 numRepeatedFaults;
 };
 
-struct cpu CPUS[NCPUS] ;
+struct cpu CPUS[NCPUS] ;		// CPUS[0] is the boot CPU, the APs follow
+int ncpu;						// Number of CPUs found in the MP tables (1 if there're no tables)
 struct cpu* mycpu();
+int mycpu_index();
 void cpu_init(int cpuIndx);
 void popcli(void);				//enable interrupt on current CPU
 void pushcli(void);				//disable interrupt on current CPU
@@ -15,6 +15,7 @@
 #include <kern/cpu/picirq.h>
 #include <kern/cpu/cpu.h>
 #include <kern/cpu/sched.h>
+#include <kern/cpu/lapic.h>
 #include <kern/trap/trap.h>
 
 
@@ -39,25 +40,46 @@ mc146818_write(unsigned reg, unsigned datum)
  * (which depends on the mode).
  */
 
+//Counter 0 is a one-shot (interrupt on terminal count): it's armed for the next expiry only
+//(see kclock_set_quantum() & kclock_stretch())
+#define KCLOCK_MODE (TIMER_SEL0 | TIMER_INTTC | TIMER_16BIT)
+
+//The PIT & the 8259A are wired to the boot CPU only, the APs use the timers of their local APICs instead
+static inline int kclock_on_ap()
+{
+	return ncpu > 1 && mycpu() != &CPUS[0];
+}
+
 void kclock_init()
 {
 	ticks = 0;
+	Tickless.enabled = 1;
 	irq_install_handler(0, &clock_interrupt_handler);
 }
 void
 kclock_start(uint8 quantum_in_ms)
 {
+	struct cpu* c = mycpu();
+	c->quantum = quantum_in_ms;
+	c->tickStretch = 1;
+	c->clockOff = 0;
+	if (kclock_on_ap())
+	{
+		lapic_timer_set_quantum(quantum_in_ms);
+		lapic_timer_resume();
+		return;
+	}
 	//uint16 cnt0 = kclock_read_cnt0() ;
 
 	/* initialize 8253 clock to interrupt N times/sec, N = 1 sec / CLOCK_INTERVAL */
-	outb(TIMER_MODE, TIMER_SEL0 | TIMER_RATEGEN | TIMER_16BIT);
+	outb(TIMER_MODE, KCLOCK_MODE);
 
 	//2017
 //	outb(TIMER_CNTR0, TIMER_DIV((1000/CLOCK_INTERVAL_IN_MS)) % 256);
 //	outb(TIMER_CNTR0, TIMER_DIV((1000/CLOCK_INTERVAL_IN_MS)) / 256);
 	if (IS_VALID_QUANTUM(quantum_in_ms))
 	{
-		outb(TIMER_MODE, TIMER_SEL0 | TIMER_RATEGEN | TIMER_16BIT);
+		outb(TIMER_MODE, KCLOCK_MODE);
 		kclock_write_cnt0_LSB_first(TIMER_DIV((1000/quantum_in_ms))) ;
 	}
 	else
@@ -92,6 +114,11 @@ kclock_start(uint8 quantum_in_ms)
 void
 kclock_stop(void)
 {
+	if (kclock_on_ap())
+	{
+		lapic_timer_stop();
+		return;
+	}
 //	int h, c = 0 ;
 //			for (h = 0 ; h < 30000 ; h++)
 //			{
@@ -108,7 +135,7 @@ kclock_stop(void)
 	//outb(TIMER_CNTR0, 0x00) ;
 
 
-	outb(TIMER_MODE, TIMER_SEL0 | TIMER_RATEGEN | TIMER_16BIT);
+	outb(TIMER_MODE, KCLOCK_MODE);
 
 //	uint16 cnt0 = kclock_read_cnt0() ;
 //	cprintf("Timer STOPPED: Counter0 = %d\n", cnt0 );
@@ -145,6 +172,14 @@ kclock_stop(void)
 void
 kclock_resume(void)
 {
+	//kept off by the tickless idle
+	if (mycpu()->clockOff)
+		return;
+	if (kclock_on_ap())
+	{
+		lapic_timer_resume();
+		return;
+	}
 	/*2024: changed to latch
 	 * the current count is copied into an internal "latch register" which can then be read via the data port corresponding to the selected channel (I/O ports 0x40 to 0x42). The value kept in the latch register remains the same until it has been fully read, or until a new mode/command register is written.
 	 * The main benefit of the latch command is that it allows both bytes of the current count to be read without inconsistencies. For example, if you didn't use the latch command, then the current count may decrease from 0x0200 to 0x01FF after you've read the low byte but before you've read the high byte, so that your software thinks the counter was 0x0100 instead of 0x0200 (or 0x01FF).
@@ -152,6 +187,12 @@ kclock_resume(void)
 	//uint16 cnt0 = kclock_read_cnt0() ;
 	uint16 cnt0 = kclock_read_cnt0_latch() ;
 	//cprintf("CLOCK RESUMED: Counter0 Value = %d\n", cnt0 );
+	//the one-shot has fired (its counter wraps around after the terminal count): arm a whole quantum
+	struct cpu* c = mycpu();
+	if (c->quantum > 0 && cnt0 > NUM_CLKS_PER_QUANTUM(c->quantum) * c->tickStretch)
+	{
+		cnt0 = NUM_CLKS_PER_QUANTUM(c->quantum);
+	}
 	//2017: if the remaining time is small, then increase it a bit to avoid invoking the CLOCK INT
 	//		before returning back to the environment (this cause INT inside INT!!!) el7 :)
 	if (cnt0 < 20)
@@ -162,7 +203,7 @@ kclock_resume(void)
 	if (cnt0 % 2 == 1)
 		cnt0++;
 
-	outb(TIMER_MODE, TIMER_SEL0 | TIMER_RATEGEN | TIMER_16BIT);
+	outb(TIMER_MODE, KCLOCK_MODE);
 	kclock_write_cnt0_LSB_first(cnt0) ;
 
 	//Busy-wait until the new cnt value is loaded from CR (Count Register) to CE (Count Element)
@@ -203,7 +244,7 @@ kclock_resume(void)
 
 void kclock_start_counter(uint8 cnt0)
 {
-	outb(TIMER_MODE, TIMER_SEL0 | TIMER_RATEGEN | TIMER_16BIT);
+	outb(TIMER_MODE, KCLOCK_MODE);
 	kclock_write_cnt0_LSB_first(cnt0) ;
 	//irq_setmask_8259A(irq_mask_8259A & ~(1<<0));
 	irq_clear_mask(0);
@@ -214,6 +255,17 @@ void kclock_start_counter(uint8 cnt0)
 void kclock_set_quantum(uint8 quantum_in_ms)
 {
 	if (IS_VALID_QUANTUM(quantum_in_ms))
+	{
+		struct cpu* c = mycpu();
+		c->quantum = quantum_in_ms;
+		c->tickStretch = 1;
+		c->clockOff = 0;
+	}
+	if (IS_VALID_QUANTUM(quantum_in_ms) && kclock_on_ap())
+	{
+		lapic_timer_set_quantum(quantum_in_ms);
+	}
+	else if (IS_VALID_QUANTUM(quantum_in_ms))
 	{
 		/*2023*/
 //		int cnt = TIMER_DIV((1000/quantum_in_ms));
@@ -223,7 +275,7 @@ void kclock_set_quantum(uint8 quantum_in_ms)
 
 
 		//cprintf("QUANTUM is set to %d ms (%d)\n", quantum_in_ms, TIMER_DIV((1000/quantum_in_ms)));
-		outb(TIMER_MODE, TIMER_SEL0 | TIMER_RATEGEN | TIMER_16BIT);
+		outb(TIMER_MODE, KCLOCK_MODE);
 		kclock_write_cnt0_LSB_first(cnt) ;
 		kclock_stop();
 		//uint16 cnt0 = kclock_read_cnt0_latch() ; //read after write to ensure it's set to the desired value
@@ -236,6 +288,127 @@ void kclock_set_quantum(uint8 quantum_in_ms)
 }
 //==============
 
+//=====================================
+// Tickless clock
+//=====================================
+//The quantums covered by a one-shot but the last one are not interrupted: account them
+//as if their clock interrupts had occurred
+static void kclock_account_skipped(uint32 nTicks)
+{
+	if (nTicks == 0)
+		return;
+	if (mycpu() == &CPUS[0])
+	{
+		ticks += nTicks;
+		Tickless.pendingMS += nTicks * mycpu()->quantum;
+	}
+	struct Env* p = mycpu()->proc;
+	if (p != NULL)
+		p->nClocks += nTicks;
+	Tickless.ticksAvoided += nTicks;
+}
+
+//Arm the clock of the current CPU (stopped till it's resumed, as kclock_set_quantum()) for the given
+//# of its quantums, as many as its counter can hold
+void kclock_stretch(uint16 nTicks)
+{
+	struct cpu* c = mycpu();
+	if (c->quantum == 0 || nTicks <= 1)
+		return;
+	if (kclock_on_ap())
+	{
+		lapic_timer_set_count(c->quantum * lapicTimerTicksPerMS * nTicks);
+	}
+	else
+	{
+		uint32 cnt = NUM_CLKS_PER_QUANTUM(c->quantum);
+		if (nTicks > 0xFFFF / cnt)
+			nTicks = 0xFFFF / cnt;
+		if (nTicks <= 1)
+			return;
+		outb(TIMER_MODE, KCLOCK_MODE);
+		kclock_write_cnt0_LSB_first(cnt * nTicks) ;
+		kclock_stop();
+	}
+	c->tickStretch = nTicks;
+	c->clockOff = 0;
+	Tickless.stretches++;
+}
+
+//Cut the stretched one-shot of the current CPU back to the end of its current quantum,
+//so it's interrupted as usual (e.g. an env has got ready)
+void kclock_unstretch()
+{
+	struct cpu* c = mycpu();
+	uint16 nTicks = c->tickStretch;
+	if (nTicks <= 1)
+		return;
+
+	uint32 perTick, remaining;
+	if (kclock_on_ap())
+	{
+		perTick = c->quantum * lapicTimerTicksPerMS;
+		remaining = lapic_timer_remaining();
+	}
+	else
+	{
+		perTick = NUM_CLKS_PER_QUANTUM(c->quantum);
+		remaining = kclock_read_cnt0_latch();
+		if (remaining > perTick * nTicks)
+			remaining = 0;	//it has fired (its interrupt is pending)
+	}
+	uint32 elapsed = perTick * nTicks - remaining;
+	uint32 passed = elapsed / perTick;
+	if (passed >= nTicks)
+		passed = nTicks - 1;	//the last one is accounted by the clock interrupt handler
+	uint32 rest = perTick - elapsed % perTick;
+	kclock_account_skipped(passed);
+	c->tickStretch = 1;
+
+	if (kclock_on_ap())
+	{
+		lapic_timer_set_remaining(rest);
+	}
+	else
+	{
+		outb(TIMER_MODE, KCLOCK_MODE);
+		kclock_write_cnt0_LSB_first(rest) ;
+	}
+}
+
+//An env has got ready on the given CPU: cut its stretched one-shot (if any), so the env
+//waits for a quantum at most
+void kclock_cut_stretch(int cpu)
+{
+	if (CPUS[cpu].tickStretch <= 1)
+		return;
+	if (&CPUS[cpu] == mycpu())
+		kclock_unstretch();
+	else
+		lapic_send_ipi(CPUS[cpu].apicid, T_IPI_RESCHED);
+}
+
+//Called by the clock interrupt handler of the current CPU: accounts the quantums covered by the
+//one-shot that has just fired but the last one (counted by the handler). Returns their total #
+uint16 kclock_fired()
+{
+	struct cpu* c = mycpu();
+	uint16 nTicks = c->tickStretch;
+	if (nTicks > 1)
+		kclock_account_skipped(nTicks - 1);
+	c->tickStretch = 1;
+	return nTicks;
+}
+
+//Tickless idle: stop the clock of the current CPU & keep it off (across the traps) till it's armed again
+void kclock_disarm()
+{
+	kclock_stop();
+	struct cpu* c = mycpu();
+	c->tickStretch = 1;
+	c->clockOff = 1;
+}
+
 
 //2017
 void
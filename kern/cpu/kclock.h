@@ -49,6 +49,24 @@ void kclock_write_cnt0_LSB_first(uint16 val);
 //2018
 void kclock_set_quantum(uint8 quantum_in_ms);
 
+//Tickless: the clock of each CPU is a one-shot armed for its next expiry only. It covers several
+//quantums while there's nothing else to run & it's not armed at all while the CPU is idle
+#define TICKLESS_MAX_TICKS 16			//max # of quantums covered by a single one-shot
+struct
+{
+	uint8 enabled;
+	uint32 stretches;					//one-shots armed for more than a quantum
+	uint32 ticksAvoided;				//clock interrupts saved by them
+	uint32 idleHalts;					//times an idle CPU is halted with its clock off
+	uint32 pendingMS;					//ms of the ticks skipped by the boot CPU, not given to the timer wheel yet
+} Tickless;
+
+void kclock_stretch(uint16 nTicks);
+void kclock_unstretch();
+void kclock_cut_stretch(int cpu);
+uint16 kclock_fired();
+void kclock_disarm();
+
 
 extern uint32 virtualTime;
 
@@ -0,0 +1,281 @@
+/*
+ * lapic.c
+ *
+ * Local APIC of each CPU: its ID, the inter-processor interrupts (IPIs)
+ * and its timer (the clock of the APs, the boot CPU keeps the PIT).
+ *
+ * Ref: xv6-x86 OS code & Intel SDM Vol. 3 (Chapter 10)
+ */
+
+#include "lapic.h"
+
+#include <inc/x86.h>
+#include <inc/memlayout.h>
+#include <inc/timerreg.h>
+#include <inc/isareg.h>
+#include <inc/trap.h>
+#include <inc/stdio.h>
+#include <inc/assert.h>
+#include <kern/cpu/cpu.h>
+#include <kern/cpu/kclock.h>
+#include <kern/cpu/picirq.h>
+
+//Local APIC registers, divided by 4 for use as uint32[] indices
+#define ID      (0x0020/4)   // ID
+#define VER     (0x0030/4)   // Version
+#define TPR     (0x0080/4)   // Task Priority
+#define EOI     (0x00B0/4)   // EOI
+#define SVR     (0x00F0/4)   // Spurious Interrupt Vector
+	#define ENABLE     0x00000100   // Unit Enable
+#define ESR     (0x0280/4)   // Error Status
+#define ICRLO   (0x0300/4)   // Interrupt Command
+	#define INIT       0x00000500   // INIT/RESET
+	#define STARTUP    0x00000600   // Startup IPI
+	#define DELIVS     0x00001000   // Delivery status
+	#define ASSERT     0x00004000   // Assert interrupt (vs deassert)
+	#define DEASSERT   0x00000000
+	#define LEVEL      0x00008000   // Level triggered
+	#define BCAST      0x00080000   // Send to all APICs, including self.
+	#define FIXED      0x00000000
+#define ICRHI   (0x0310/4)   // Interrupt Command [63:32]
+#define TIMER   (0x0320/4)   // Local Vector Table 0 (TIMER)
+	#define ONESHOT    0x00000000   // One-shot
+#define PCINT   (0x0340/4)   // Performance Counter LVT
+#define LINT0   (0x0350/4)   // Local Vector Table 1 (LINT0)
+#define LINT1   (0x0360/4)   // Local Vector Table 2 (LINT1)
+#define ERROR   (0x0370/4)   // Local Vector Table 3 (ERROR)
+	#define MASKED     0x00010000   // Interrupt masked
+#define TICR    (0x0380/4)   // Timer Initial Count
+#define TCCR    (0x0390/4)   // Timer Current Count
+#define TDCR    (0x03E0/4)   // Timer Divide Configuration
+	#define DIV16      0x00000003   // divide counts by 16
+
+#define CALIBRATION_MS 10
+#define CALIBRATION_MAX_POLLS 10000000
+
+static void lapicw(int index, uint32 value)
+{
+	lapic[index] = value;
+	lapic[ID];  // wait for write to finish, by reading
+}
+
+//Spin for about the given number of microseconds (each I/O to port 0x80 takes ~1 us)
+static void microdelay(int us)
+{
+	while (us-- > 0)
+		inb(0x80);
+}
+
+//Count the timer ticks of this local APIC during CALIBRATION_MS, measured by the channel 2 of the PIT
+//(its gate is controlled by port 0x61, so it doesn't disturb the channel 0 used as the clock)
+static uint32 lapic_timer_calibrate()
+{
+	uint16 cnt = TIMER_DIV(1000 / CALIBRATION_MS);
+
+	//gate of channel 2 low & speaker off while it's programmed
+	outb(IO_PPI, inb(IO_PPI) & ~0x03);
+	outb(TIMER_MODE, TIMER_SEL2 | TIMER_INTTC | TIMER_16BIT);
+	outb(TIMER_CNTR2, cnt & 0xFF);
+	outb(TIMER_CNTR2, cnt >> 8);
+
+	lapicw(TDCR, DIV16);
+	lapicw(TIMER, MASKED | ONESHOT | IRQ0_Clock);
+
+	//raise the gate to start counting down, OUT2 (bit 5 of port 0x61) goes high at the terminal count
+	outb(IO_PPI, (inb(IO_PPI) & ~0x02) | 0x01);
+	lapicw(TICR, 0xFFFFFFFF);
+	int polls = 0;
+	while ((inb(IO_PPI) & 0x20) == 0 && ++polls < CALIBRATION_MAX_POLLS) ;
+	uint32 elapsed = 0xFFFFFFFF - lapic[TCCR];
+	lapicw(TICR, 0);
+	outb(IO_PPI, inb(IO_PPI) & ~0x01);
+
+	if (polls >= CALIBRATION_MAX_POLLS || elapsed < CALIBRATION_MS)
+	{
+		cprintf("*	LAPIC: timer calibration failed, assuming %d ticks/ms\n", LAPIC_DEFAULT_TICKS_PER_MS);
+		return LAPIC_DEFAULT_TICKS_PER_MS;
+	}
+	return elapsed / CALIBRATION_MS;
+}
+
+//Initialize the local APIC of the current CPU (its registers are mapped by initialize_kernel_VM())
+void lapic_init()
+{
+	if (lapic_pa == 0)
+		return;
+	lapic = (volatile uint32*)LAPIC_VA;
+	int isBootCPU = (mycpu() == &CPUS[0]);
+
+	// Enable local APIC; set spurious interrupt vector.
+	lapicw(SVR, ENABLE | T_LAPIC_SPURIOUS);
+
+	// The boot CPU keeps receiving the interrupts of the 8259A PIC through its LINT0 (virtual wire),
+	// the APs only receive IPIs and their timer interrupts
+	if (!isBootCPU)
+		lapicw(LINT0, MASKED);
+	lapicw(LINT1, MASKED);
+
+	// Disable performance counter overflow interrupts
+	// on machines that provide that interrupt entry.
+	if (((lapic[VER]>>16) & 0xFF) >= 4)
+		lapicw(PCINT, MASKED);
+	lapicw(ERROR, MASKED);
+
+	// Clear error status register (requires back-to-back writes).
+	lapicw(ESR, 0);
+	lapicw(ESR, 0);
+
+	// Ack any outstanding interrupts.
+	lapicw(EOI, 0);
+
+	// Send an Init Level De-Assert to synchronise arbitration ID's.
+	lapicw(ICRHI, 0);
+	lapicw(ICRLO, BCAST | INIT | LEVEL);
+	while(lapic[ICRLO] & DELIVS) ;
+
+	// The timer is stopped till the scheduler sets the quantum of this CPU
+	if (isBootCPU)
+		lapicTimerTicksPerMS = lapic_timer_calibrate();
+	lapicw(TDCR, DIV16);
+	lapicw(TIMER, ONESHOT | IRQ0_Clock);
+	lapicw(TICR, 0);
+	mycpu()->timerRunning = 0;
+
+	// Enable interrupts on the APIC (but not on the processor).
+	lapicw(TPR, 0);
+}
+
+int lapic_id()
+{
+	if (lapic == NULL)
+		return 0;
+	return lapic[ID] >> 24;
+}
+
+// Acknowledge interrupt.
+void lapic_eoi()
+{
+	if (lapic)
+		lapicw(EOI, 0);
+}
+
+//Send the given interrupt vector to the CPU with the given APIC ID
+void lapic_send_ipi(int apicid, int vector)
+{
+	lapicw(ICRHI, apicid << 24);
+	lapicw(ICRLO, FIXED | ASSERT | vector);
+	while(lapic[ICRLO] & DELIVS) ;
+}
+
+// Start additional processor running entry code at addr.
+// See Appendix B of MultiProcessor Specification.
+void lapic_startap(int apicid, uint32 addr)
+{
+	int i;
+	uint16 *wrv;
+
+	// "The BSP must initialize CMOS shutdown code to 0AH
+	// and the warm reset vector (DWORD based at 40:67) to point at
+	// the AP startup code prior to the [universal startup algorithm]."
+	outb(IO_RTC, 0xF);  // offset 0xF is shutdown code
+	outb(IO_RTC+1, 0x0A);
+	wrv = (uint16*)(KERNEL_BASE + (0x40<<4 | 0x67));  // Warm reset vector
+	wrv[0] = 0;
+	wrv[1] = addr >> 4;
+
+	// "Universal startup algorithm."
+	// Send INIT (level-triggered) interrupt to reset other CPU.
+	lapicw(ICRHI, apicid<<24);
+	lapicw(ICRLO, INIT | LEVEL | ASSERT);
+	microdelay(200);
+	lapicw(ICRLO, INIT | LEVEL);
+	microdelay(100);    // should be 10ms, but too slow in Bochs!
+
+	// Send startup IPI (twice!) to enter code.
+	// Regular hardware is supposed to only accept a STARTUP
+	// when it is in the halted state due to an INIT.  So the second
+	// should be ignored, but it is part of the official Intel algorithm.
+	// Bochs complains about the second one.  Too bad for Bochs.
+	for(i = 0; i < 2; i++)
+	{
+		lapicw(ICRHI, apicid<<24);
+		lapicw(ICRLO, STARTUP | (addr>>12));
+		microdelay(200);
+	}
+}
+
+//=====================================
+// Timer (one-shot, counting quantums)
+//=====================================
+//Like the PIT of the boot CPU, the timer is stopped on entering a trap and resumed on leaving
+//it with the remaining count. Once it fires, it's resumed with the whole quantum
+
+//Set the quantum of the current CPU (the timer is left stopped)
+void lapic_timer_set_quantum(uint8 quantum_in_ms)
+{
+	struct cpu* c = mycpu();
+	lapicw(TICR, 0);
+	c->timerRunning = 0;
+	c->timerCount = quantum_in_ms * lapicTimerTicksPerMS;
+	c->timerRemaining = c->timerCount;
+}
+
+void lapic_timer_stop()
+{
+	struct cpu* c = mycpu();
+	if (!c->timerRunning)
+		return;
+	uint32 cnt = lapic[TCCR];
+	lapicw(TICR, 0);
+	c->timerRunning = 0;
+	c->timerRemaining = (cnt != 0) ? cnt : c->timerCount;
+}
+
+void lapic_timer_resume()
+{
+	struct cpu* c = mycpu();
+	if (c->timerCount == 0)
+		return;
+	uint32 cnt = c->timerRemaining;
+	if (cnt < LAPIC_TIMER_MIN_COUNT)
+		cnt = LAPIC_TIMER_MIN_COUNT;
+	lapicw(TIMER, ONESHOT | IRQ0_Clock);
+	lapicw(TICR, cnt);
+	c->timerRunning = 1;
+}
+
+//Arm the next expiry of the timer of the current CPU after the given count (it's left stopped),
+//then it's resumed with the whole quantum as usual (see kclock_stretch())
+void lapic_timer_set_count(uint32 count)
+{
+	struct cpu* c = mycpu();
+	if (c->timerCount == 0)
+		return;
+	lapicw(TICR, 0);
+	c->timerRunning = 0;
+	c->timerRemaining = count;
+}
+
+//Count remaining till the next expiry of the timer of the current CPU
+uint32 lapic_timer_remaining()
+{
+	struct cpu* c = mycpu();
+	if (c->timerRunning)
+		return lapic[TCCR];
+	return c->timerRemaining;
+}
+
+//Move the next expiry of the timer of the current CPU to the given count, keeping it running or stopped
+void lapic_timer_set_remaining(uint32 count)
+{
+	struct cpu* c = mycpu();
+	if (c->timerCount == 0)
+		return;
+	c->timerRemaining = count;
+	if (c->timerRunning)
+	{
+		if (count < LAPIC_TIMER_MIN_COUNT)
+			count = LAPIC_TIMER_MIN_COUNT;
+		lapicw(TICR, count);
+	}
+}
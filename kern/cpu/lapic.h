@@ -0,0 +1,38 @@
+/*
+ * lapic.h
+ *
+ * Local APIC of each CPU: its ID, the inter-processor interrupts (IPIs)
+ * and its timer (the clock of the APs, the boot CPU keeps the PIT).
+ */
+
+#ifndef FOS_KERN_LAPIC_H
+#define FOS_KERN_LAPIC_H
+#ifndef FOS_KERNEL
+# error "This is a FOS kernel header; user programs should not #include it"
+#endif
+
+#include <inc/types.h>
+
+#define LAPIC_TIMER_MIN_COUNT 100		//min count to resume the timer with (to avoid a clock interrupt inside a clock interrupt)
+#define LAPIC_DEFAULT_TICKS_PER_MS 10000	//used if the calibration against the PIT fails
+
+//Registers of the local APIC, mapped at LAPIC_VA (NULL till it's mapped, i.e. no MP tables are found)
+volatile uint32 *lapic;
+uint32 lapic_pa;						//its physical address (from the MP tables)
+uint32 lapicTimerTicksPerMS;			//timer counts per ms (calibrated by the boot CPU)
+
+void lapic_init();
+int lapic_id();
+void lapic_eoi();
+void lapic_send_ipi(int apicid, int vector);
+void lapic_startap(int apicid, uint32 addr);
+
+//Timer of the current CPU, with the same semantics as the PIT of the boot CPU (see kclock.c)
+void lapic_timer_set_quantum(uint8 quantum_in_ms);
+void lapic_timer_stop();
+void lapic_timer_resume();
+void lapic_timer_set_count(uint32 count);
+uint32 lapic_timer_remaining();
+void lapic_timer_set_remaining(uint32 count);
+
+#endif //FOS_KERN_LAPIC_H
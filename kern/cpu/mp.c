@@ -0,0 +1,409 @@
+/*
+ * mp.c
+ *
+ * Multi-processor support: finding the CPUs in the MP tables, starting the APs,
+ * waking up the idle CPUs and shooting down the stale TLB entries of the other CPUs.
+ *
+ * Each CPU runs its own fos_scheduler() on its own ready queues (see sched_helpers.c).
+ * The boot CPU keeps the PIT as its clock & receives all the device interrupts through
+ * the 8259A PIC, the APs are clocked by their local APIC timers.
+ *
+ * Ref: xv6-x86 OS code & MultiProcessor Specification v1.4
+ */
+
+#include "mp.h"
+
+#include <inc/x86.h>
+#include <inc/mmu.h>
+#include <inc/memlayout.h>
+#include <inc/string.h>
+#include <inc/trap.h>
+#include <inc/assert.h>
+#include <kern/cpu/cpu.h>
+#include <kern/cpu/lapic.h>
+#include <kern/cpu/sched.h>
+#include <kern/trap/trap.h>
+#include <kern/mem/boot_memory_manager.h>
+#include <kern/proc/user_environment.h>
+
+//=====================================
+// MP tables
+//=====================================
+struct mp {             		// floating pointer
+	uint8 signature[4];			// "_MP_"
+	uint32 physaddr;			// phys addr of MP config table
+	uint8 length;				// 1
+	uint8 specrev;				// [14]
+	uint8 checksum;				// all bytes must add up to 0
+	uint8 type;					// MP system config type
+	uint8 imcrp;
+	uint8 reserved[3];
+} __attribute__((packed));
+
+struct mpconf {         		// configuration table header
+	uint8 signature[4];			// "PCMP"
+	uint16 length;				// total table length
+	uint8 version;				// [14]
+	uint8 checksum;				// all bytes must add up to 0
+	uint8 product[20];			// product id
+	uint32 oemtable;			// OEM table pointer
+	uint16 oemlength;			// OEM table length
+	uint16 entry;				// entry count
+	uint32 lapicaddr;			// address of local APIC
+	uint16 xlength;				// extended table length
+	uint8 xchecksum;			// extended table checksum
+	uint8 reserved;
+} __attribute__((packed));
+
+struct mpproc {         		// processor table entry
+	uint8 type;					// entry type (0)
+	uint8 apicid;				// local APIC id
+	uint8 version;				// local APIC verison
+	uint8 flags;				// CPU flags
+	uint8 signature[4];			// CPU signature
+	uint32 feature;				// feature flags from CPUID instruction
+	uint8 reserved[8];
+} __attribute__((packed));
+
+// Table entry types
+#define MPPROC    0x00  // One per processor
+#define MPBUS     0x01  // One per bus
+#define MPIOAPIC  0x02  // One per I/O APIC
+#define MPIOINTR  0x03  // One per bus interrupt source
+#define MPLINTR   0x04  // One per system interrupt source
+
+#define MPPROC_ENABLED	0x01	// The processor is usable
+#define MPPROC_BOOT		0x02	// This proc is the bootstrap processor
+
+//The tables are read before the paging is turned on, while KERNEL_BASE+x is translated to x by the segments
+#define MP_KVA(pa) ((void*)(KERNEL_BASE + (uint32)(pa)))
+
+static uint8 sum(uint8 *addr, int len)
+{
+	int i, sum;
+	sum = 0;
+	for (i=0; i<len; i++)
+		sum += addr[i];
+	return sum;
+}
+
+// Look for an MP structure in the len bytes at addr.
+static struct mp* mpsearch1(uint32 a, int len)
+{
+	uint8 *e, *p, *addr;
+	addr = MP_KVA(a);
+	e = addr+len;
+	for(p = addr; p < e; p += sizeof(struct mp))
+		if(memcmp(p, "_MP_", 4) == 0 && sum(p, sizeof(struct mp)) == 0)
+			return (struct mp*)p;
+	return 0;
+}
+
+// Search for the MP Floating Pointer Structure, which according to the
+// spec is in one of the following three locations:
+// 1) in the first KB of the EBDA;
+// 2) in the last KB of system base memory;
+// 3) in the BIOS ROM between 0xE0000 and 0xFFFFF.
+static struct mp* mpsearch(void)
+{
+	uint8 *bda;
+	uint32 p;
+	struct mp *mp;
+
+	bda = MP_KVA(0x400);
+	if((p = ((bda[0x0F]<<8)| bda[0x0E]) << 4)){
+		if((mp = mpsearch1(p, 1024)))
+			return mp;
+	} else {
+		p = ((bda[0x14]<<8)|bda[0x13])*1024;
+		if((mp = mpsearch1(p-1024, 1024)))
+			return mp;
+	}
+	return mpsearch1(0xF0000, 0x10000);
+}
+
+// Search for an MP configuration table.  For now,
+// don't accept the default configurations (physaddr == 0).
+// Check for correct signature, calculate the checksum and,
+// if correct, check the version.
+static struct mpconf* mpconfig(struct mp **pmp)
+{
+	struct mpconf *conf;
+	struct mp *mp;
+
+	if((mp = mpsearch()) == 0 || mp->physaddr == 0)
+		return 0;
+	conf = (struct mpconf*) MP_KVA(mp->physaddr);
+	if(memcmp(conf, "PCMP", 4) != 0)
+		return 0;
+	if(conf->version != 1 && conf->version != 4)
+		return 0;
+	if(sum((uint8*)conf, conf->length) != 0)
+		return 0;
+	*pmp = mp;
+	return conf;
+}
+
+//Find the CPUs: the boot one at CPUS[0] and the (enabled) APs after it.
+//Without MP tables (or with a single CPU) the kernel runs on the boot CPU only, as before
+void mp_init()
+{
+	struct mp *mp;
+	struct mpconf *conf;
+	uint8 *p, *e;
+
+	ncpu = 1;
+	apsStarted = 0;
+	init_spinlock(&TLBShootdown.lock, "TLB shootdown lock");
+	if ((conf = mpconfig(&mp)) == 0)
+		return;
+
+	int n = 1;
+	for (p = (uint8*)(conf+1), e = (uint8*)conf+conf->length; p < e; )
+	{
+		switch(*p)
+		{
+		case MPPROC:
+		{
+			struct mpproc *proc = (struct mpproc*)p;
+			if (proc->flags & MPPROC_BOOT)
+				CPUS[0].apicid = proc->apicid;
+			else if ((proc->flags & MPPROC_ENABLED) && n < NCPUS)
+				CPUS[n++].apicid = proc->apicid;
+			p += sizeof(struct mpproc);
+			continue;
+		}
+		case MPBUS:
+		case MPIOAPIC:
+		case MPIOINTR:
+		case MPLINTR:
+			p += 8;
+			continue;
+		default:
+			//unknown entry: don't trust the tables
+			return;
+		}
+	}
+	if (n == 1)
+		return;
+
+	ncpu = n;
+	lapic_pa = conf->lapicaddr;
+	if (mp->imcrp)
+	{
+		// Bochs doesn't support IMCR, so this doesn't run on Bochs.
+		// But it would on real hardware: route the PIC interrupts through the local APIC.
+		outb(0x22, 0x70);   // Select IMCR
+		outb(0x23, inb(0x23) | 1);  // Mask external interrupts.
+	}
+}
+
+//=====================================
+// Starting the APs
+//=====================================
+//Used by the AP startup code (mpentry.S)
+uint32 mpentry_kstack;		//top of its scheduler stack
+uint32 mpentry_cr3;			//the kernel page directory
+int mpentry_cpu;			//its index in CPUS[]
+
+#define AP_START_TIMEOUT 1000000	//polls (~1 us each) to wait for an AP to start
+
+void boot_aps()
+{
+	extern uint8 mpentry_start[], mpentry_end[];
+	if (ncpu <= 1)
+		return;
+
+	//the APs start in real mode at MPENTRY_PADDR, so copy the startup code there
+	memmove(MP_KVA(MPENTRY_PADDR), mpentry_start, mpentry_end - mpentry_start);
+
+	//they turn on the paging while running at its low address: alias it till they jump into the
+	//kernel (as in turn_on_paging())
+	ptr_page_directory[0] = ptr_page_directory[PDX(KERNEL_BASE)];
+	mpentry_cr3 = phys_page_directory;
+	for (int i = 1; i < ncpu; i++)
+	{
+		mpentry_cpu = i;
+		mpentry_kstack = KERN_STACK_TOP - i * KERNEL_STACK_SIZE;
+		lapic_startap(CPUS[i].apicid, MPENTRY_PADDR);
+
+		//wait till it's running on its own stack in the kernel (see cpu_init())
+		int polls = 0;
+		while (CPUS[i].started == 0 && ++polls < AP_START_TIMEOUT)
+			inb(0x80);
+		if (CPUS[i].started == 0)
+		{
+			cprintf("*	CPU #%d (APIC ID %d) did not start, the next CPUs are not used\n", i, CPUS[i].apicid);
+			ncpu = i;
+			break;
+		}
+		cprintf("*	CPU #%d (APIC ID %d) is started\n", i, CPUS[i].apicid);
+	}
+	ptr_page_directory[0] = 0;
+	lcr3(phys_page_directory);
+	apsStarted = (ncpu > 1);
+}
+
+//Reload the GDT of this CPU & all the segment registers (as in turn_on_paging())
+static void load_gdt()
+{
+	lgdt(mycpu()->gdt, sizeof(mycpu()->gdt));
+	asm volatile("movw %%ax,%%gs" :: "a" (GD_UD|3));
+	asm volatile("movw %%ax,%%fs" :: "a" (GD_UD|3));
+	asm volatile("movw %%ax,%%es" :: "a" (GD_KD));
+	asm volatile("movw %%ax,%%ds" :: "a" (GD_KD));
+	asm volatile("movw %%ax,%%ss" :: "a" (GD_KD));
+	asm volatile("ljmp %0,$1f\n 1:\n" :: "i" (GD_KT));  // reload cs
+	asm volatile("lldt %%ax" :: "a" (0));
+}
+
+//Called by mpentry.S on the stack of the AP (interrupts are disabled)
+void mp_main()
+{
+	cpu_init(mpentry_cpu);
+	load_gdt();
+	ts_init();
+	lapic_init();
+
+	//run the scheduler of this CPU: it's idle till it finds (or steals) a ready env
+	fos_scheduler();
+}
+
+//=====================================
+// Waking up the idle CPUs
+//=====================================
+//A CPU is idle if it's in its scheduler with no env to run
+int mp_cpu_is_idle(int cpu)
+{
+	struct cpu* c = &CPUS[cpu];
+	return c->started && c->scheduler_status == SCH_STARTED && c->proc == NULL;
+}
+
+//Wake up an idle CPU to run the env that has just been made ready on the given CPU:
+//that CPU itself if it's idle, otherwise another idle one (it'll steal the env).
+//Called with the qlock held
+void mp_kick_idle_cpu(int cpu)
+{
+	if (!apsStarted)
+		return;
+	int me = mycpu_index();
+	int target = -1;
+	if (cpu != me && mp_cpu_is_idle(cpu))
+	{
+		target = cpu;
+	}
+	else
+	{
+		for (int c = 0; c < ncpu; c++)
+		{
+			if (c != me && c != cpu && mp_cpu_is_idle(c))
+			{
+				target = c;
+				break;
+			}
+		}
+	}
+	if (target < 0)
+		return;
+	MPStats.kicks++;
+	lapic_send_ipi(CPUS[target].apicid, T_IPI_RESCHED);
+}
+
+//Interrupt the given (other) CPU, whether it's idle or running an env: the env traps into the
+//kernel, so it notices a pending kill on its way back (see sched_kill_env())
+void mp_kick_cpu(int cpu)
+{
+	if (!apsStarted || cpu == mycpu_index())
+		return;
+	MPStats.kicks++;
+	lapic_send_ipi(CPUS[cpu].apicid, T_IPI_RESCHED);
+}
+
+//=====================================
+// TLB shootdown
+//=====================================
+//Invalidate the given page (or the whole TLB) on the other CPUs that may cache its mapping
+//in the given page directory (NULL = the current address space). The kernel mappings are shared
+//by all the page directories, the user ones are cached only by the CPU that runs the env
+void tlb_shootdown(uint32* page_directory, uint32 va)
+{
+	if (!apsStarted)
+		return;
+
+	pushcli();	//stay on this CPU
+	{
+		int me = mycpu_index();
+		if (page_directory == NULL)
+		{
+			struct Env* cur_env = get_cpu_proc();
+			page_directory = cur_env != NULL ? cur_env->env_page_directory : ptr_page_directory;
+		}
+		int allCPUs = (va != TLB_FLUSH_ALL && va >= USER_LIMIT) || page_directory == ptr_page_directory;
+
+		acquire_spinlock(&TLBShootdown.lock);
+		uint32 targets = 0;
+		for (int c = 0; c < ncpu; c++)
+		{
+			struct Env* p = CPUS[c].proc;
+			if (c == me || !CPUS[c].started)
+				continue;
+			if (!allCPUs && (p == NULL || p->env_page_directory != page_directory))
+				continue;
+			//the boot CPU may be at the command prompt (maybe with the interrupt disabled): don't wait for it
+			if (CPUS[c].scheduler_status != SCH_STARTED)
+			{
+				TLBShootdown.deferred |= 1 << c;
+				continue;
+			}
+			targets |= 1 << c;
+		}
+		if (targets != 0)
+		{
+			TLBShootdown.va = va;
+			TLBShootdown.pending = targets;
+			for (int c = 0; c < ncpu; c++)
+			{
+				if (targets & (1 << c))
+				{
+					lapic_send_ipi(CPUS[c].apicid, T_IPI_TLB);
+					TLBShootdown.ipis++;
+				}
+			}
+			while (TLBShootdown.pending != 0)
+				pause();
+			TLBShootdown.shootdowns++;
+		}
+		release_spinlock(&TLBShootdown.lock);
+	}
+	popcli();
+}
+
+//Serve the pending shootdown (if any) of the current CPU. Called by its IPI handler and while
+//spinning on a lock (with the interrupt disabled)
+void tlb_shootdown_poll()
+{
+	if (TLBShootdown.pending == 0)
+		return;
+	uint32 bit = 1 << mycpu_index();
+	if ((TLBShootdown.pending & bit) == 0)
+		return;
+	if (TLBShootdown.va == TLB_FLUSH_ALL)
+		lcr3(rcr3());
+	else
+		invlpg((void*)TLBShootdown.va);
+	__sync_fetch_and_and(&TLBShootdown.pending, ~bit);
+}
+
+//Flush the TLB of the current CPU if it missed shootdowns while it was outside its scheduler
+void tlb_flush_deferred()
+{
+	if (!apsStarted)
+		return;
+	uint32 bit = 1 << mycpu_index();
+	acquire_spinlock(&TLBShootdown.lock);
+	int flush = (TLBShootdown.deferred & bit) != 0;
+	TLBShootdown.deferred &= ~bit;
+	release_spinlock(&TLBShootdown.lock);
+	if (flush)
+		lcr3(rcr3());
+}
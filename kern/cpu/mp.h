@@ -0,0 +1,55 @@
+/*
+ * mp.h
+ *
+ * Multi-processor support: finding the CPUs in the MP tables, starting the APs,
+ * waking up the idle CPUs and shooting down the stale TLB entries of the other CPUs.
+ */
+
+#ifndef FOS_KERN_MP_H
+#define FOS_KERN_MP_H
+#ifndef FOS_KERNEL
+# error "This is a FOS kernel header; user programs should not #include it"
+#endif
+
+#include <inc/types.h>
+#include <inc/stdio.h>
+#include <kern/conc/spinlock.h>
+
+#define TLB_FLUSH_ALL 0xFFFFFFFF		//flush the whole TLB instead of a single page
+
+uint8 apsStarted;						//the APs are running their schedulers
+
+///=============================================================================================
+//One shootdown at a time: the initiator sends an IPI to each CPU that may cache the changed
+//mapping and waits till they all invalidate it. A CPU that's spinning on a lock (maybe held by
+//the initiator) serves the pending shootdown from its spin loop, so it can't deadlock
+struct
+{
+	uint32 va;						//page to invalidate (or TLB_FLUSH_ALL)
+	volatile uint32 pending;		//a bit per CPU that has not invalidated it yet
+	uint32 deferred;				//a bit per CPU outside its scheduler: it flushes its TLB on entering it
+	uint32 shootdowns;				//stats
+	uint32 ipis;
+	struct spinlock lock;			//protects all the above (except pending)
+} TLBShootdown;
+
+struct
+{
+	uint32 kicks;					//resched IPIs sent to the idle CPUs
+	uint32 steals;					//ready envs moved from a busy CPU to an idle one
+} MPStats;
+
+///=============================================================================================
+void mp_init();
+void boot_aps();
+void mp_main();
+
+void mp_kick_idle_cpu(int cpu);
+void mp_kick_cpu(int cpu);
+int mp_cpu_is_idle(int cpu);
+
+void tlb_shootdown(uint32* page_directory, uint32 va);
+void tlb_shootdown_poll();
+void tlb_flush_deferred();
+
+#endif //FOS_KERN_MP_H
@@ -1,6 +1,7 @@
 #include "sched.h"
 
 #include <inc/assert.h>
+#include <inc/x86.h>
 
 #include <kern/proc/user_environment.h>
 #include <kern/trap/trap.h>
@@ -10,12 +11,18 @@
 #include <kern/cmd/command_prompt.h>
 #include <kern/cpu/cpu.h>
 #include <kern/cpu/picirq.h>
+#include <kern/cpu/mp.h>
+#include <kern/cpu/kclock.h>
+#include <kern/cpu/timer_wheel.h>
+#include <kern/cpu/sched_edf.h>
+#include <kern/cpu/sched_stats.h>
 
 
 uint32 isSchedMethodRR(){return (scheduler_method == SCH_RR);}
 uint32 isSchedMethodMLFQ(){return (scheduler_method == SCH_MLFQ); }
 uint32 isSchedMethodBSD(){return(scheduler_method == SCH_BSD); }
 uint32 isSchedMethodPRIRR(){return(scheduler_method == SCH_PRIRR); }
+uint32 isSchedMethodSTRIDE(){return(scheduler_method == SCH_STRIDE); }
 
 //===================================================================================//
 //============================ SCHEDULER FUNCTIONS ==================================//
@@ -25,9 +32,108 @@ static struct Env* (*sched_next[])(void) = {
 [SCH_MLFQ]  fos_scheduler_MLFQ,
 [SCH_BSD]   fos_scheduler_BSD,
 [SCH_PRIRR]   fos_scheduler_PRIRR,
+[SCH_STRIDE]  fos_scheduler_STRIDE,
 
 };
 
+//The next env can run for several quantums without a clock interrupt in between if nothing else can
+//preempt it: no other ready env (one that gets ready cuts the stretch, see kclock_cut_stretch()) and
+//nothing to do on each tick (the BSD statistics, the LRU time stamps & the MLFQ demotion, unless the
+//env is already at the lowest level)
+static int sched_can_stretch(struct Env* next_env)
+{
+	if (!Tickless.enabled || sched_num_of_ready() != 0)
+		return 0;
+	//the budgets & the releases of the real-time envs are driven by the clock
+	if (EDF.numOfEnvs > 0)
+		return 0;
+	if (isPageReplacmentAlgorithmLRU(PG_REP_LRU_TIME_APPROX))
+		return 0;
+	if (isSchedMethodRR() || isSchedMethodPRIRR() || isSchedMethodSTRIDE())
+		return 1;
+	if (isSchedMethodMLFQ())
+		return next_env->priority == num_of_ready_queues - 1;
+	return 0;
+}
+
+//Directed yield (see yield_to()): the env that the curenv has donated the rest of its quantum to,
+//if it's still ready. It bypasses the policy of the current scheduler: the curenv goes back to its
+//ready queue as is & the clock is not reset, so the donated env runs for the rest of the quantum
+static struct Env* sched_directed_next()
+{
+	struct cpu* c = mycpu();
+	struct Env* next_env = c->yieldTo;
+	c->yieldTo = NULL;
+	if (next_env == NULL)
+		return NULL;
+	if (next_env->env_status != ENV_READY || next_env == c->proc)
+	{
+		DirectedYield.misses++;
+		return NULL;
+	}
+	sched_remove_ready(next_env);
+	struct Env* cur_env = get_cpu_proc();
+	if (cur_env != NULL)
+		sched_insert_ready(cur_env);
+	DirectedYield.handoffs++;
+	return next_env;
+}
+
+//Max # of quantums to stretch the clock of the current CPU by. The clock of the boot CPU drives the
+//timer wheel, so it's not stretched past the next deadline of a sleeping env (the qlock must be held)
+static uint16 sched_max_stretch()
+{
+	struct cpu* c = mycpu();
+	if (c != &CPUS[0] || c->quantum == 0)
+		return TICKLESS_MAX_TICKS;
+	uint32 next = timer_wheel_next_expiry();
+	if (next == TW_NO_EXPIRY)
+		return TICKLESS_MAX_TICKS;
+	uint32 nTicks = (next + c->quantum - 1) / c->quantum;
+	return nTicks < TICKLESS_MAX_TICKS ? nTicks : TICKLESS_MAX_TICKS;
+}
+
+//Halt the current CPU till an interrupt (interrupts are disabled on calling it, & on return).
+//Its clock is kept off meanwhile, except on the boot CPU while any other CPU runs an env, as
+//it drives the global ticks, or while any env sleeps, as it drives the timer wheel (stretched
+//till its next deadline then)
+static void sched_idle()
+{
+	struct cpu* c = mycpu();
+	int othersBusy = 0;
+	if (c == &CPUS[0])
+	{
+		for (int i = 1; i < ncpu; i++)
+		{
+			if (CPUS[i].proc != NULL)
+			{
+				othersBusy = 1;
+				break;
+			}
+		}
+	}
+	if (othersBusy || (c == &CPUS[0] && (TimerWheel.numOfSleepers > 0 || EDF.numOfEnvs > 0)))
+	{
+		if (c->clockOff && c->quantum > 0)
+			kclock_set_quantum(c->quantum);
+		if (!othersBusy && EDF.numOfEnvs == 0 && Tickless.enabled && c->tickStretch <= 1)
+		{
+			acquire_spinlock(&ProcessQueues.qlock);
+			kclock_stretch(sched_max_stretch());
+			release_spinlock(&ProcessQueues.qlock);
+		}
+		kclock_resume();
+	}
+	else
+	{
+		kclock_disarm();
+		Tickless.idleHalts++;
+	}
+	sti_hlt();
+	cli();
+	kclock_stop();
+}
+
 //===================================
 // [1] Default Scheduler Initializer:
 //===================================
@@ -36,6 +142,8 @@ void sched_init()
 	old_pf_counter = 0;
 
 	sched_init_RR(INIT_QUANTUM_IN_MS);
+	timer_wheel_init();
+	sched_init_EDF();
 
 	init_queue(&ProcessQueues.env_new_queue);
 	init_queue(&ProcessQueues.env_exit_queue);
@@ -62,9 +170,19 @@ fos_scheduler(void)
 	struct cpu *c = mycpu();
 	c->proc = 0;
 
+	//the TLB of this CPU may be stale if it has missed shootdowns while it was out of its scheduler
+	tlb_flush_deferred();
+
 	chk1();
 	c->scheduler_status = SCH_STARTED;
 
+	//wake up the idle APs to run (or steal) the ready envs
+	if (c == &CPUS[0])
+	{
+		for (int i = 1; i < ncpu; i++)
+			mp_kick_idle_cpu(i);
+	}
+
 	//This variable should be set to the next environment to be run (if any)
 	struct Env* next_env = NULL;
 
@@ -84,8 +202,20 @@ fos_scheduler(void)
 		//cprintf("ACQUIRED\n");
 		do
 		{
-			//Get next env according to the current scheduler
-			next_env = sched_next[scheduler_method]() ;
+			//Get next env according to the current scheduler.
+			//The APs run envs only while the scheduler of the boot CPU is started (i.e. not at the command prompt).
+			//A CPU without ready envs steals one from the busiest CPU
+			next_env = NULL;
+			if (c == &CPUS[0] || CPUS[0].scheduler_status == SCH_STARTED)
+			{
+				next_env = sched_directed_next();
+				if (next_env == NULL)
+					next_env = sched_next_EDF();
+				if (next_env == NULL)
+					next_env = sched_next[scheduler_method]() ;
+				if (next_env == NULL && ncpu > 1 && sched_steal_ready())
+					next_env = sched_next[scheduler_method]() ;
+			}
 
 			//temporarily set the curenv by the next env JUST for checking the scheduler
 			//Then: reset it again
@@ -110,6 +240,17 @@ fos_scheduler(void)
 
 				//Change its status to RUNNING
 				next_env->env_status = ENV_RUNNING;
+				next_env->cpu = mycpu_index();
+
+				//Tickless: arm the clock for several quantums if nothing else can preempt it
+				//(a stretch armed while this CPU was idle is cut back to a single quantum first)
+				if (c->clockOff && c->quantum > 0)
+					kclock_set_quantum(c->quantum);
+				kclock_unstretch();
+				if (sched_can_stretch(next_env))
+					kclock_stretch(sched_max_stretch());
+
+				sched_stat_dispatch(next_env);
 
 				//Context switch to it
 				context_switch(&(c->scheduler), next_env->context);
@@ -121,6 +262,7 @@ fos_scheduler(void)
 				//Stop the clock now till finding a next proc (if any).
 				//This is to avoid clock interrupt inside the scheduler after sti() of the outer loop
 				kclock_stop();
+				sched_stat_leave(c->proc);
 				//cprintf("\n[IEN = %d] clock is stopped! returned to scheduler after context_switch. curenv = %d\n", (read_eflags() & FL_IF) == 0? 0:1, curenv == NULL? 0 : curenv->env_id);
 
 				// Process is done running for now. It should have changed its p->status before coming back.
@@ -140,12 +282,15 @@ fos_scheduler(void)
 				}
 			}
 		} while(next_env);
+		sched_stat_idle();
 
 		//2024 - check if there's any blocked process?
+		//(with multiple CPUs, the ready & running envs of the other CPUs are waited for as well)
 		is_any_blocked = 0;
 		for (int i = 0; i < NENV; ++i)
 		{
-			if (envs[i].env_status == ENV_BLOCKED)
+			if (envs[i].env_status == ENV_BLOCKED ||
+					(ncpu > 1 && (envs[i].env_status == ENV_READY || envs[i].env_status == ENV_RUNNING)))
 			{
 				is_any_blocked = 1;
 				break;
@@ -154,7 +299,17 @@ fos_scheduler(void)
 		release_spinlock(&ProcessQueues.qlock);  //release lock: to protect ready & blocked Qs in multi-CPU
 		//cprintf("\n[FOS_SCHEDULER] release: lock status after = %d\n", qlock.locked);
 
-	} while (is_any_blocked > 0);
+		//Halt the idle CPU till an interrupt, e.g. a kick by the CPU that makes an env ready or the
+		//device that a blocked env waits for (see sched_idle())
+		if (is_any_blocked > 0 || c != &CPUS[0])
+		{
+			cli();
+			if (sched_num_of_ready() == 0 || (c != &CPUS[0] && CPUS[0].scheduler_status != SCH_STARTED))
+			{
+				sched_idle();
+			}
+		}
+	} while (is_any_blocked > 0 || c != &CPUS[0]);	//the APs never leave their schedulers
 
 	/*2015*///No more envs... curenv doesn't exist any more! return back to command prompt
 	{
@@ -174,7 +329,7 @@ void sched_init_RR(uint8 quantum)
 	num_of_ready_queues = 1;
 #if USE_KHEAP
 	sched_delete_ready_queues();
-	ProcessQueues.env_ready_queues = kmalloc(sizeof(struct Env_Queue));
+	ProcessQueues.env_ready_queues = kmalloc(NCPUS * sizeof(struct Env_Queue));
 	//cprintf("sizeof(struct Env_Queue) = %x\n", sizeof(struct Env_Queue));
 	quantums = kmalloc(num_of_ready_queues * sizeof(uint8)) ;
 	//cprintf("num_of_ready_queues * sizeof(uint8) = %x\n", num_of_ready_queues * sizeof(uint8));
@@ -182,7 +337,8 @@ void sched_init_RR(uint8 quantum)
 #endif
 	quantums[0] = quantum;
 	kclock_set_quantum(quantums[0]);
-	init_queue(&(ProcessQueues.env_ready_queues[0]));
+	for (int c = 0; c < NCPUS; c++)
+		init_queue(READY_QUEUE(c, 0));
 	//=========================================
 	//DON'T CHANGE THESE LINES=================
 	uint16 cnt0 = kclock_read_cnt0_latch() ; //read after write to ensure it's set to the desired value
@@ -203,11 +359,20 @@ void sched_init_MLFQ(uint8 numOfLevels, uint8 *quantumOfEachLevel)
 	sched_delete_ready_queues();
 	//=========================================
 	//=========================================
-	//[PROJECT] MLFQ Scheduler - sched_init_MLFQ
-	//Your code is here
-	//Comment the following line
-	panic("Not implemented yet");
-
+	num_of_ready_queues = numOfLevels;
+#if USE_KHEAP
+	ProcessQueues.env_ready_queues = kmalloc(NCPUS*num_of_ready_queues*sizeof(struct Env_Queue));
+	quantums = kmalloc(num_of_ready_queues * sizeof(uint8)) ;
+	for(uint8 i = 0; i < num_of_ready_queues; i++)
+	{
+		for (int c = 0; c < NCPUS; c++)
+			init_queue(READY_QUEUE(c, i));
+		quantums[i] = quantumOfEachLevel[i];
+	}
+#endif
+	mlfqBoostPeriod_ = MLFQ_DEFAULT_BOOST_PERIOD_IN_MS;
+	mlfqLastBoostMS_ = TimerWheel.now;
+	kclock_set_quantum(quantums[0]);
 
 	//=========================================
 	//DON'T CHANGE THESE LINES=================
@@ -225,11 +390,23 @@ void sched_init_MLFQ(uint8 numOfLevels, uint8 *quantumOfEachLevel)
 //===============================
 void sched_init_BSD(uint8 numOfLevels, uint8 quantum)
 {
-	//[PROJECT] BSD Scheduler - sched_init_BSD
-	//Your code is here
-	//Comment the following line
-	panic("Not implemented yet");
-
+	//the priorities [PRI_MIN, PRI_MAX] are spread over the given levels (one per priority for 64 levels)
+	num_of_ready_queues = numOfLevels;
+	sched_delete_ready_queues();
+#if USE_KHEAP
+	ProcessQueues.env_ready_queues = kmalloc(NCPUS*num_of_ready_queues*sizeof(struct Env_Queue));
+	quantums = kmalloc(num_of_ready_queues * sizeof(uint8)) ;
+	for(uint8 i = 0; i < num_of_ready_queues; i++)
+	{
+		for (int c = 0; c < NCPUS; c++)
+			init_queue(READY_QUEUE(c, i));
+		quantums[i] = quantum;
+	}
+#endif
+	load_avg = fix_int(0);
+	bsdTicksPerSec_ = quantum > 0 && quantum < 1000 ? 1000 / quantum : 1;
+	bsdSecTicks_ = 0;
+	kclock_set_quantum(quantum);
 
 	//=========================================
 	//DON'T CHANGE THESE LINES=================
@@ -248,13 +425,15 @@ void sched_init_PRIRR(uint8 numOfPriorities, uint8 quantum, uint32 starvThresh)
 {
 	num_of_ready_queues = numOfPriorities;
 	starvThresh_ = starvThresh;
+	nextAgingTick_ = 0;
 	sched_delete_ready_queues();
 #if USE_KHEAP
-	ProcessQueues.env_ready_queues = kmalloc(num_of_ready_queues*sizeof(struct Env_Queue));
+	ProcessQueues.env_ready_queues = kmalloc(NCPUS*num_of_ready_queues*sizeof(struct Env_Queue));
 	quantums = kmalloc(num_of_ready_queues * sizeof(uint8)) ;
 	for(uint8 i = 0; i < num_of_ready_queues; i++)
 	{
-		init_queue(&(ProcessQueues.env_ready_queues[i]));
+		for (int c = 0; c < NCPUS; c++)
+			init_queue(READY_QUEUE(c, i));
 		quantums[i] = quantum;
 	}
 #endif
@@ -269,6 +448,32 @@ void sched_init_PRIRR(uint8 numOfPriorities, uint8 quantum, uint32 starvThresh)
 	//=========================================
 }
 
+//=====================================
+// [6.1] Initialize STRIDE Scheduler:
+//=====================================
+void sched_init_STRIDE(uint8 quantum)
+{
+	//1 ready queue per CPU (its order is kept by the stride heap of the CPU)
+	num_of_ready_queues = 1;
+	sched_delete_ready_queues();
+#if USE_KHEAP
+	ProcessQueues.env_ready_queues = kmalloc(NCPUS * sizeof(struct Env_Queue));
+	quantums = kmalloc(num_of_ready_queues * sizeof(uint8)) ;
+#endif
+	quantums[0] = quantum;
+	kclock_set_quantum(quantums[0]);
+	for (int c = 0; c < NCPUS; c++)
+		init_queue(READY_QUEUE(c, 0));
+	//=========================================
+	//DON'T CHANGE THESE LINES=================
+	uint16 cnt0 = kclock_read_cnt0_latch() ; //read after write to ensure it's set to the desired value
+	cprintf("*	STRIDE scheduler with initial clock = %d\n", cnt0);
+	mycpu()->scheduler_status = SCH_STOPPED;
+	scheduler_method = SCH_STRIDE;
+	//=========================================
+	//=========================================
+}
+
 //=========================
 // [7] RR Scheduler:
 //=========================
@@ -288,11 +493,11 @@ struct Env* fos_scheduler_RR()
 	//If the curenv is still exist, then insert it again in the ready queue
 	if (cur_env != NULL)
 	{
-		enqueue(&(ProcessQueues.env_ready_queues[0]), cur_env);
+		sched_ready_enqueue(0, cur_env);
 	}
 
 	//Pick the next environment from the ready queue
-	next_env = dequeue(&(ProcessQueues.env_ready_queues[0]));
+	next_env = sched_ready_dequeue(0);
 
 	//Reset the quantum
 	//2017: Reset the value of CNT0 for the next clock interval
@@ -315,11 +520,26 @@ struct Env* fos_scheduler_MLFQ()
 		panic("fos_scheduler_MLFQ: q.lock is not held by this CPU while it's expected to be.");
 	/****************************************************************************************/
 
-	//[PROJECT] MLFQ Scheduler - fos_scheduler_MLFQ
-	//Your code is here
-	//Comment the following line
-	panic("Not implemented yet");
+	//The level of an env is kept in its priority.
+	//The curenv (if any) is back while READY only if it was preempted by the clock, i.e. it used
+	//its whole quantum, so it's demoted one level. An env that blocks is not back here (its
+	//curenv is reset), and it's inserted again at the same level when it's woken up
+	struct Env *next_env = NULL;
+	struct Env *cur_env = get_cpu_proc();
+	if (cur_env != NULL)
+	{
+		if (cur_env->priority < num_of_ready_queues - 1)
+			cur_env->priority++;
+		cur_env->env_status = ENV_READY ;
+		sched_ready_enqueue(cur_env->priority, cur_env);
+	}
+
+	int level = sched_highest_ready_level();
+	if (level < 0) return NULL;
 
+	next_env = sched_ready_dequeue(level);
+	kclock_set_quantum(quantums[level]);
+	return next_env;
 }
 
 //=========================
@@ -332,11 +552,22 @@ struct Env* fos_scheduler_BSD()
 		panic("fos_scheduler_BSD: q.lock is not held by this CPU while it's expected to be.");
 	/****************************************************************************************/
 
-	//[PROJECT] BSD Scheduler - fos_scheduler_BSD
-	//Your code is here
-	//Comment the following line
-	panic("Not implemented yet");
+	//The priority of the curenv is kept up to date by the clock handler, so it's
+	//inserted at its current level. Then pick the head of the highest non-empty level
+	struct Env *next_env = NULL;
+	struct Env *cur_env = get_cpu_proc();
+	if (cur_env != NULL)
+	{
+		cur_env->env_status = ENV_READY ;
+		sched_ready_enqueue(sched_bsd_level(cur_env->priority), cur_env);
+	}
 
+	int level = sched_highest_ready_level();
+	if (level < 0) return NULL;
+
+	next_env = sched_ready_dequeue(level);
+	kclock_set_quantum(quantums[level]);
+	return next_env;
 }
 //=============================
 // [10] PRIORITY RR Scheduler:
@@ -354,22 +585,44 @@ struct Env* fos_scheduler_PRIRR()
 	if (cur_env != NULL)
 	{
 		cur_env->env_status = ENV_READY ;
-		enqueue(&(ProcessQueues.env_ready_queues[cur_env->priority]), cur_env);
+		sched_ready_enqueue(cur_env->priority, cur_env);
 	}
 
-	int8 cur_priority = 0;
-	for(; cur_priority < num_of_ready_queues ; cur_priority++)
+	//highest non-empty priority from the bitmap (regardless of the number of priorities)
+	int cur_priority = sched_highest_ready_level();
+	if (cur_priority < 0) return NULL;
+
+	//Pick the next environment from the ready queue
+	next_env = sched_ready_dequeue(cur_priority);
+	kclock_set_quantum(quantums[cur_priority]);
+	return next_env;
+}
+
+//=============================
+// [10.1] STRIDE Scheduler:
+//=============================
+struct Env* fos_scheduler_STRIDE()
+{
+	/*To protect process Qs (or info of current process) in multi-CPU************************/
+	if(!holding_spinlock(&ProcessQueues.qlock))
+		panic("fos_scheduler_STRIDE: q.lock is not held by this CPU while it's expected to be.");
+	/****************************************************************************************/
+
+	struct Env *next_env = NULL;
+	struct Env *cur_env = get_cpu_proc();
+	//If the curenv is still exist, then insert it again in the ready queue (by its pass)
+	if (cur_env != NULL)
 	{
-		// if queue[i] not empty dequeue from it
-		if(queue_size(&(ProcessQueues.env_ready_queues[cur_priority])))
-			break;
+		sched_ready_enqueue(0, cur_env);
 	}
 
-	if( cur_priority >= num_of_ready_queues ) return NULL;
+	//Pick the env of the min pass & charge it its quantum in advance
+	next_env = sched_ready_dequeue(0);
+	if (next_env == NULL) return NULL;
+	StrideSched.virtualTime[mycpu_index()] = next_env->pass;
+	next_env->pass += next_env->stride;
 
-	//Pick the next environment from the ready queue
-	next_env = dequeue(&(ProcessQueues.env_ready_queues[cur_priority]));
-	kclock_set_quantum(quantums[cur_priority]);
+	kclock_set_quantum(quantums[0]);
 	return next_env;
 }
 
@@ -379,11 +632,74 @@ struct Env* fos_scheduler_PRIRR()
 //========================================
 void clock_interrupt_handler(struct Trapframe* tf)
 {
-	if (isSchedMethodPRIRR())
+	//With multiple CPUs, each one accounts & preempts its curenv, while the global work
+	//(the ticks, the aging & the BSD statistics) is driven by the clock of the boot CPU only
+	int isBootCPU = (mycpu() == &CPUS[0]);
+	//# of quantums covered by the one-shot that has just fired (all but the last one are accounted by the clock)
+	uint16 nTicks = kclock_fired();
+	//MLFQ: the boost period is timed by the clock of the boot CPU (the ms of the timer wheel),
+	//so it doesn't fire more often as more CPUs are added
+	if (isSchedMethodMLFQ() && isBootCPU && TimerWheel.now - mlfqLastBoostMS_ >= mlfqBoostPeriod_)
 	{
-		struct Env* cur_env = get_cpu_proc();
-		if(ticks >= starvThresh_ && cur_env && cur_env->priority > 0)
-			env_set_priority(cur_env->env_id,cur_env->priority-1);
+		mlfqLastBoostMS_ = TimerWheel.now;
+		sched_boost_MLFQ();
+	}
+	if (isSchedMethodPRIRR() && isBootCPU && ticks >= nextAgingTick_)
+	{
+		//age the waiting envs in batches, a few passes per starvation threshold
+		sched_age_PRIRR();
+		uint32 period = starvThresh_ / PRIRR_AGING_BATCHES;
+		nextAgingTick_ = ticks + (period > 0 ? period : 1);
+	}
+
+	if (isSchedMethodBSD())
+	{
+		sched_update_BSD();
+	}
+
+	//STRIDE: the curenv is charged a quantum when it's picked, so charge it the rest of the
+	//quantums of a stretched clock
+	if (isSchedMethodSTRIDE() && nTicks > 1)
+	{
+		acquire_spinlock(&ProcessQueues.qlock);
+		{
+			struct Env* cur_env = get_cpu_proc();
+			if (cur_env != NULL && cur_env->rtPeriod == 0)
+				cur_env->pass += cur_env->stride * (nTicks - 1);
+		}
+		release_spinlock(&ProcessQueues.qlock);
+	}
+
+	//wake up the sleeping envs whose deadlines have passed (incl. the ms of the skipped ticks)
+	if (isBootCPU)
+	{
+		uint32 elapsedMS = mycpu()->quantum + Tickless.pendingMS;
+		Tickless.pendingMS = 0;
+		timer_wheel_advance(elapsedMS);
+	}
+
+	//EDF: release the next jobs of the real-time envs (boot CPU), then charge the running one
+	//(throttled till its next period once its budget is exhausted)
+	if (EDF.numOfEnvs > 0)
+	{
+		if (isBootCPU)
+			sched_release_EDF();
+		sched_charge_EDF(mycpu()->quantum * nTicks);
+	}
+
+	if (!isBootCPU)
+	{
+		struct Env* p = get_cpu_proc();
+		if (p != NULL)
+		{
+			p->nClocks++ ;
+			if(isPageReplacmentAlgorithmLRU(PG_REP_LRU_TIME_APPROX))
+			{
+				update_WS_time_stamps();
+			}
+			yield();
+		}
+		return;
 	}
 
 	/********DON'T CHANGE THESE LINES***********/
@@ -406,6 +722,87 @@ void clock_interrupt_handler(struct Trapframe* tf)
 	/*****************************************/
 }
 
+//===================================================================
+// [12] Age the Ready Envs of the PRIORITY RR
+//===================================================================
+//Promote (by one priority) each ready env that has been waiting for starvThresh_ ticks or more.
+//Each ready queue is FIFO, so its longest waiting envs are at its tail and the scan of a
+//level stops at its first env that is not starved
+void sched_age_PRIRR()
+{
+	acquire_spinlock(&ProcessQueues.qlock);
+	{
+		uint32 now = (uint32)ticks;
+		//ascending order of levels, so a promoted env is not promoted again in the same pass
+		for (int c = 0; c < ncpu; c++)
+		{
+			for (int w = 0; w < MAX_READY_QUEUES/32; w++)
+			{
+				uint32 bits = ProcessQueues.ready_bitmap[c][w];
+				while (bits != 0)
+				{
+					int level = (w << 5) + bsf(bits);
+					bits &= bits - 1;
+					if (level == 0)
+						continue;
+
+					struct Env* e;
+					while ((e = LIST_LAST(READY_QUEUE(c, level))) != NULL &&
+							now - e->enqueueTime >= starvThresh_)
+					{
+						sched_ready_remove(level, e);
+						e->priority = level - 1;
+						sched_ready_enqueue(level - 1, e);
+					}
+				}
+			}
+		}
+	}
+	release_spinlock(&ProcessQueues.qlock);
+}
+
+//===================================================================
+// [13] Boost All Envs of the MLFQ
+//===================================================================
+//Move all envs back to the top level, so the envs that sank to the lower levels
+//are not starved by the interactive ones
+void sched_boost_MLFQ()
+{
+	acquire_spinlock(&ProcessQueues.qlock);
+	{
+		//ready envs of the lower levels: keep their FIFO order (remove from the tail, enqueue at the head)
+		for (int c = 0; c < ncpu; c++)
+		{
+			for (int w = 0; w < MAX_READY_QUEUES/32; w++)
+			{
+				uint32 bits = ProcessQueues.ready_bitmap[c][w];
+				if (w == 0)
+					bits &= ~1;
+				while (bits != 0)
+				{
+					int level = (w << 5) + bsf(bits);
+					bits &= bits - 1;
+
+					struct Env* e;
+					while ((e = LIST_LAST(READY_QUEUE(c, level))) != NULL)
+					{
+						sched_ready_remove(level, e);
+						e->priority = 0;
+						sched_ready_enqueue(0, e);
+					}
+				}
+			}
+		}
+		//the running and the blocked envs go back to the top level as well
+		for (int i = 0; i < NENV; i++)
+		{
+			if (envs[i].env_status == ENV_RUNNING || envs[i].env_status == ENV_BLOCKED)
+				envs[i].priority = 0;
+		}
+	}
+	release_spinlock(&ProcessQueues.qlock);
+}
+
 //===================================================================
 // [9] Update LRU Timestamp of WS Elements
 //	  (Automatically Called Every Quantum in case of LRU Time Approx)
@@ -471,3 +868,90 @@ void update_WS_time_stamps()
 		}
 	}
 
+//===================================================================
+// [14] Update the BSD Statistics & Priorities (Called Every Tick)
+//===================================================================
+//recent_cpu of the curenv is incremented every tick. Once per second, load_avg and the
+//recent_cpu of each env are decayed. Every BSD_PRIORITY_PERIOD ticks, the priorities of
+//the running envs and the ready envs are recomputed and the ready envs whose level changed are
+//moved. The blocked envs get their priority recomputed when they're inserted again.
+//With multiple CPUs, the APs only update the recent_cpu of their curenvs: the rest is
+//driven by the clock of the boot CPU
+void sched_update_BSD()
+{
+	acquire_spinlock(&ProcessQueues.qlock);
+	{
+		struct Env* cur_env = get_cpu_proc();
+		if (cur_env != NULL)
+			cur_env->recent_cpu = fix_add(cur_env->recent_cpu, fix_int(1));
+
+		if (mycpu() != &CPUS[0])
+		{
+			release_spinlock(&ProcessQueues.qlock);
+			return;
+		}
+
+		if (++bsdSecTicks_ >= bsdTicksPerSec_)
+		{
+			bsdSecTicks_ = 0;
+
+			//load_avg = (59/60)*load_avg + (1/60)*(# of ready & running envs)
+			int ready_envs = sched_num_of_ready();
+			for (int c = 0; c < ncpu; c++)
+			{
+				if (CPUS[c].proc != NULL)
+					ready_envs++;
+			}
+			load_avg = fix_add(fix_unscale(fix_scale(load_avg, 59), 60), fix_frac(ready_envs, 60));
+
+			//recent_cpu = (2*load_avg)/(2*load_avg + 1) * recent_cpu + nice
+			fixed_point_t twice_load = fix_scale(load_avg, 2);
+			fixed_point_t decay = fix_div(twice_load, fix_add(twice_load, fix_int(1)));
+			for (int i = 0; i < NENV; i++)
+			{
+				struct Env* e = &envs[i];
+				if (e->env_status == ENV_FREE || e->env_status == ENV_EXIT)
+					continue;
+				e->recent_cpu = fix_add(fix_mul(decay, e->recent_cpu), fix_int(e->nice));
+			}
+		}
+
+		if (((uint32)ticks % BSD_PRIORITY_PERIOD) == 0)
+		{
+			for (int c = 0; c < ncpu; c++)
+			{
+				if (CPUS[c].proc != NULL)
+					CPUS[c].proc->priority = env_bsd_priority(CPUS[c].proc);
+			}
+
+			//a moved env is either not visited again in this pass or visited with an unchanged
+			//level (its priority is recomputed from the same values), so it's moved at most once
+			for (int c = 0; c < ncpu; c++)
+			{
+				for (int w = 0; w < MAX_READY_QUEUES/32; w++)
+				{
+					uint32 bits = ProcessQueues.ready_bitmap[c][w];
+					while (bits != 0)
+					{
+						int level = (w << 5) + bsf(bits);
+						bits &= bits - 1;
+						struct Env_Queue* queue = READY_QUEUE(c, level);
+						struct Env *e, *next;
+						for (e = LIST_FIRST(queue); e != NULL; e = next)
+						{
+							next = LIST_NEXT(e);
+							e->priority = env_bsd_priority(e);
+							int newLevel = sched_bsd_level(e->priority);
+							if (newLevel != level)
+							{
+								sched_ready_remove(level, e);
+								sched_ready_enqueue(newLevel, e);
+							}
+						}
+					}
+				}
+			}
+		}
+	}
+	release_spinlock(&ProcessQueues.qlock);
+}
@@ -16,23 +16,34 @@
 #define SCH_MLFQ 	1
 #define SCH_BSD 	2
 #define SCH_PRIRR 	3
+#define SCH_STRIDE 	4
 
 //2024 - decide whether to place this as a private member for each CPU or as a global for all CPUs?
 unsigned scheduler_method ;
 
+#define MAX_READY_QUEUES 256			//num_of_ready_queues is 8-bit
+
 ///Scheduler Queues
 //=================
+//Each CPU has its own set of ready queues (the envs it runs, see env->cpu). An idle CPU steals
+//the ready envs of the busiest one. All queues are still protected by the single qlock
+#define READY_QUEUE(cpu, level) (&(ProcessQueues.env_ready_queues[(cpu) * num_of_ready_queues + (level)]))
 struct
 {
 	struct spinlock qlock;				//TODO: [PROJECT'24.MS1 - #00 GIVENS] [4] LOCKS - SpinLock to protect all process queues
 	struct Env_Queue env_new_queue;		// queue of all new envs
 	struct Env_Queue env_exit_queue;	// queue of all exited envs
 #if USE_KHEAP
-	struct Env_Queue *env_ready_queues;	// Ready queue(s) for the MLFQ or RR
+	struct Env_Queue *env_ready_queues;	// Ready queue(s) for the MLFQ or RR (num_of_ready_queues per CPU)
 #else
 	//RR ONLY
-	struct Env_Queue env_ready_queues[1];// Ready queue(s) for the RR
+	struct Env_Queue env_ready_queues[NCPUS];// Ready queue for the RR (one per CPU)
 #endif
+	//bitmap of the non-empty ready queues of each CPU (bit i%32 of word i/32 = queue i) with a summary
+	//word (bit w = word w is not zero), so the highest non-empty level is found by two bsf
+	uint32 ready_bitmap[NCPUS][MAX_READY_QUEUES/32];
+	uint32 ready_summary[NCPUS];
+	uint32 num_of_ready[NCPUS];			// # of ready envs of each CPU (to find the busiest one)
 }ProcessQueues;
 
 #if USE_KHEAP
@@ -59,26 +70,66 @@ struct
 /********* for BSD Priority Scheduler *************/
 #define PRI_MIN 0
 #define PRI_MAX 63
+#define NICE_MIN -20
+#define NICE_MAX 20
+#define BSD_PRIORITY_PERIOD 4			//ticks between two priority recomputations
 int64 ticks;
 int64 timer_ticks() ;
+fixed_point_t load_avg;					//avg # of ready/running envs over the last minute
+uint32 bsdTicksPerSec_;					//ticks (quantums) per second
+uint32 bsdSecTicks_;					//ticks elapsed in the current second
 /********* for BSD Priority Scheduler *************/
 
 uint32 starvThresh_;
+#define PRIRR_AGING_BATCHES 4			//aging passes per starvation threshold
+int64 nextAgingTick_;					//when the next aging pass of the PRIRR is due
+
+#define MLFQ_DEFAULT_BOOST_PERIOD_IN_MS 1000
+uint32 mlfqBoostPeriod_;				//all envs are moved back to the top level of the MLFQ every this ms
+uint32 mlfqLastBoostMS_;				//TimerWheel.now at the last boost
+
+/********* for Stride Scheduler *************/
+//Each env runs in proportion to its tickets: the ready env of the min pass is run & its pass is
+//advanced by its stride (STRIDE1 / tickets). The ready envs of each CPU are kept in a binary min-heap
+//by pass (beside its ready queue), so an env is picked/inserted/removed in O(log n).
+//Ref: C. Waldspurger & W. Weihl, "Stride Scheduling: Deterministic Proportional-Share Resource Management"
+#define STRIDE1 (1 << 20)
+#define STRIDE_DEFAULT_TICKETS 100
+#define STRIDE_MAX_TICKETS 10000
+struct
+{
+	struct Env* heap[NCPUS][NENV];		//ready envs of each CPU, min pass at the root (Env.strideIndex)
+	uint32 size[NCPUS];
+	uint32 virtualTime[NCPUS];			//pass of the env run last by each CPU: an env that gets ready
+										//starts from it, so it can't monopolize the CPU by the passes it
+										//missed while it was blocked (protected by the qlock)
+} StrideSched;
+/********* for Stride Scheduler *************/
+
+//Directed yield (see yield_to())
+struct
+{
+	uint32 handoffs;					//envs run right away with the rest of the quantum of their donors
+	uint32 misses;						//donations dropped as the env is no longer ready (e.g. stolen by an idle CPU)
+} DirectedYield;
 
 void sched_init_RR(uint8 quantum);
 void sched_init_MLFQ(uint8 numOfLevels, uint8 *quantumOfEachLevel);
 void sched_init_BSD(uint8 numOfLevels, uint8 quantum);
 void sched_init_PRIRR(uint8 numOfPriorities, uint8 quantum, uint32 starvThresh);
+void sched_init_STRIDE(uint8 quantum);
 
 uint32 isSchedMethodRR();
 uint32 isSchedMethodMLFQ();
 uint32 isSchedMethodBSD();
 uint32 isSchedMethodPRIRR();
+uint32 isSchedMethodSTRIDE();
 
 struct Env* fos_scheduler_RR();
 struct Env* fos_scheduler_MLFQ();
 struct Env* fos_scheduler_BSD();
 struct Env* fos_scheduler_PRIRR();
+struct Env* fos_scheduler_STRIDE();
 
 //2012
 // This function does not return.
@@ -86,6 +137,9 @@ void fos_scheduler(void) __attribute__((noreturn));
 
 void sched_init();
 void clock_interrupt_handler(struct Trapframe* tf);
+void sched_age_PRIRR();
+void sched_boost_MLFQ();
+void sched_update_BSD();
 void update_WS_time_stamps();
 
 #endif	// !FOS_KERN_SCHED_H
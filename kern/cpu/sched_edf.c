@@ -0,0 +1,290 @@
+/*
+ * sched_edf.c
+ *
+ * Earliest-deadline-first real-time class. Each real-time env has a (period, budget): a job of
+ * budget ms of CPU time is released at the start of each period & its deadline is the end of the
+ * period. The envs are admitted only while their total utilization (sum of budget/period) is at
+ * most 1, so all their deadlines can be met, & the best-effort envs run in the slack.
+ * The time is the ms clock of the timer wheel, driven by the clock of the boot CPU.
+ */
+
+#include "sched_edf.h"
+
+#include <inc/assert.h>
+#include <inc/error.h>
+#include <kern/proc/user_environment.h>
+#include <kern/cpu/sched.h>
+#include <kern/cpu/cpu.h>
+#include <kern/cpu/mp.h>
+#include <kern/cpu/kclock.h>
+#include <kern/cpu/timer_wheel.h>
+#include <kern/cpu/sched_stats.h>
+
+static inline int edf_passed(uint32 now, uint32 time)
+{
+	return (int32)(now - time) >= 0;
+}
+
+//The deadline of the current job of the given env has passed: release its next job (with a whole
+//budget). Each passed deadline is a miss unless the job is done (only the first one can be)
+static void edf_next_job(struct Env* e, uint32 now, int jobDone)
+{
+	while (edf_passed(now, e->rtDeadline))
+	{
+		if (!jobDone)
+			e->rtMisses++;
+		jobDone = 0;
+		e->rtDeadline += e->rtPeriod;
+		e->rtJobs++;
+	}
+	e->rtRemaining = e->rtBudget;
+	e->rtThrottled = 0;
+}
+
+void sched_init_EDF()
+{
+	init_queue(&EDF.readyQueue);
+	init_queue(&EDF.waitQueue);
+	EDF.numOfEnvs = 0;
+	EDF.utilization = 0;
+	EDF.rejected = EDF.throttles = 0;
+}
+
+//Admit the given env to the real-time class with the given (period, budget) in ms, or move it
+//back to the best-effort envs if the period is 0. Returns E_INVAL if the budget doesn't fit in the
+//period or the total utilization would exceed 1
+int sched_rt_set_params(struct Env* e, uint32 period, uint32 budget)
+{
+	if (period > 0 && (budget == 0 || budget > period))
+		return E_INVAL;
+
+	int ret = 0;
+	acquire_spinlock(&ProcessQueues.qlock);
+	{
+		uint32 oldUtil = 0;
+		if (e->rtPeriod > 0)
+			oldUtil = ROUNDUP(e->rtBudget * EDF_UTIL_SCALE, e->rtPeriod) / e->rtPeriod;
+		uint32 newUtil = 0;
+		if (period > 0)
+			newUtil = ROUNDUP(budget * EDF_UTIL_SCALE, period) / period;
+
+		if (EDF.utilization - oldUtil + newUtil > EDF_UTIL_SCALE)
+		{
+			EDF.rejected++;
+			ret = E_INVAL;
+		}
+		else
+		{
+			if (e->rtPeriod == 0 && period > 0)
+				EDF.numOfEnvs++;
+			else if (e->rtPeriod > 0 && period == 0)
+				EDF.numOfEnvs--;
+			EDF.utilization = EDF.utilization - oldUtil + newUtil;
+
+			//its first job is released now
+			e->rtPeriod = period;
+			e->rtBudget = budget;
+			e->rtDeadline = TimerWheel.now + period;
+			e->rtRemaining = budget;
+			e->rtThrottled = 0;
+			e->rtJobs = (period > 0) ? 1 : 0;
+			e->rtMisses = 0;
+		}
+	}
+	release_spinlock(&ProcessQueues.qlock);
+	return ret;
+}
+
+//The current job of the current (real-time) env is done: block it till the release of its next job.
+//A job done after its deadline is a miss, & the next one is released right away
+void sched_rt_wait_period()
+{
+	acquire_spinlock(&ProcessQueues.qlock);
+	{
+		struct Env* e = get_cpu_proc();
+		assert(e != NULL);
+		if (e->rtPeriod > 0)
+		{
+			if (edf_passed(TimerWheel.now, e->rtDeadline))
+			{
+				edf_next_job(e, TimerWheel.now, 0);
+			}
+			else
+			{
+				e->env_status = ENV_BLOCKED;
+				e->rtThrottled = 0;
+				e->channel = &EDF.waitQueue;
+				enqueue(&EDF.waitQueue, e);
+				sched();
+			}
+		}
+	}
+	release_spinlock(&ProcessQueues.qlock);
+}
+
+//The given env leaves the real-time class (it exits or it's killed)
+void sched_leave_EDF(struct Env* e)
+{
+	if (e->rtPeriod == 0)
+		return;
+	bool lock_already_held = holding_spinlock(&ProcessQueues.qlock);
+	if (!lock_already_held)
+		acquire_spinlock(&ProcessQueues.qlock);
+	{
+		sched_remove_EDF(e);
+		uint32 util = ROUNDUP(e->rtBudget * EDF_UTIL_SCALE, e->rtPeriod) / e->rtPeriod;
+		EDF.utilization -= util;
+		EDF.numOfEnvs--;
+		e->rtPeriod = 0;
+	}
+	if (!lock_already_held)
+		release_spinlock(&ProcessQueues.qlock);
+}
+
+//Insert the given real-time env in the ready queue by its deadline (the qlock must be held).
+//The deadlines passed while it was blocked elsewhere are caught up first
+void sched_insert_EDF(struct Env* e)
+{
+	if(!holding_spinlock(&ProcessQueues.qlock))
+		panic("sched_insert_EDF: q.lock is not held by this CPU while it's expected to be.");
+	assert(e != NULL && e->rtPeriod > 0);
+
+	if (edf_passed(TimerWheel.now, e->rtDeadline))
+		edf_next_job(e, TimerWheel.now, 0);
+
+	e->env_status = ENV_READY;
+	struct Env* ptr_env;
+	LIST_FOREACH(ptr_env, &EDF.readyQueue)
+	{
+		if ((int32)(e->rtDeadline - ptr_env->rtDeadline) < 0)
+		{
+			LIST_INSERT_BEFORE(&EDF.readyQueue, ptr_env, e);
+			break;
+		}
+	}
+	if (ptr_env == NULL)
+		LIST_INSERT_TAIL(&EDF.readyQueue, e);
+
+	//it may preempt a best-effort env of an idle CPU
+	if (e != get_cpu_proc())
+		mp_kick_idle_cpu(e->cpu);
+}
+
+//Remove the given real-time env from the ready or the wait queue (the qlock must be held).
+//Returns 1 if it's found there
+int sched_remove_EDF(struct Env* e)
+{
+	struct Env* ptr_env;
+	LIST_FOREACH(ptr_env, &EDF.readyQueue)
+	{
+		if (ptr_env == e)
+		{
+			LIST_REMOVE(&EDF.readyQueue, e);
+			return 1;
+		}
+	}
+	LIST_FOREACH(ptr_env, &EDF.waitQueue)
+	{
+		if (ptr_env == e)
+		{
+			LIST_REMOVE(&EDF.waitQueue, e);
+			return 1;
+		}
+	}
+	return 0;
+}
+
+//The real-time env with the given ID if it's in the ready or the wait queue (the qlock must be held)
+struct Env* sched_find_EDF(uint32 envId)
+{
+	struct Env* ptr_env;
+	LIST_FOREACH(ptr_env, &EDF.readyQueue)
+	{
+		if (ptr_env->env_id == envId)
+			return ptr_env;
+	}
+	LIST_FOREACH(ptr_env, &EDF.waitQueue)
+	{
+		if (ptr_env->env_id == envId)
+			return ptr_env;
+	}
+	return NULL;
+}
+
+//Called by the scheduler before the best-effort one (the qlock must be held): the ready real-time
+//env with the earliest deadline, if any. The curenv (if it's still ready) goes back to its queue
+//first, a best-effort one is preempted
+struct Env* sched_next_EDF()
+{
+	if (EDF.numOfEnvs == 0)
+		return NULL;
+
+	struct Env* cur_env = get_cpu_proc();
+	if (cur_env != NULL && cur_env->rtPeriod > 0)
+		sched_insert_EDF(cur_env);
+
+	struct Env* next_env = LIST_FIRST(&EDF.readyQueue);
+	if (next_env == NULL)
+		return NULL;
+	LIST_REMOVE(&EDF.readyQueue, next_env);
+
+	if (cur_env != NULL && cur_env->rtPeriod == 0)
+		sched_insert_ready(cur_env);
+
+	kclock_set_quantum(quantums[0]);
+	return next_env;
+}
+
+//Called by the clock of the boot CPU: release the next jobs of the waiting envs whose periods have
+//ended (a throttled job is a miss), & catch up the ready ones whose deadlines have passed
+void sched_release_EDF()
+{
+	acquire_spinlock(&ProcessQueues.qlock);
+	{
+		uint32 now = TimerWheel.now;
+		struct Env* e;
+		LIST_FOREACH(e, &EDF.waitQueue)
+		{
+			if (edf_passed(now, e->rtDeadline))
+			{
+				LIST_REMOVE(&EDF.waitQueue, e);
+				e->channel = NULL;
+				edf_next_job(e, now, !e->rtThrottled);
+				sched_stat_ready(e);
+				sched_insert_EDF(e);
+			}
+		}
+		while ((e = LIST_FIRST(&EDF.readyQueue)) != NULL && edf_passed(now, e->rtDeadline))
+		{
+			LIST_REMOVE(&EDF.readyQueue, e);
+			sched_insert_EDF(e);
+		}
+	}
+	release_spinlock(&ProcessQueues.qlock);
+}
+
+//Called by the clock of each CPU with the ms elapsed: charge its running real-time env (if any),
+//& throttle it till its next period once the budget of its job is exhausted
+void sched_charge_EDF(uint32 milliSeconds)
+{
+	acquire_spinlock(&ProcessQueues.qlock);
+	{
+		struct Env* e = get_cpu_proc();
+		if (e != NULL && e->rtPeriod > 0)
+		{
+			if (edf_passed(TimerWheel.now, e->rtDeadline))
+				edf_next_job(e, TimerWheel.now, 0);
+			e->rtRemaining -= milliSeconds;
+			if (e->rtRemaining <= 0)
+			{
+				EDF.throttles++;
+				e->rtThrottled = 1;
+				e->env_status = ENV_BLOCKED;
+				e->channel = &EDF.waitQueue;
+				enqueue(&EDF.waitQueue, e);
+				sched();
+			}
+		}
+	}
+	release_spinlock(&ProcessQueues.qlock);
+}
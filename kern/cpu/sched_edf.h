@@ -0,0 +1,43 @@
+/*
+ * sched_edf.h
+ *
+ * Earliest-deadline-first real-time class, layered above the best-effort schedulers (sched_next[]):
+ * a periodic env gets its budget of CPU time in each of its periods, ahead of the best-effort envs.
+ */
+
+#ifndef FOS_KERN_SCHED_EDF_H
+#define FOS_KERN_SCHED_EDF_H
+#ifndef FOS_KERNEL
+# error "This is a FOS kernel header; user programs should not #include it"
+#endif
+
+#include <inc/environment_definitions.h>
+
+#define EDF_UTIL_SCALE 10000			//utilization of the whole CPU (budget/period is kept in these units)
+
+//All the real-time envs are protected by the qlock. Each one is either running, in the ready queue
+//(its current job is not done), waiting for the release of its next job (its job is done, or its
+//budget is exhausted) or blocked elsewhere (it's caught up on getting ready again)
+struct
+{
+	struct Env_Queue readyQueue;		//ready real-time envs, sorted by their deadlines (earliest first)
+	struct Env_Queue waitQueue;			//envs waiting for the release of their next jobs
+	uint32 numOfEnvs;					//# of real-time envs
+	uint32 utilization;					//sum of their budget/period (in EDF_UTIL_SCALE units), at most EDF_UTIL_SCALE
+	uint32 rejected;					//stats
+	uint32 throttles;
+} EDF;
+
+void sched_init_EDF();
+int sched_rt_set_params(struct Env* e, uint32 period, uint32 budget);
+void sched_rt_wait_period();
+void sched_leave_EDF(struct Env* e);
+
+void sched_insert_EDF(struct Env* e);
+int sched_remove_EDF(struct Env* e);
+struct Env* sched_find_EDF(uint32 envId);
+struct Env* sched_next_EDF();
+void sched_release_EDF();
+void sched_charge_EDF(uint32 milliSeconds);
+
+#endif //FOS_KERN_SCHED_EDF_H
@@ -1,6 +1,8 @@
 #include "sched.h"
 
 #include <inc/assert.h>
+#include <inc/x86.h>
+#include <inc/string.h>
 
 #include <kern/proc/user_environment.h>
 #include <kern/trap/trap.h>
@@ -9,6 +11,10 @@
 #include <kern/tests/utilities.h>
 #include <kern/cmd/command_prompt.h>
 #include <kern/cpu/cpu.h>
+#include <kern/cpu/mp.h>
+#include <kern/cpu/kclock.h>
+#include <kern/cpu/sched_edf.h>
+#include <kern/cpu/sched_stats.h>
 
 //void on_clock_update_WS_time_stamps();
 extern void cleanup_buffers(struct Env* e);
@@ -121,6 +127,225 @@ void sched_delete_ready_queues()
 	release_spinlock(&ProcessQueues.qlock);
 
 #endif
+	sched_clear_ready_bitmap();
+}
+
+//=================================================
+// [1.1] Ready queues with their bitmap:
+//=================================================
+//All the insertions/removals of the ready queues go through these functions
+//to keep the bitmap of the non-empty queues up to date.
+//An env is inserted in (& removed from) the queues of its CPU (env->cpu), the current CPU
+//dequeues from its own queues only
+static inline void __sched_update_ready_bit(int cpu, int level)
+{
+	uint32 w = level >> 5;
+	if (LIST_EMPTY(READY_QUEUE(cpu, level)))
+	{
+		ProcessQueues.ready_bitmap[cpu][w] &= ~(1 << (level & 31));
+		if (ProcessQueues.ready_bitmap[cpu][w] == 0)
+			ProcessQueues.ready_summary[cpu] &= ~(1 << w);
+	}
+	else
+	{
+		ProcessQueues.ready_bitmap[cpu][w] |= 1 << (level & 31);
+		ProcessQueues.ready_summary[cpu] |= 1 << w;
+	}
+}
+
+//Stride heap of each CPU: a binary min-heap of its ready envs by pass (see StrideSched).
+//The passes wrap around, so they're compared by their (signed) difference
+static inline int __stride_before(struct Env* a, struct Env* b)
+{
+	return (int32)(a->pass - b->pass) < 0;
+}
+
+static inline void __stride_set(int cpu, int i, struct Env* env)
+{
+	StrideSched.heap[cpu][i] = env;
+	env->strideIndex = i;
+}
+
+static void __stride_sift_up(int cpu, int i)
+{
+	struct Env* env = StrideSched.heap[cpu][i];
+	while (i > 0 && __stride_before(env, StrideSched.heap[cpu][(i - 1) / 2]))
+	{
+		__stride_set(cpu, i, StrideSched.heap[cpu][(i - 1) / 2]);
+		i = (i - 1) / 2;
+	}
+	__stride_set(cpu, i, env);
+}
+
+static void __stride_sift_down(int cpu, int i)
+{
+	struct Env* env = StrideSched.heap[cpu][i];
+	uint32 n = StrideSched.size[cpu];
+	while (2 * i + 1 < n)
+	{
+		int child = 2 * i + 1;
+		if (child + 1 < n && __stride_before(StrideSched.heap[cpu][child + 1], StrideSched.heap[cpu][child]))
+			child++;
+		if (!__stride_before(StrideSched.heap[cpu][child], env))
+			break;
+		__stride_set(cpu, i, StrideSched.heap[cpu][child]);
+		i = child;
+	}
+	__stride_set(cpu, i, env);
+}
+
+static void __stride_push(int cpu, struct Env* env)
+{
+	//an env that has been blocked (or is new) starts from the virtual time of its CPU
+	if ((int32)(env->pass - StrideSched.virtualTime[cpu]) < 0)
+		env->pass = StrideSched.virtualTime[cpu];
+	assert(StrideSched.size[cpu] < NENV);
+	__stride_set(cpu, StrideSched.size[cpu]++, env);
+	__stride_sift_up(cpu, env->strideIndex);
+}
+
+static void __stride_remove(int cpu, struct Env* env)
+{
+	int i = env->strideIndex;
+	if (i < 0 || i >= StrideSched.size[cpu] || StrideSched.heap[cpu][i] != env)
+		return;
+	env->strideIndex = -1;
+	struct Env* last = StrideSched.heap[cpu][--StrideSched.size[cpu]];
+	if (last == env)
+		return;
+	__stride_set(cpu, i, last);
+	__stride_sift_up(cpu, i);
+	__stride_sift_down(cpu, last->strideIndex);
+}
+
+static inline void __sched_ready_insert(int cpu, int level, struct Env* env)
+{
+	enqueue(READY_QUEUE(cpu, level), env);
+	if (isSchedMethodSTRIDE())
+		__stride_push(cpu, env);
+	ProcessQueues.num_of_ready[cpu]++;
+	__sched_update_ready_bit(cpu, level);
+}
+
+static inline int __sched_highest_ready_level(int cpu)
+{
+	if (ProcessQueues.ready_summary[cpu] == 0)
+		return -1;
+	uint32 w = bsf(ProcessQueues.ready_summary[cpu]);
+	return (w << 5) + bsf(ProcessQueues.ready_bitmap[cpu][w]);
+}
+
+void sched_ready_enqueue(int level, struct Env* env)
+{
+	assert(level >= 0 && level < num_of_ready_queues);
+	assert(env->cpu >= 0 && env->cpu < ncpu);
+	__sched_ready_insert(env->cpu, level, env);
+	env->enqueueTime = (uint32)ticks;
+
+	//wake up an idle CPU to run it (or steal it), unless it's the curenv that's going to be
+	//picked again right away by this CPU. The env running on its CPU must not keep it waiting
+	//for more than a quantum, so the stretched clock of that CPU is cut (if any)
+	if (env != get_cpu_proc() || ProcessQueues.num_of_ready[env->cpu] > 1)
+	{
+		mp_kick_idle_cpu(env->cpu);
+		kclock_cut_stretch(env->cpu);
+	}
+}
+
+struct Env* sched_ready_dequeue(int level)
+{
+	int cpu = mycpu_index();
+	struct Env* env;
+	if (isSchedMethodSTRIDE())
+	{
+		//the env of the min pass (instead of the longest waiting one)
+		env = (StrideSched.size[cpu] > 0) ? StrideSched.heap[cpu][0] : NULL;
+		if (env != NULL)
+		{
+			__stride_remove(cpu, env);
+			remove_from_queue(READY_QUEUE(cpu, level), env);
+		}
+	}
+	else
+		env = dequeue(READY_QUEUE(cpu, level));
+	if (env != NULL)
+		ProcessQueues.num_of_ready[cpu]--;
+	__sched_update_ready_bit(cpu, level);
+	return env;
+}
+
+void sched_ready_remove(int level, struct Env* env)
+{
+	remove_from_queue(READY_QUEUE(env->cpu, level), env);
+	if (isSchedMethodSTRIDE())
+		__stride_remove(env->cpu, env);
+	ProcessQueues.num_of_ready[env->cpu]--;
+	__sched_update_ready_bit(env->cpu, level);
+}
+
+//Highest priority (i.e. lowest) non-empty ready level of the current CPU in O(1), -1 if all are empty
+int sched_highest_ready_level()
+{
+	return __sched_highest_ready_level(mycpu_index());
+}
+
+void sched_clear_ready_bitmap()
+{
+	memset(ProcessQueues.ready_bitmap, 0, sizeof(ProcessQueues.ready_bitmap));
+	memset(ProcessQueues.ready_summary, 0, sizeof(ProcessQueues.ready_summary));
+	memset(ProcessQueues.num_of_ready, 0, sizeof(ProcessQueues.num_of_ready));
+	memset(StrideSched.size, 0, sizeof(StrideSched.size));
+	memset(StrideSched.virtualTime, 0, sizeof(StrideSched.virtualTime));
+}
+
+//# of ready envs of all CPUs
+int sched_num_of_ready()
+{
+	int n = 0;
+	for (int c = 0; c < ncpu; c++)
+		n += ProcessQueues.num_of_ready[c];
+	return n;
+}
+
+//Move the longest waiting env of the highest level of the busiest other CPU to the same level
+//of the current CPU (keeping its waiting time). Under STRIDE, the env of the min pass is moved
+//instead, with its pass rebased from the virtual time of its CPU to that of the current one
+//(keeping its lag). Returns 1 if an env is stolen
+int sched_steal_ready()
+{
+	/*To protect process Qs (or info of current process) in multi-CPU*/
+	if(!holding_spinlock(&ProcessQueues.qlock))
+		panic("sched: q.lock is not held by this CPU while it's expected to be.");
+	/*********************************************************************/
+
+	int me = mycpu_index();
+	int victim = -1;
+	for (int c = 0; c < ncpu; c++)
+	{
+		if (c != me && ProcessQueues.num_of_ready[c] > 0 &&
+				(victim < 0 || ProcessQueues.num_of_ready[c] > ProcessQueues.num_of_ready[victim]))
+			victim = c;
+	}
+	if (victim < 0)
+		return 0;
+
+	int level = __sched_highest_ready_level(victim);
+	struct Env* env;
+	if (isSchedMethodSTRIDE())
+	{
+		env = StrideSched.heap[victim][0];
+		sched_ready_remove(level, env);
+		env->pass = env->pass - StrideSched.virtualTime[victim] + StrideSched.virtualTime[me];
+	}
+	else
+	{
+		env = LIST_LAST(READY_QUEUE(victim, level));
+		sched_ready_remove(level, env);
+	}
+	env->cpu = me;
+	__sched_ready_insert(me, level, env);
+	MPStats.steals++;
+	return 1;
 }
 
 //=================================================
@@ -137,7 +362,7 @@ void sched_insert_ready0(struct Env* env)
 	{
 		//cprintf("\nInserting %d into ready queue 0\n", env->env_id);
 		env->env_status = ENV_READY ;
-		enqueue(&(ProcessQueues.env_ready_queues[0]), env);
+		sched_ready_enqueue(0, env);
 	}
 }
 
@@ -155,7 +380,27 @@ void sched_insert_ready(struct Env* env)
 	{
 		//cprintf("\nInserting %d into ready queue 0\n", env->env_id);
 		env->env_status = ENV_READY ;
-		enqueue(&(ProcessQueues.env_ready_queues[env->priority]), env);
+		sched_stat_ready(env);
+		if (env->rtPeriod > 0)
+		{
+			//real-time envs are dispatched by deadline, ahead of the best-effort scheduler
+			sched_insert_EDF(env);
+		}
+		else if (isSchedMethodSTRIDE())
+		{
+			//a single level, ordered by the stride heap
+			sched_ready_enqueue(0, env);
+		}
+		else if (isSchedMethodBSD())
+		{
+			//its recent_cpu may have decayed while it was blocked
+			env->priority = env_bsd_priority(env);
+			sched_ready_enqueue(sched_bsd_level(env->priority), env);
+		}
+		else
+		{
+			sched_ready_enqueue(env->priority, env);
+		}
 	}
 }
 
@@ -171,12 +416,18 @@ void sched_remove_ready(struct Env* env)
 
 	assert(env != NULL && env->env_status == ENV_READY);
 	{
+		if (env->rtPeriod > 0)
+		{
+			sched_remove_EDF(env);
+			env->env_status = ENV_UNKNOWN;
+			return ;
+		}
 		for (int i = 0 ; i < num_of_ready_queues ; i++)
 		{
-			struct Env * ptr_env = find_env_in_queue(&(ProcessQueues.env_ready_queues[i]), env->env_id);
+			struct Env * ptr_env = find_env_in_queue(READY_QUEUE(env->cpu, i), env->env_id);
 			if (ptr_env != NULL)
 			{
-				LIST_REMOVE(&(ProcessQueues.env_ready_queues[i]), env);
+				sched_ready_remove(i, env);
 				env->env_status = ENV_UNKNOWN;
 				return ;
 			}
@@ -197,6 +448,7 @@ void sched_insert_new(struct Env* env)
 	assert(env != NULL);
 	{
 		env->env_status = ENV_NEW ;
+		env->cpu = mycpu_index();	//it's run by the CPU that creates it (till it's stolen)
 		enqueue(&ProcessQueues.env_new_queue, env);
 	}
 }
@@ -231,6 +483,7 @@ void sched_insert_exit(struct Env* env)
 	assert(env != NULL);
 	{
 		if(isBufferingEnabled()) {cleanup_buffers(env);}
+		sched_leave_EDF(env);
 		env->env_status = ENV_EXIT ;
 		enqueue(&ProcessQueues.env_exit_queue, env);
 	}
@@ -330,7 +583,8 @@ void sched_exit_env(uint32 envId)
 	}
 	if (!found)
 	{
-		for (int i = 0 ; i < num_of_ready_queues ; i++)
+		//ready queues of all CPUs
+		for (int i = 0 ; i < ncpu * num_of_ready_queues ; i++)
 		{
 			if (!LIST_EMPTY(&(ProcessQueues.env_ready_queues[i])))
 			{
@@ -339,7 +593,7 @@ void sched_exit_env(uint32 envId)
 				{
 					if(ptr_env->env_id == envId)
 					{
-						LIST_REMOVE(&(ProcessQueues.env_ready_queues[i]), ptr_env);
+						sched_ready_remove(i % num_of_ready_queues, ptr_env);
 						found = 1;
 						break;
 					}
@@ -348,6 +602,16 @@ void sched_exit_env(uint32 envId)
 			if (found) break;
 		}
 	}
+	if (!found)
+	{
+		//real-time envs (ready or waiting for their next periods)
+		ptr_env = sched_find_EDF(envId);
+		if (ptr_env != NULL)
+		{
+			sched_remove_EDF(ptr_env);
+			found = 1;
+		}
+	}
 	struct Env* cur_env = get_cpu_proc();
 	assert(cur_env != NULL);
 	if (!found)
@@ -382,6 +646,24 @@ void sched_exit_env(uint32 envId)
 }
 
 
+//The given env is running on another CPU: it can't be freed under that CPU, so it's marked to
+//exit & that CPU is interrupted. The env moves itself to the EXIT queue as it leaves the kernel
+//(see trap()). Returns that CPU, -1 if the env isn't running on another CPU. Called with the qlock held
+static int __sched_kill_running_elsewhere(struct Env* env)
+{
+	int me = mycpu_index();
+	for (int c = 0; c < ncpu; c++)
+	{
+		if (c != me && CPUS[c].proc == env)
+		{
+			env->killed = 1;
+			mp_kick_cpu(c);
+			return c;
+		}
+	}
+	return -1;
+}
+
 /*2015*/
 //=================================================
 // [11] KILL the given EnvID:
@@ -406,7 +688,8 @@ void sched_kill_env(uint32 envId)
 	}
 	if (!found)
 	{
-		for (int i = 0 ; i < num_of_ready_queues ; i++)
+		//ready queues of all CPUs
+		for (int i = 0 ; i < ncpu * num_of_ready_queues ; i++)
 		{
 			if (!LIST_EMPTY(&(ProcessQueues.env_ready_queues[i])))
 			{
@@ -415,8 +698,8 @@ void sched_kill_env(uint32 envId)
 				{
 					if(ptr_env->env_id == envId)
 					{
-						cprintf("killing[%d] %s from the READY queue #%d...", ptr_env->env_id, ptr_env->prog_name, i);
-						LIST_REMOVE(&(ProcessQueues.env_ready_queues[i]), ptr_env);
+						cprintf("killing[%d] %s from the READY queue #%d...", ptr_env->env_id, ptr_env->prog_name, i % num_of_ready_queues);
+						sched_ready_remove(i % num_of_ready_queues, ptr_env);
 						found = 1;
 						break;
 					}
@@ -427,6 +710,16 @@ void sched_kill_env(uint32 envId)
 		}
 	}
 	if (!found)
+	{
+		ptr_env = sched_find_EDF(envId);
+		if (ptr_env != NULL)
+		{
+			cprintf("killing[%d] %s from the REAL-TIME queues...", ptr_env->env_id, ptr_env->prog_name);
+			sched_remove_EDF(ptr_env);
+			found = 1;
+		}
+	}
+	if (!found)
 	{
 		ptr_env=NULL;
 		LIST_FOREACH(ptr_env, &ProcessQueues.env_exit_queue)
@@ -440,8 +733,21 @@ void sched_kill_env(uint32 envId)
 			}
 		}
 	}
+	int runningOn = -1;
+	if (!found)
+	{
+		struct Env* env = NULL;
+		if (envid2env(envId, &env, 0) == 0 && env != NULL && env->env_status == ENV_RUNNING && env != get_cpu_proc())
+		{
+			runningOn = __sched_kill_running_elsewhere(env);
+			if (runningOn >= 0)
+				cprintf("killing[%d] %s running on CPU #%d... it'll exit on leaving the kernel\n", env->env_id, env->prog_name, runningOn);
+		}
+	}
 	release_spinlock(&(ProcessQueues.qlock)); 	//CS on Qs
 
+	if (runningOn >= 0)
+		return;
 	if (found)
 	{
 		env_free(ptr_env);
@@ -494,11 +800,13 @@ void sched_print_all()
 		cprintf("\nNo processes in NEW queue\n");
 	}
 	cprintf("================================================\n");
-	for (int i = 0 ; i < num_of_ready_queues ; i++)
+	for (int i = 0 ; i < ncpu * num_of_ready_queues ; i++)
 	{
+		if (ncpu > 1 && i % num_of_ready_queues == 0)
+			cprintf("CPU #%d:\n", i / num_of_ready_queues);
 		if (!LIST_EMPTY(&(ProcessQueues.env_ready_queues[i])))
 		{
-			cprintf("The processes in READY queue #%d are:\n", i);
+			cprintf("The processes in READY queue #%d are:\n", i % num_of_ready_queues);
 			LIST_FOREACH(ptr_env, &(ProcessQueues.env_ready_queues[i]))
 			{
 				cprintf("	[%d] %s\n", ptr_env->env_id, ptr_env->prog_name);
@@ -506,7 +814,20 @@ void sched_print_all()
 		}
 		else
 		{
-			cprintf("No processes in READY queue #%d\n", i);
+			cprintf("No processes in READY queue #%d\n", i % num_of_ready_queues);
+		}
+		cprintf("================================================\n");
+	}
+	if (EDF.numOfEnvs > 0)
+	{
+		cprintf("The REAL-TIME processes (ready by deadline, then waiting for their periods) are:\n");
+		LIST_FOREACH(ptr_env, &EDF.readyQueue)
+		{
+			cprintf("	[%d] %s (deadline = %u)\n", ptr_env->env_id, ptr_env->prog_name, ptr_env->rtDeadline);
+		}
+		LIST_FOREACH(ptr_env, &EDF.waitQueue)
+		{
+			cprintf("	[%d] %s (next release = %u)\n", ptr_env->env_id, ptr_env->prog_name, ptr_env->rtDeadline);
 		}
 		cprintf("================================================\n");
 	}
@@ -574,22 +895,39 @@ void sched_kill_all()
 		cprintf("No processes in NEW queue\n");
 	}
 	cprintf("================================================\n");
-	for (int i = 0 ; i < num_of_ready_queues ; i++)
+	for (int i = 0 ; i < ncpu * num_of_ready_queues ; i++)
 	{
 		if (!LIST_EMPTY(&(ProcessQueues.env_ready_queues[i])))
 		{
-			cprintf("KILLING the processes in the READY queue #%d...\n", i);
+			cprintf("KILLING the processes in the READY queue #%d...\n", i % num_of_ready_queues);
 			LIST_FOREACH(ptr_env, &(ProcessQueues.env_ready_queues[i]))
 			{
 				cprintf("	killing[%d] %s...", ptr_env->env_id, ptr_env->prog_name);
-				LIST_REMOVE(&(ProcessQueues.env_ready_queues[i]), ptr_env);
+				sched_ready_remove(i % num_of_ready_queues, ptr_env);
 				env_free(ptr_env);
 				cprintf("DONE\n");
 			}
 		}
 		else
 		{
-			cprintf("No processes in READY queue #%d\n",i);
+			cprintf("No processes in READY queue #%d\n", i % num_of_ready_queues);
+		}
+		cprintf("================================================\n");
+	}
+
+	if (EDF.numOfEnvs > 0)
+	{
+		cprintf("KILLING the REAL-TIME processes...\n");
+		struct Env_Queue* rtQueues[] = {&EDF.readyQueue, &EDF.waitQueue};
+		for (int q = 0; q < 2; q++)
+		{
+			while ((ptr_env = LIST_FIRST(rtQueues[q])) != NULL)
+			{
+				cprintf("	killing[%d] %s...", ptr_env->env_id, ptr_env->prog_name);
+				LIST_REMOVE(rtQueues[q], ptr_env);
+				env_free(ptr_env);
+				cprintf("DONE\n");
+			}
 		}
 		cprintf("================================================\n");
 	}
@@ -610,6 +948,14 @@ void sched_kill_all()
 		cprintf("No processes in EXIT queue\n");
 	}
 
+	//the envs running on the other CPUs exit on leaving the kernel
+	for (int c = 0; c < ncpu; c++)
+	{
+		ptr_env = CPUS[c].proc;
+		if (ptr_env != NULL && __sched_kill_running_elsewhere(ptr_env) >= 0)
+			cprintf("killing[%d] %s running on CPU #%d... it'll exit on leaving the kernel\n", ptr_env->env_id, ptr_env->prog_name, c);
+	}
+
 	struct Env* cur_env = get_cpu_proc();
 	if (cur_env)
 	{
@@ -641,18 +987,23 @@ void sched_exit_all_ready_envs()
 {
 	acquire_spinlock(&(ProcessQueues.qlock)); 	//CS on Qs
 	struct Env* ptr_env=NULL;
-	for (int i = 0 ; i < num_of_ready_queues ; i++)
+	for (int i = 0 ; i < ncpu * num_of_ready_queues ; i++)
 	{
 		if (!LIST_EMPTY(&(ProcessQueues.env_ready_queues[i])))
 		{
 			ptr_env=NULL;
 			LIST_FOREACH(ptr_env, &(ProcessQueues.env_ready_queues[i]))
 			{
-				LIST_REMOVE(&(ProcessQueues.env_ready_queues[i]), ptr_env);
+				sched_ready_remove(i % num_of_ready_queues, ptr_env);
 				sched_insert_exit(ptr_env);
 			}
 		}
 	}
+	while ((ptr_env = LIST_FIRST(&EDF.readyQueue)) != NULL)
+	{
+		LIST_REMOVE(&EDF.readyQueue, ptr_env);
+		sched_insert_exit(ptr_env);
+	}
 	release_spinlock(&(ProcessQueues.qlock)); 	//CS on Qs
 }
 
@@ -664,35 +1015,55 @@ int64 timer_ticks()
 }
 int env_get_nice(struct Env* e)
 {
-	//[PROJECT] BSD Scheduler - env_get_nice
-	//Your code is here
-	//Comment the following line
-	panic("Not implemented yet");
+	return e->nice;
 }
 
 void env_set_nice(struct Env* e, int nice_value)
 {
-	//[PROJECT] BSD Scheduler - env_set_nice
-	//Your code is here
-	//Comment the following line
-	panic("Not implemented yet");
+	if (nice_value < NICE_MIN) nice_value = NICE_MIN;
+	if (nice_value > NICE_MAX) nice_value = NICE_MAX;
+
+	acquire_spinlock(&ProcessQueues.qlock);
+	{
+		e->nice = nice_value;
+		int oldPriority = e->priority;
+		e->priority = env_bsd_priority(e);
+		//move it to its new level right away if it's waiting in the ready queues
+		if (isSchedMethodBSD() && e->env_status == ENV_READY &&
+				sched_bsd_level(oldPriority) != sched_bsd_level(e->priority))
+		{
+			sched_ready_remove(sched_bsd_level(oldPriority), e);
+			sched_ready_enqueue(sched_bsd_level(e->priority), e);
+		}
+	}
+	release_spinlock(&ProcessQueues.qlock);
 }
 
+//recent_cpu * 100 (rounded)
 int env_get_recent_cpu(struct Env* e)
 {
-	//[PROJECT] BSD Scheduler - env_get_recent_cpu
-	//Your code is here
-	//Comment the following line
-	panic("Not implemented yet");
+	return fix_round(fix_scale(e->recent_cpu, 100));
 }
+
+//load_avg * 100 (rounded)
 int get_load_average()
 {
-	//return 1;
-	//[PROJECT] BSD Scheduler - get_load_average
-	//Your code is here
-	//Comment the following line
-	panic("Not implemented yet");
-	return 0;
+	return fix_round(fix_scale(load_avg, 100));
+}
+
+//priority = PRI_MAX - (recent_cpu / 4) - (nice * 2), clamped to [PRI_MIN, PRI_MAX]
+int env_bsd_priority(struct Env* e)
+{
+	int priority = PRI_MAX - fix_trunc(fix_unscale(e->recent_cpu, 4)) - (e->nice * 2);
+	if (priority < PRI_MIN) priority = PRI_MIN;
+	if (priority > PRI_MAX) priority = PRI_MAX;
+	return priority;
+}
+
+//ready queue of the given BSD priority: level 0 holds PRI_MAX
+int sched_bsd_level(int priority)
+{
+	return (PRI_MAX - priority) * num_of_ready_queues / (PRI_MAX - PRI_MIN + 1);
 }
 /********* for BSD Priority Scheduler *************/
 //==================================================================================//
@@ -722,3 +1093,30 @@ void sched_set_starv_thresh(uint32 starvThresh)
 {
 	starvThresh_ = starvThresh;
 }
+
+/********* for Stride Scheduler *************/
+//Set the tickets of the given env (clamped to [1, STRIDE_MAX_TICKETS]): its share changes from its
+//next quantum on. A ready env keeps its place in the heap till then
+void env_set_tickets(struct Env* e, int tickets)
+{
+	if (tickets < 1)
+		tickets = 1;
+	if (tickets > STRIDE_MAX_TICKETS)
+		tickets = STRIDE_MAX_TICKETS;
+
+	bool lock_already_held = holding_spinlock(&ProcessQueues.qlock);
+	if (!lock_already_held)
+		acquire_spinlock(&ProcessQueues.qlock);
+	{
+		e->tickets = tickets;
+		e->stride = STRIDE1 / tickets;
+	}
+	if (!lock_already_held)
+		release_spinlock(&ProcessQueues.qlock);
+}
+
+int env_get_tickets(struct Env* e)
+{
+	return e->tickets;
+}
+/********* for Stride Scheduler *************/
@@ -14,8 +14,15 @@ int env_get_nice(struct Env* e) ;
 void env_set_nice(struct Env* e, int nice_value) ;
 int env_get_recent_cpu(struct Env* e) ;
 int get_load_average() ;
+int env_bsd_priority(struct Env* e) ;
+int sched_bsd_level(int priority) ;
 /********* for BSD Priority Scheduler *************/
 
+/********* for Stride Scheduler *************/
+void env_set_tickets(struct Env* e, int tickets) ;
+int env_get_tickets(struct Env* e) ;
+/********* for Stride Scheduler *************/
+
 /*2024*/
 void env_set_priority(int envID, int priority);
 void sched_set_starv_thresh(uint32 starvThresh);
@@ -41,6 +48,15 @@ void sched_print_all();
 void sched_run_all();
 void sched_delete_ready_queues() ;
 
+//Ready queues (keep the bitmap of the non-empty queues up to date)
+void sched_ready_enqueue(int level, struct Env* env);
+struct Env* sched_ready_dequeue(int level);
+void sched_ready_remove(int level, struct Env* env);
+int sched_highest_ready_level();
+void sched_clear_ready_bitmap();
+int sched_steal_ready();
+int sched_num_of_ready();
+
 //2018:
 //Declaration of helper functions to deal with the env queues
 void init_queue(struct Env_Queue* queue);
@@ -0,0 +1,101 @@
+/*
+ * sched_stats.c
+ *
+ * Scheduler statistics. Each env is stamped (rdtsc) whenever it changes its state: it gets ready
+ * (sched_insert_ready()), it's dispatched (fos_scheduler()) or it leaves its CPU (ready, blocked or
+ * exited), & the time since its previous stamp is added to the time of its previous state.
+ * All the hooks are called with the qlock held.
+ */
+
+#include "sched_stats.h"
+
+#include <inc/x86.h>
+#include <kern/cpu/cpu.h>
+#include <kern/proc/user_environment.h>
+
+//K cycles elapsed from the given stamp till now (0 if the TSCs of two CPUs are slightly apart)
+static inline uint32 kcycles_since(uint64 stamp, uint64 now)
+{
+	return (now > stamp) ? (uint32)((now - stamp) >> 10) : 0;
+}
+
+//Bucket of the given latency: the powers of 4 of K cycles, the last one covers the rest
+int sched_lat_bucket(uint32 kcycles)
+{
+	int b = 0;
+	while (kcycles >= 4 && b < SCHED_LAT_BUCKETS - 1)
+	{
+		kcycles >>= 2;
+		b++;
+	}
+	return b;
+}
+
+//The given env gets ready: a new env, or a blocked one that's woken up, starts its wake-to-run
+//latency. A preempted env is already ready since it left its CPU (nothing to do)
+void sched_stat_ready(struct Env* e)
+{
+	uint64 now = read_tsc();
+	if (e->statStamp == 0 || e->statBlocked)
+	{
+		if (e->statBlocked)
+			e->schedStats.blockedTime += kcycles_since(e->statStamp, now);
+		e->statBlocked = 0;
+		e->statWoken = 1;
+		e->statStamp = now;
+	}
+}
+
+//The given env is about to run on this CPU: end its wait (& its wake-to-run latency if it's woken),
+//and time the switch from the env that left this CPU last (if it's just left)
+void sched_stat_dispatch(struct Env* e)
+{
+	uint64 now = read_tsc();
+	if (e->statStamp != 0)
+	{
+		uint32 wait = kcycles_since(e->statStamp, now);
+		e->schedStats.readyTime += wait;
+		if (e->statWoken)
+		{
+			int b = sched_lat_bucket(wait);
+			e->schedStats.wakeups++;
+			e->schedStats.wakeLatencyHist[b]++;
+			if (wait > e->schedStats.maxWakeLatency)
+				e->schedStats.maxWakeLatency = wait;
+			GlobalSchedStats.wakeups++;
+			GlobalSchedStats.wakeLatencyHist[b]++;
+		}
+	}
+	e->statWoken = 0;
+	e->statStamp = now;
+	e->schedStats.dispatches++;
+
+	struct cpu* c = mycpu();
+	GlobalSchedStats.switches++;
+	if (c->statLeave != 0)
+	{
+		uint32 cost = kcycles_since(c->statLeave, now);
+		GlobalSchedStats.timedSwitches++;
+		GlobalSchedStats.switchCost += cost;
+		if (cost > GlobalSchedStats.maxSwitchCost)
+			GlobalSchedStats.maxSwitchCost = cost;
+		c->statLeave = 0;
+	}
+}
+
+//The given env has just left this CPU (back in its scheduler): end its run. Its status tells
+//whether it's still ready (preempted or yielded) or blocked (or exited)
+void sched_stat_leave(struct Env* e)
+{
+	uint64 now = read_tsc();
+	e->schedStats.runTime += kcycles_since(e->statStamp, now);
+	e->statStamp = now;
+	e->statBlocked = (e->env_status != ENV_READY);
+	mycpu()->statLeave = now;
+}
+
+//No env is found to run: the time till the next one is dispatched is idle time, not a switch
+void sched_stat_idle()
+{
+	mycpu()->statLeave = 0;
+}
@@ -0,0 +1,25 @@
+/*
+ * sched_stats.h
+ *
+ * Scheduler statistics: the ready, running & blocked times of each env, its wake-to-run latencies,
+ * and the # & cost of the context switches, all timed by rdtsc.
+ */
+
+#ifndef FOS_KERN_SCHED_STATS_H
+#define FOS_KERN_SCHED_STATS_H
+#ifndef FOS_KERNEL
+# error "This is a FOS kernel header; user programs should not #include it"
+#endif
+
+#include <inc/environment_definitions.h>
+
+//Counters of all the CPUs (protected by the qlock, like the per-env ones)
+struct SchedStats GlobalSchedStats;
+
+void sched_stat_ready(struct Env* e);
+void sched_stat_dispatch(struct Env* e);
+void sched_stat_leave(struct Env* e);
+void sched_stat_idle();
+int sched_lat_bucket(uint32 kcycles);
+
+#endif //FOS_KERN_SCHED_STATS_H
@@ -0,0 +1,223 @@
+/*
+ * timer_wheel.c
+ *
+ * Hierarchical timer wheel of the sleeping envs (sys_sleep()).
+ *
+ * Ref: G. Varghese & T. Lauck, "Hashed and Hierarchical Timing Wheels" (the scheme of the timers of Linux)
+ */
+
+#include "timer_wheel.h"
+
+#include <inc/assert.h>
+#include <inc/string.h>
+#include <kern/proc/user_environment.h>
+#include <kern/cpu/sched.h>
+
+//Slot of the given deadline: at the lowest level whose range covers it (from now). It's marked
+//occupied, as the caller puts the env there (the TimerWheel.lock must be held)
+static struct Channel* tw_slot_of(uint32 wakeupTime)
+{
+	uint32 delta = wakeupTime - TimerWheel.now;
+	int level = 0;
+	while (level < TW_LEVELS - 1 && delta >= (1 << (TW_SLOT_BITS * (level + 1))))
+		level++;
+	int slot = (wakeupTime >> (TW_SLOT_BITS * level)) & TW_SLOT_MASK;
+	TimerWheel.occupied[level][slot >> 5] |= 1 << (slot & 31);
+	return &TimerWheel.slots[level][slot];
+}
+
+static inline void tw_vacate(int level, int slot)
+{
+	TimerWheel.occupied[level][slot >> 5] &= ~(1 << (slot & 31));
+}
+
+//# of slots from the given one (circularly) to the first one marked occupied at the given level,
+//or TW_SLOTS if none
+static int tw_next_occupied(int level, int from)
+{
+	int n = 0;
+	while (n < TW_SLOTS)
+	{
+		int slot = (from + n) & TW_SLOT_MASK;
+		uint32 bits = TimerWheel.occupied[level][slot >> 5] >> (slot & 31);
+		if (bits != 0)
+		{
+			n += __builtin_ctz(bits);
+			break;
+		}
+		n += 32 - (slot & 31);
+	}
+	return n < TW_SLOTS ? n : TW_SLOTS;
+}
+
+//Min of the given ms & those remaining till the deadlines of the envs of the given slot
+static uint32 tw_slot_earliest(struct Channel* chan, uint32 now, uint32 next)
+{
+	struct Env* e;
+	for (e = LIST_FIRST(&chan->queue); e != NULL; e = LIST_NEXT(e))
+	{
+		int32 remaining = (int32)(e->wakeupTime - now);
+		if (remaining < 0)
+			remaining = 0;
+		if ((uint32)remaining < next)
+			next = remaining;
+	}
+	return next;
+}
+
+//Move the envs of the given slot down to the lower levels (the level below has just wrapped around to it)
+static void tw_cascade(int level, int slot)
+{
+	struct Channel* chan = &TimerWheel.slots[level][slot];
+	acquire_spinlock(&ProcessQueues.qlock);
+	{
+		struct Env* e;
+		while ((e = dequeue(&chan->queue)) != NULL)
+		{
+			struct Channel* to = tw_slot_of(e->wakeupTime);
+			assert(to != chan);
+			e->channel = to;
+			enqueue(&to->queue, e);
+			TimerWheel.cascades++;
+		}
+		tw_vacate(level, slot);
+	}
+	release_spinlock(&ProcessQueues.qlock);
+}
+
+//Wake up the envs of the given slot of level 0 (their deadline is now)
+static void tw_expire(int slot)
+{
+	struct Channel* chan = &TimerWheel.slots[0][slot];
+	acquire_spinlock(&ProcessQueues.qlock);
+	{
+		struct Env* e;
+		while ((e = dequeue(&chan->queue)) != NULL)
+		{
+			e->env_status = ENV_READY;
+			e->channel = NULL;
+			sched_insert_ready(e);
+			TimerWheel.numOfSleepers--;
+			TimerWheel.wakeups++;
+		}
+		tw_vacate(0, slot);
+	}
+	release_spinlock(&ProcessQueues.qlock);
+}
+
+void timer_wheel_init()
+{
+	for (int l = 0; l < TW_LEVELS; l++)
+	{
+		for (int s = 0; s < TW_SLOTS; s++)
+		{
+			init_channel(&TimerWheel.slots[l][s], "timer wheel slot");
+		}
+		for (int w = 0; w < TW_SLOTS / 32; w++)
+			TimerWheel.occupied[l][w] = 0;
+	}
+	TimerWheel.now = 0;
+	TimerWheel.numOfSleepers = 0;
+	TimerWheel.sleeps = TimerWheel.wakeups = TimerWheel.cascades = 0;
+	init_spinlock(&TimerWheel.lock, "timer wheel lock");
+}
+
+//Block the current env for the given ms (at least), on the slot of its deadline
+void timer_wheel_sleep(uint32 milliSeconds)
+{
+	if (milliSeconds == 0)
+		return;
+	if (milliSeconds > TW_MAX_SLEEP_MS)
+		milliSeconds = TW_MAX_SLEEP_MS;
+
+	struct Env* cur_env = get_cpu_proc();
+	assert(cur_env != NULL);
+
+	acquire_spinlock(&TimerWheel.lock);
+	{
+		cur_env->wakeupTime = TimerWheel.now + milliSeconds;
+		TimerWheel.numOfSleepers++;
+		TimerWheel.sleeps++;
+		sleep(tw_slot_of(cur_env->wakeupTime), &TimerWheel.lock);
+	}
+	release_spinlock(&TimerWheel.lock);
+}
+
+//Block the given env (that's not running, e.g. a dummy env of the tests) for the given ms
+//on the slot of its deadline, as timer_wheel_sleep() does for the current env
+void timer_wheel_block(struct Env* e, uint32 milliSeconds)
+{
+	assert(milliSeconds > 0 && milliSeconds <= TW_MAX_SLEEP_MS);
+	acquire_spinlock(&TimerWheel.lock);
+	{
+		e->wakeupTime = TimerWheel.now + milliSeconds;
+		TimerWheel.numOfSleepers++;
+		TimerWheel.sleeps++;
+		struct Channel* chan = tw_slot_of(e->wakeupTime);
+		acquire_spinlock(&ProcessQueues.qlock);
+		{
+			e->env_status = ENV_BLOCKED;
+			e->channel = chan;
+			enqueue(&chan->queue, e);
+		}
+		release_spinlock(&ProcessQueues.qlock);
+	}
+	release_spinlock(&TimerWheel.lock);
+}
+
+//Called by the clock of the boot CPU with the ms elapsed since its previous call:
+//cascades & expires the slots passed meanwhile, 1 ms at a time
+void timer_wheel_advance(uint32 milliSeconds)
+{
+	acquire_spinlock(&TimerWheel.lock);
+	{
+		while (milliSeconds > 0)
+		{
+			//no sleepers: all the slots are empty
+			if (TimerWheel.numOfSleepers == 0)
+			{
+				TimerWheel.now += milliSeconds;
+				break;
+			}
+			milliSeconds--;
+			uint32 now = ++TimerWheel.now;
+			for (int l = 1; l < TW_LEVELS && ((now >> (TW_SLOT_BITS * (l - 1))) & TW_SLOT_MASK) == 0; l++)
+			{
+				tw_cascade(l, (now >> (TW_SLOT_BITS * l)) & TW_SLOT_MASK);
+			}
+			tw_expire(now & TW_SLOT_MASK);
+		}
+	}
+	release_spinlock(&TimerWheel.lock);
+}
+
+//ms remaining till the earliest deadline (TW_NO_EXPIRY if no env is sleeping).
+//Used to bound the stretched clock of the boot CPU (see kclock_stretch()), the qlock must be held.
+//The slots of a level are in the order of their deadlines from its current one, so only the
+//current slot (a whole turn ahead at most) & the first occupied one past it are looked at per level
+uint32 timer_wheel_next_expiry()
+{
+	if (TimerWheel.numOfSleepers == 0)
+		return TW_NO_EXPIRY;
+	uint32 now = TimerWheel.now;
+	uint32 next = TW_NO_EXPIRY;
+	for (int l = 0; l < TW_LEVELS; l++)
+	{
+		int current = (now >> (TW_SLOT_BITS * l)) & TW_SLOT_MASK;
+		next = tw_slot_earliest(&TimerWheel.slots[l][current], now, next);
+		//skip the stale marks (their envs are killed) till an occupied slot
+		for (int n = 1; n < TW_SLOTS; n++)
+		{
+			n += tw_next_occupied(l, current + n);
+			if (n >= TW_SLOTS)
+				break;
+			struct Channel* chan = &TimerWheel.slots[l][(current + n) & TW_SLOT_MASK];
+			if (LIST_FIRST(&chan->queue) != NULL)
+			{
+				next = tw_slot_earliest(chan, now, next);
+				break;
+			}
+		}
+	}
+	return next;
+}
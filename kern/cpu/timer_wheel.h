@@ -0,0 +1,50 @@
+/*
+ * timer_wheel.h
+ *
+ * Hierarchical timer wheel of the sleeping envs (sys_sleep()): each env blocks on the channel
+ * of the slot of its deadline, & is woken up by the clock of the boot CPU once it's passed.
+ */
+
+#ifndef FOS_KERN_TIMER_WHEEL_H
+#define FOS_KERN_TIMER_WHEEL_H
+#ifndef FOS_KERNEL
+# error "This is a FOS kernel header; user programs should not #include it"
+#endif
+
+#include <inc/types.h>
+#include <kern/conc/channel.h>
+#include <kern/conc/spinlock.h>
+
+struct Env;
+
+//TW_LEVELS levels of TW_SLOTS slots each, 1 ms per slot at level 0 & TW_SLOTS times the slot of
+//the level below at each other level (64 ms, 4 s, 4.4 min & 4.7 hours in total).
+//A deadline is put at the lowest level that covers it, & moved down a level (cascaded) once
+//the level below wraps around to its slot, so both its insertion & its expiry take O(1)
+#define TW_SLOT_BITS 6
+#define TW_SLOTS (1 << TW_SLOT_BITS)
+#define TW_SLOT_MASK (TW_SLOTS - 1)
+#define TW_LEVELS 4
+#define TW_MAX_SLEEP_MS ((1 << (TW_SLOT_BITS * TW_LEVELS)) - 1)
+#define TW_NO_EXPIRY 0xFFFFFFFF
+
+struct
+{
+	struct Channel slots[TW_LEVELS][TW_SLOTS];	//envs blocked till the ms of their slot (Env.wakeupTime)
+	uint32 occupied[TW_LEVELS][TW_SLOTS / 32];	//bit of each slot set once an env is put there, cleared once it's
+												//expired/cascaded (a set bit may be stale, e.g. after a kill)
+	volatile uint32 now;						//ms elapsed on the clock of the boot CPU
+	uint32 numOfSleepers;
+	uint32 sleeps;								//stats
+	uint32 wakeups;
+	uint32 cascades;
+	struct spinlock lock;						//protects all the above (the queues of the slots are protected by the qlock)
+} TimerWheel;
+
+void timer_wheel_init();
+void timer_wheel_sleep(uint32 milliSeconds);
+void timer_wheel_block(struct Env* e, uint32 milliSeconds);
+void timer_wheel_advance(uint32 milliSeconds);
+uint32 timer_wheel_next_expiry();
+
+#endif //FOS_KERN_TIMER_WHEEL_H
@@ -0,0 +1,178 @@
+/*
+ * block_device.c
+ *
+ * Block device interface between the page file manager and the storage drivers.
+ *
+ * The devices are registered at boot: one per attached IDE disk (served through the
+ * per-disk request queues of the io scheduler) and the RAM disk (ram0, if it's reserved at boot).
+ * Each device keeps the count and the time of its transfers, so the cost of the swap
+ * traffic can be compared across backends.
+ */
+
+#include "block_device.h"
+#include "io_scheduler.h"
+#include "ramdisk.h"
+
+#include <inc/x86.h>
+#include <inc/disk.h>
+#include <inc/string.h>
+#include <inc/assert.h>
+
+//========================== IDE BACKEND ==============================
+//All IDE transfers go through the disk request queue, since the channel must not be
+//accessed while the queue is dispatching another command on it
+static int ide_blk_write(struct BlockDevice* dev, uint32 secno, const void* src, uint32 nsecs)
+{
+	while (nsecs > 0)
+	{
+		uint32 n = nsecs < IO_MAX_SECTORS_PER_DISPATCH ? nsecs : IO_MAX_SECTORS_PER_DISPATCH;
+		int r = io_submit(dev->unit, secno, (void*)src, n, IO_WRITE);
+		if (r < 0)
+			return r;
+		secno += n;
+		src += n * SECTSIZE;
+		nsecs -= n;
+	}
+	return 0;
+}
+
+static int ide_blk_read(struct BlockDevice* dev, uint32 secno, void* dst, uint32 nsecs)
+{
+	while (nsecs > 0)
+	{
+		uint32 n = nsecs < IO_MAX_SECTORS_PER_DISPATCH ? nsecs : IO_MAX_SECTORS_PER_DISPATCH;
+		int r = io_submit(dev->unit, secno, dst, n, IO_READ);
+		if (r < 0)
+			return r;
+		secno += n;
+		dst += n * SECTSIZE;
+		nsecs -= n;
+	}
+	return 0;
+}
+
+static int ide_blk_submit(struct BlockDevice* dev, uint32 secno, void* buffer, uint32 nsecs, uint8 write)
+{
+	return io_submit(dev->unit, secno, buffer, nsecs, write ? IO_WRITE : IO_READ);
+}
+
+static int ide_blk_flush(struct BlockDevice* dev)
+{
+	return io_flush(dev->unit);
+}
+
+static void ide_blk_attach(struct BlockDevice* dev, int disk)
+{
+	dev->unit = disk;
+	dev->numOfSectors = 0;
+	dev->read = ide_blk_read;
+	dev->write = ide_blk_write;
+	dev->submit = ide_blk_submit;
+	dev->flush = ide_blk_flush;
+}
+
+//========================== DEVICES ==============================
+//Register the available devices. Called after the disks are probed (io_scheduler_init)
+void blk_init()
+{
+	BlockDevices.count = 0;
+	char name[NAMELEN];
+	for (int d = 0; d < IDE_MAX_DISKS; d++)
+	{
+		if (!IOQueues[d].attached)
+			continue;
+		snprintf(name, NAMELEN, "ide%d", d);
+		ide_blk_attach(blk_register(name, BLK_IDE), d);
+	}
+	if (ramdisk_storage != NULL)
+		ramdisk_attach(blk_register("ram0", BLK_RAMDISK));
+}
+
+struct BlockDevice* blk_register(char* name, uint8 type)
+{
+	if (BlockDevices.count == MAX_BLK_DEVICES)
+		panic("blk_register: too many block devices");
+	struct BlockDevice* dev = &BlockDevices.devices[BlockDevices.count++];
+	memset(dev, 0, sizeof(*dev));
+	strncpy(dev->name, name, NAMELEN - 1);
+	dev->type = type;
+	init_spinlock(&dev->statlock, "block device stats lock");
+	return dev;
+}
+
+//the device of the given type and unit (NULL if it's not registered)
+struct BlockDevice* blk_find(uint8 type, int unit)
+{
+	for (int i = 0; i < BlockDevices.count; i++)
+	{
+		struct BlockDevice* dev = &BlockDevices.devices[i];
+		if (dev->type == type && dev->unit == unit)
+			return dev;
+	}
+	return NULL;
+}
+
+static void __blk_account(struct BlockDevice* dev, uint8 write, uint32 nsecs, uint64 start)
+{
+	uint32 time = (uint32)((read_tsc() - start) >> 10);
+	acquire_spinlock(&dev->statlock);
+	{
+		if (write)
+		{
+			dev->stats.writes++;
+			dev->stats.sectorsWritten += nsecs;
+		}
+		else
+		{
+			dev->stats.reads++;
+			dev->stats.sectorsRead += nsecs;
+		}
+		dev->stats.totalTime += time;
+	}
+	release_spinlock(&dev->statlock);
+}
+
+int blk_read(struct BlockDevice* dev, uint32 secno, void* dst, uint32 nsecs)
+{
+	uint64 start = read_tsc();
+	int r = dev->read(dev, secno, dst, nsecs);
+	__blk_account(dev, 0, nsecs, start);
+	return r;
+}
+
+int blk_write(struct BlockDevice* dev, uint32 secno, const void* src, uint32 nsecs)
+{
+	uint64 start = read_tsc();
+	int r = dev->write(dev, secno, src, nsecs);
+	__blk_account(dev, 1, nsecs, start);
+	return r;
+}
+
+int blk_submit(struct BlockDevice* dev, uint32 secno, void* buffer, uint32 nsecs, uint8 write)
+{
+	uint64 start = read_tsc();
+	int r = dev->submit(dev, secno, buffer, nsecs, write);
+	__blk_account(dev, write, nsecs, start);
+	return r;
+}
+
+int blk_flush(struct BlockDevice* dev)
+{
+	int r = dev->flush(dev);
+	acquire_spinlock(&dev->statlock);
+	dev->stats.flushes++;
+	release_spinlock(&dev->statlock);
+	return r;
+}
+
+void blk_print_stats()
+{
+	for (int i = 0; i < BlockDevices.count; i++)
+	{
+		struct BlockDevice* dev = &BlockDevices.devices[i];
+		uint32 transfers = dev->stats.reads + dev->stats.writes;
+		cprintf("%s: reads = %d (%d sectors), writes = %d (%d sectors), flushes = %d, avg transfer time = %d K cycles\n",
+				dev->name, dev->stats.reads, dev->stats.sectorsRead, dev->stats.writes, dev->stats.sectorsWritten,
+				dev->stats.flushes, transfers ? dev->stats.totalTime / transfers : 0);
+	}
+}
@@ -0,0 +1,70 @@
+/*
+ * block_device.h
+ *
+ * Block device interface between the page file manager and the storage drivers
+ * (the IDE disks and the RAM disk).
+ */
+
+#ifndef FOS_KERN_BLOCK_DEVICE_H
+#define FOS_KERN_BLOCK_DEVICE_H
+#ifndef FOS_KERNEL
+# error "This is a FOS kernel header; user programs should not #include it"
+#endif
+
+#include <inc/types.h>
+#include <inc/stdio.h>
+#include <kern/conc/spinlock.h>
+
+//block device backends
+#define BLK_IDE 1
+#define BLK_RAMDISK 2
+
+#define MAX_BLK_DEVICES 4
+
+///=============================================================================================
+struct BlockDevice
+{
+	char name[NAMELEN];
+	uint8 type;								//BLK_IDE or BLK_RAMDISK
+	int unit;								//IDE disk number
+	uint32 numOfSectors;					//capacity (0 = unknown)
+	uint8* storage;							//RAM disk storage (kernel VA)
+
+	//synchronous transfer of any length
+	int (*read)(struct BlockDevice* dev, uint32 secno, void* dst, uint32 nsecs);
+	int (*write)(struct BlockDevice* dev, uint32 secno, const void* src, uint32 nsecs);
+	//single request (up to IO_MAX_SECTORS_PER_DISPATCH sectors) that the device may
+	//reorder/merge with the other pending ones. It blocks the caller till it's completed
+	int (*submit)(struct BlockDevice* dev, uint32 secno, void* buffer, uint32 nsecs, uint8 write);
+	//make the completed writes durable
+	int (*flush)(struct BlockDevice* dev);
+
+	struct
+	{
+		uint32 reads;				//read transfers
+		uint32 writes;				//write transfers
+		uint32 flushes;
+		uint32 sectorsRead;
+		uint32 sectorsWritten;
+		uint32 totalTime;			//time spent in the transfers (in K cycles)
+	} stats;
+	struct spinlock statlock;		//protects the stats
+};
+
+struct
+{
+	struct BlockDevice devices[MAX_BLK_DEVICES];
+	int count;
+} BlockDevices;
+
+///=============================================================================================
+void blk_init();
+struct BlockDevice* blk_register(char* name, uint8 type);
+struct BlockDevice* blk_find(uint8 type, int unit);
+int blk_read(struct BlockDevice* dev, uint32 secno, void* dst, uint32 nsecs);
+int blk_write(struct BlockDevice* dev, uint32 secno, const void* src, uint32 nsecs);
+int blk_submit(struct BlockDevice* dev, uint32 secno, void* buffer, uint32 nsecs, uint8 write);
+int blk_flush(struct BlockDevice* dev);
+void blk_print_stats();
+
+#endif //FOS_KERN_BLOCK_DEVICE_H
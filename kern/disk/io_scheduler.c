@@ -0,0 +1,298 @@
+/*
+ * io_scheduler.c
+ *
+ * Elevator (C-LOOK) request queue between the page file manager and the IDE driver.
+ *
+ * Requests are kept sorted by sector. There's no dedicated I/O thread: the submitter
+ * that finds the disk idle becomes the dispatcher. It serves the queue in C-LOOK order
+ * (merging adjacent requests of the same direction into a single IDE command) and
+ * wakes up the sleeping submitters of the completed requests. Once its own request is
+ * completed, it hands the dispatching over to the submitter of a pending request.
+ *
+ * Each disk has its own queue (and dispatcher), so requests on the two IDE channels
+ * are served concurrently.
+ */
+
+#include "io_scheduler.h"
+
+#include <inc/x86.h>
+#include <inc/disk.h>
+#include <inc/assert.h>
+#include <inc/string.h>
+#include <kern/proc/user_environment.h>
+
+void io_scheduler_init()
+{
+	for (int d = 0; d < IDE_MAX_DISKS; d++)
+	{
+		struct IOQueue* q = &IOQueues[d];
+		q->disk = d;
+		//the boot disk is always there
+		q->attached = (d == 0) || ide_probe_disk(d);
+		LIST_INIT(&q->queue);
+		q->headPos = 0;
+		q->busy = 0;
+		memset(&q->stats, 0, sizeof(q->stats));
+		init_spinlock(&q->iolock, "IO queue lock");
+	}
+}
+
+//number of attached disks (they're numbered from 0 without holes)
+int io_num_of_disks()
+{
+	int n = 0;
+	while (n < IDE_MAX_DISKS && IOQueues[n].attached)
+		n++;
+	return n;
+}
+
+void io_init_request(struct IORequest* req, uint32 secno, void* buffer, uint32 nsecs, uint8 write)
+{
+	req->secno = secno;
+	req->nsecs = nsecs;
+	req->buffer = buffer;
+	req->write = write;
+	req->done = 0;
+	req->dispatch = 0;
+	req->status = 0;
+	req->submitTime = read_tsc();
+	init_channel(&req->chan, "IO request");
+}
+
+//insert after the requests of the same sector to keep them in their submission order
+static void __io_insert_sorted(struct IOQueue* q, struct IORequest* req)
+{
+	struct IORequest* r;
+	LIST_FOREACH(r, &q->queue)
+	{
+		if (r->secno > req->secno)
+		{
+			LIST_INSERT_BEFORE(&q->queue, r, req);
+			return;
+		}
+	}
+	LIST_INSERT_TAIL(&q->queue, req);
+}
+
+//Queue the given request (without waiting for it). Called with the iolock held
+void io_enqueue(struct IOQueue* q, struct IORequest* req)
+{
+	//a flush has no sectors: serve it at the current head position
+	if (req->write == IO_FLUSH)
+		req->secno = q->headPos;
+	__io_insert_sorted(q, req);
+	q->stats.requests++;
+	if (LIST_SIZE(&q->queue) > q->stats.maxDepth)
+		q->stats.maxDepth = LIST_SIZE(&q->queue);
+}
+
+//Remove the next requests to serve from the queue (in sector order) and return their count.
+//Called with the iolock held
+static int __io_pick_batch(struct IOQueue* q, struct IORequest** batch)
+{
+	struct IORequest *first = NULL, *r;
+
+	//C-LOOK: the lowest request at/after the head, otherwise wrap around to the lowest one
+	LIST_FOREACH(r, &q->queue)
+	{
+		if (r->secno >= q->headPos)
+		{
+			first = r;
+			break;
+		}
+	}
+	if (first == NULL)
+		first = LIST_FIRST(&q->queue);
+	if (first == NULL)
+		return 0;
+
+	//a flush is a command on its own
+	if (first->write == IO_FLUSH)
+	{
+		LIST_REMOVE(&q->queue, first);
+		batch[0] = first;
+		q->stats.flushes++;
+		return 1;
+	}
+
+	//merge the adjacent requests of the same direction (before and after it)
+	struct IORequest *start = first, *end = first;
+	uint32 nsecs = first->nsecs;
+	int count = 1;
+	while (count < IO_MAX_MERGED_REQUESTS && (r = LIST_PREV(start)) != NULL && r->write == first->write &&
+			r->secno + r->nsecs == start->secno && nsecs + r->nsecs <= IO_MAX_SECTORS_PER_DISPATCH)
+	{
+		start = r;
+		nsecs += r->nsecs;
+		count++;
+	}
+	while (count < IO_MAX_MERGED_REQUESTS && (r = LIST_NEXT(end)) != NULL && r->write == first->write &&
+			end->secno + end->nsecs == r->secno && nsecs + r->nsecs <= IO_MAX_SECTORS_PER_DISPATCH)
+	{
+		end = r;
+		nsecs += r->nsecs;
+		count++;
+	}
+
+	count = 0;
+	for (r = start; ; )
+	{
+		struct IORequest* next = LIST_NEXT(r);
+		LIST_REMOVE(&q->queue, r);
+		batch[count++] = r;
+		if (r == end)
+			break;
+		r = next;
+	}
+	q->headPos = end->secno + end->nsecs;
+	q->stats.dispatches++;
+	q->stats.merges += count - 1;
+	return count;
+}
+
+//issue a single IDE command for the given (contiguous) requests
+static int __io_transfer(int disk, struct IORequest** batch, int count)
+{
+	uint32 nsecs = 0;
+	for (int i = 0; i < count; i++)
+		nsecs += batch[i]->nsecs;
+
+	uint8 write = batch[0]->write;
+	if (write == IO_FLUSH)
+		return ide_flush(disk);
+	ide_start(disk, batch[0]->secno, nsecs, write);
+	for (int i = 0; i < count; i++)
+	{
+		for (uint32 s = 0; s < batch[i]->nsecs; s++)
+		{
+			void* buf = batch[i]->buffer + s * SECTSIZE;
+			int r = write ? ide_write_sector(disk, buf) : ide_read_sector(disk, buf);
+			if (r < 0)
+				return r;
+		}
+	}
+	return 0;
+}
+
+//Called with the iolock held
+static void __io_complete(struct IOQueue* q, struct IORequest** batch, int count, int status, struct IORequest* own)
+{
+	uint64 now = read_tsc();
+	for (int i = 0; i < count; i++)
+	{
+		struct IORequest* r = batch[i];
+		uint32 latency = (uint32)((now - r->submitTime) >> 10);
+		q->stats.completed++;
+		q->stats.totalLatency += latency;
+		if (latency > q->stats.maxLatency)
+			q->stats.maxLatency = latency;
+
+		r->status = status;
+		r->done = 1;
+		//NOTE: r lives on the stack of its submitter, so it must not be touched after the wakeup
+		if (r != own)
+			wakeup_all(&r->chan);
+	}
+}
+
+//Serve the next batch of the queue (a single IDE command) and complete its requests.
+//Return the number of the served requests (stored in batch), 0 if the queue is empty.
+//Called with the iolock held by the dispatcher of the queue (q->busy)
+int io_dispatch(struct IOQueue* q, struct IORequest** batch, struct IORequest* own)
+{
+	int count = __io_pick_batch(q, batch);
+	if (count == 0)
+		return 0;
+
+	//keep the queue open for the other submitters during the transfer
+	release_spinlock(&q->iolock);
+	int status = __io_transfer(q->disk, batch, count);
+	acquire_spinlock(&q->iolock);
+
+	__io_complete(q, batch, count, status, own);
+	return count;
+}
+
+//Dispatch the queue till the given request is completed, then hand the dispatching over.
+//Called with the iolock held
+static void __io_run_queue(struct IOQueue* q, struct IORequest* own)
+{
+	struct IORequest* batch[IO_MAX_MERGED_REQUESTS];
+	while (!own->done)
+	{
+		int count = io_dispatch(q, batch, own);
+		assert(count > 0);
+	}
+
+	struct IORequest* next = LIST_FIRST(&q->queue);
+	if (next != NULL)
+	{
+		next->dispatch = 1;
+		wakeup_all(&next->chan);
+	}
+	else
+	{
+		q->busy = 0;
+	}
+}
+
+//Read (write = IO_READ) or write (write = IO_WRITE) nsecs sectors starting at secno of the given disk,
+//and block till it's completed. Return 0 on success, < 0 on disk error
+int io_submit(int disk, uint32 secno, void* buffer, uint32 nsecs, uint8 write)
+{
+	assert(disk >= 0 && disk < IDE_MAX_DISKS && IOQueues[disk].attached);
+	assert((nsecs > 0 || write == IO_FLUSH) && nsecs <= IO_MAX_SECTORS_PER_DISPATCH);
+	struct IOQueue* q = &IOQueues[disk];
+
+	struct IORequest req;
+	io_init_request(&req, secno, buffer, nsecs, write);
+
+	acquire_spinlock(&q->iolock);
+	{
+		io_enqueue(q, &req);
+
+		if (!q->busy)
+		{
+			q->busy = 1;
+			req.dispatch = 1;
+		}
+		while (!req.done && !req.dispatch)
+		{
+			if (get_cpu_proc() != NULL)
+			{
+				sleep(&req.chan, &q->iolock);
+			}
+			else
+			{
+				//no process to block (e.g. loading a program from the kernel prompt): busy-wait
+				release_spinlock(&q->iolock);
+				acquire_spinlock(&q->iolock);
+			}
+		}
+		if (!req.done)
+			__io_run_queue(q, &req);
+	}
+	release_spinlock(&q->iolock);
+
+	return req.status;
+}
+
+//Commit the write cache of the given disk. The writes completed so far become durable
+int io_flush(int disk)
+{
+	return io_submit(disk, 0, NULL, 0, IO_FLUSH);
+}
+
+void io_print_stats()
+{
+	for (int d = 0; d < IDE_MAX_DISKS; d++)
+	{
+		struct IOQueue* q = &IOQueues[d];
+		if (!q->attached)
+			continue;
+		cprintf("IO queue of disk %d: depth = %d (max = %d), requests = %d, dispatches = %d, merges = %d, flushes = %d\n",
+				d, LIST_SIZE(&q->queue), q->stats.maxDepth, q->stats.requests, q->stats.dispatches, q->stats.merges, q->stats.flushes);
+		cprintf("\tlatency: avg = %d K cycles, max = %d K cycles (over %d completed requests)\n",
+				q->stats.completed ? q->stats.totalLatency / q->stats.completed : 0, q->stats.maxLatency, q->stats.completed);
+	}
+}
@@ -0,0 +1,82 @@
+/*
+ * io_scheduler.h
+ *
+ * Elevator (C-LOOK) request queue between the page file manager and the IDE driver.
+ */
+
+#ifndef FOS_KERN_IO_SCHEDULER_H
+#define FOS_KERN_IO_SCHEDULER_H
+#ifndef FOS_KERNEL
+# error "This is a FOS kernel header; user programs should not #include it"
+#endif
+
+#include <inc/types.h>
+#include <inc/stdio.h>
+#include <inc/disk.h>
+#include <inc/queue.h>
+#include <kern/conc/spinlock.h>
+#include <kern/conc/channel.h>
+
+#define IO_MAX_SECTORS_PER_DISPATCH 256		//max sectors of a single IDE command
+#define IO_MAX_MERGED_REQUESTS 32			//max requests merged into a single dispatch
+
+//request types
+#define IO_READ 0
+#define IO_WRITE 1
+#define IO_FLUSH 2							//commit the disk write cache (no sectors)
+
+///=============================================================================================
+struct IORequest
+{
+	LIST_ENTRY(IORequest) prev_next_info;	//link in the (sector-sorted) request queue
+	uint32 secno;							//first sector
+	uint32 nsecs;							//number of sectors
+	void* buffer;
+	uint8 write;							//IO_READ, IO_WRITE or IO_FLUSH
+	volatile uint8 done;					//set on completion
+	volatile uint8 dispatch;				//set when its submitter should take over dispatching
+	int status;								//result of the transfer (0 = success)
+	uint64 submitTime;						//rdtsc at submission
+	struct Channel chan;					//its submitter sleeps here till it's completed
+};
+LIST_HEAD(IORequest_List, IORequest);
+
+struct IOStats
+{
+	uint32 requests;		//submitted requests
+	uint32 dispatches;		//IDE commands issued
+	uint32 merges;			//requests merged into another request's command
+	uint32 flushes;			//cache flush commands issued
+	uint32 maxDepth;		//max number of pending requests seen
+	uint32 completed;
+	uint32 totalLatency;	//sum of the submit-to-completion latencies (in K cycles)
+	uint32 maxLatency;		//max latency (in K cycles)
+};
+
+//One queue per disk: each disk is on its own IDE channel, so the queues are
+//dispatched independently and their transfers overlap
+struct IOQueue
+{
+	int disk;
+	uint8 attached;					//the disk is present
+	struct IORequest_List queue;	//pending requests sorted by sector
+	uint32 headPos;					//sector following the last dispatched one (C-LOOK head)
+	uint8 busy;						//a submitter is dispatching the queue
+	struct IOStats stats;
+	struct spinlock iolock;			//protects all the above
+};
+struct IOQueue IOQueues[IDE_MAX_DISKS];
+
+///=============================================================================================
+void io_scheduler_init();
+int io_num_of_disks();
+int io_submit(int disk, uint32 secno, void* buffer, uint32 nsecs, uint8 write);
+int io_flush(int disk);
+void io_print_stats();
+
+//queue primitives (used by io_submit and by the tests that drive the queue themselves)
+void io_init_request(struct IORequest* req, uint32 secno, void* buffer, uint32 nsecs, uint8 write);
+void io_enqueue(struct IOQueue* q, struct IORequest* req);
+int io_dispatch(struct IOQueue* q, struct IORequest** batch, struct IORequest* own);
+
+#endif //FOS_KERN_IO_SCHEDULER_H
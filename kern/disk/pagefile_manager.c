@@ -2,9 +2,14 @@
 
 /// ==========================================================================
 /// THIS PAGE FILE MANAGMENT DOES NOT SUPPORT MEMORY SHARING !
+/// (the frames of the shares are evicted by the share itself, to page file
+///  frames of its own: see share_reclaim())
 /// ==========================================================================
 
 #include "pagefile_manager.h"
+#include "zswap.h"
+#include "block_device.h"
+#include "ramdisk.h"
 
 #include <inc/mmu.h>
 #include <inc/error.h>
@@ -22,12 +27,79 @@ void __pf_remove_env_all_tables(struct Env* ptr_env);
 void __pf_remove_env_table(struct Env* ptr_env, uint32 virtual_address);
 
 
+//Set up the page file devices of its backend (striped over the attached disks, or the RAM disk)
+static void pf_init_disks()
+{
+	PageFileDevices.numOfStripes = 0;
+	if (PageFileDevices.backend == BLK_RAMDISK)
+	{
+		PageFileDevices.devices[0] = blk_find(BLK_RAMDISK, 0);
+		PageFileDevices.startSector[0] = 0;
+		PageFileDevices.numOfStripes = 1;
+		cprintf("\n  page file is on the RAM disk (%d MB)", ramdisk_size >> 20);
+		return;
+	}
+	for (int d = 0; d < MAX_PAGE_FILE_STRIPES; d++)
+	{
+		struct BlockDevice* dev = blk_find(BLK_IDE, d);
+		if (dev == NULL)
+			break;
+		PageFileDevices.devices[d] = dev;
+		PageFileDevices.startSector[d] = (d == 0 ? PAGE_FILE_START_SECTOR : PAGE_FILE_SECOND_DISK_START_SECTOR);
+		PageFileDevices.numOfStripes++;
+	}
+	if (PageFileDevices.numOfStripes > 1)
+		cprintf("\n  page file is striped over %d disks", PageFileDevices.numOfStripes);
+}
+
+//Put the page file on the given backend (BLK_IDE or BLK_RAMDISK), with its free frames limited to its
+//capacity. Called at boot after the block devices are registered, & by the pfdev command: the pages
+//in the page file are not moved, so it's switched only while it's empty.
+//Return: 0 on success, E_INVAL if the backend has no device, E_NO_PAGE_FILE_SPACE if it's in use
+int pf_set_backend(uint8 backend)
+{
+	if (blk_find(backend, 0) == NULL)
+		return E_INVAL;
+	int numOfFrames = PAGES_PER_FILE;
+	if (backend == BLK_RAMDISK && ramdisk_size / PAGE_SIZE < numOfFrames)
+		numOfFrames = ramdisk_size / PAGE_SIZE;
+
+	acquire_spinlock(&DiskFrameLists.dfllock);
+	if (LIST_SIZE(&DiskFrameLists.disk_free_frame_list) != PageFileDevices.numOfFrames - 1)
+	{
+		release_spinlock(&DiskFrameLists.dfllock);
+		return E_NO_PAGE_FILE_SPACE;
+	}
+	LIST_INIT(&DiskFrameLists.disk_free_frame_list);
+	for (int i = 1; i < numOfFrames; i++)
+	{
+		initialize_frame_info(&(disk_frames_info[i]));
+		LIST_INSERT_HEAD(&DiskFrameLists.disk_free_frame_list, &disk_frames_info[i]);
+	}
+	PageFileDevices.numOfFrames = numOfFrames;
+	PageFileDevices.backend = backend;
+	pf_init_disks();
+	release_spinlock(&DiskFrameLists.dfllock);
+	return 0;
+}
+
+//device and start sector of the given page file frame
+struct BlockDevice* pf_locate(uint32 dfn, uint32* df_start_sector)
+{
+	uint32 n = PageFileDevices.numOfStripes;
+	assert(n > 0);
+	uint32 stripe = dfn % n;
+	*df_start_sector = PageFileDevices.startSector[stripe] + (dfn / n)*SECTOR_PER_PAGE;
+	return PageFileDevices.devices[stripe];
+}
+
 int read_disk_page(uint32 dfn, void* va)
 {
-	uint32 df_start_sector = PAGE_FILE_START_SECTOR+dfn*SECTOR_PER_PAGE;
+	uint32 df_start_sector;
+	struct BlockDevice* dev = pf_locate(dfn, &df_start_sector);
 
 	//LOG_STATMENT( cprintf("reading from disk to mem addr %x at sector %d\n",va,df_start_sector);  );
-	int success = ide_read(df_start_sector, (void*)va, SECTOR_PER_PAGE);
+	int success = blk_submit(dev, df_start_sector, (void*)va, SECTOR_PER_PAGE, 0);
 	//LOG_STATMENT( if(success==0) {cprintf("read from disk successuflly.\n");} else {cprintf("read from disk failed !!\n");} );
 
 	return success;
@@ -36,11 +108,16 @@ int read_disk_page(uint32 dfn, void* va)
 
 int write_disk_page(uint32 dfn, void* va)
 {
+	//the slot contents are about to change, so no resident frame or compressed copy matches it anymore
+	pf_swap_cache_invalidate(dfn);
+	zswap_invalidate(dfn);
+
 	//write disk at wanted frame
-	uint32 df_start_sector = PAGE_FILE_START_SECTOR+dfn*SECTOR_PER_PAGE;
+	uint32 df_start_sector;
+	struct BlockDevice* dev = pf_locate(dfn, &df_start_sector);
 
 	//LOG_STATMENT( cprintf(">>> writing to disk from mem addr %x at sector %d\n",va,df_start_sector);  );
-	int success = ide_write(df_start_sector, (void*)va, SECTOR_PER_PAGE);
+	int success = blk_submit(dev, df_start_sector, (void*)va, SECTOR_PER_PAGE, 1);
 	//LOG_STATMENT( if(success==0) {cprintf(">>> written to disk successfully.\n");} else {cprintf(">>> written to disk failed !!\n");} );
 
 	if(success != 0)
@@ -78,7 +155,10 @@ void initialize_disk_page_file()
 	LIST_INIT(&DiskFrameLists.disk_free_frame_list);
 
 	//LOG_STATMENT(cprintf("PAGES_PER_FILE = %d, PAGE_FILE_START_SECTOR = %d\n",PAGES_PER_FILE,PAGE_FILE_START_SECTOR););
-	for (i = 1; i < PAGES_PER_FILE; i++)
+	//the whole page file, till its backend is set (see pf_set_backend())
+	int numOfFrames = PAGES_PER_FILE;
+	PageFileDevices.numOfFrames = numOfFrames;
+	for (i = 1; i < numOfFrames; i++)
 	{
 		initialize_frame_info(&(disk_frames_info[i]));
 
@@ -139,6 +219,8 @@ inline void free_disk_frame(uint32 dfn)
 {
 	// Fill this function in
 	if(dfn == 0) return;
+	pf_swap_cache_invalidate(dfn);
+	zswap_invalidate(dfn);
 	acquire_spinlock(&DiskFrameLists.dfllock);
 	{
 		LIST_INSERT_HEAD(&DiskFrameLists.disk_free_frame_list, &disk_frames_info[dfn]);
@@ -352,7 +434,11 @@ int pf_update_env_page(struct Env* ptr_env, uint32 virtual_address, struct Frame
 		//				to do temp initialization of a frame.
 		map_frame(ptr_env->env_page_directory, modified_page_frame_info, (uint32)PGFLTEMP, 0);
 
-		ret = write_disk_page(dfn, (void*)ROUNDDOWN((uint32)PGFLTEMP, PAGE_SIZE));
+		//keep it compressed in memory if possible, otherwise write it to disk
+		if (zswap_store(dfn, (void*)ROUNDDOWN((uint32)PGFLTEMP, PAGE_SIZE)) == 0)
+			ret = 0;
+		else
+			ret = write_disk_page(dfn, (void*)ROUNDDOWN((uint32)PGFLTEMP, PAGE_SIZE));
 
 		// TEMPORARILY increase the references to prevent unmap_frame from removing the frame
 		modified_page_frame_info->references += 1;
@@ -364,7 +450,11 @@ int pf_update_env_page(struct Env* ptr_env, uint32 virtual_address, struct Frame
 	}
 #else
 	{
-		ret = write_disk_page(dfn, STATIC_KERNEL_VIRTUAL_ADDRESS(to_physical_address(modified_page_frame_info)));
+		void* src = STATIC_KERNEL_VIRTUAL_ADDRESS(to_physical_address(modified_page_frame_info));
+		if (zswap_store(dfn, src) == 0)
+			ret = 0;
+		else
+			ret = write_disk_page(dfn, src);
 		//cprintf("[%s] finished updating page\n",ptr_env->prog_name);
 	}
 #endif
@@ -408,12 +498,24 @@ int pf_read_env_page(struct Env* ptr_env, void* virtual_address)
 
 	if( dfn == 0) return E_PAGE_NOT_EXIST_IN_PF;
 
-	int disk_read_error = read_disk_page(dfn, virtual_address);
-
-	//reset modified bit to 0: because FOS copies the placed or replaced page from
-	//HD to memory, the page modified bit is set to 1, but we want the modified bit to be
-	// affected only by "user code" modifications, not our (FOS kernel) modifications
-	pt_set_page_permissions(ptr_env->env_page_directory, (uint32)virtual_address, 0, PERM_MODIFIED);
+	int disk_read_error = 0;
+	if (zswap_load(dfn, virtual_address) == 0)
+	{
+		//the compressed copy is dropped on load, so the page must be written out again
+		//on its eviction: keep it MODIFIED
+		pt_set_page_permissions(ptr_env->env_page_directory, (uint32)virtual_address, PERM_MODIFIED, 0);
+	}
+	else
+	{
+		disk_read_error = read_disk_page(dfn, virtual_address);
+		SwapCacheStats.misses++;
+		ZswapStats.diskReads++;
+
+		//reset modified bit to 0: because FOS copies the placed or replaced page from
+		//HD to memory, the page modified bit is set to 1, but we want the modified bit to be
+		// affected only by "user code" modifications, not our (FOS kernel) modifications
+		pt_set_page_permissions(ptr_env->env_page_directory, (uint32)virtual_address, 0, PERM_MODIFIED);
+	}
 
 	//2020
 	ptr_env->nPageIn++ ;
@@ -616,6 +718,109 @@ int pf_calculate_free_frames()
 	return totalFreeDiskFrames;
 
 }
+
+///============================== SWAP CACHE ==================================
+//return the page file frame of the given page (0 if it has none)
+static uint32 __pf_get_env_page_dfn(struct Env* ptr_env, uint32 virtual_address)
+{
+	uint32 *ptr_disk_page_table;
+	if (ptr_env->disk_env_pgdir == 0) return 0;
+	get_disk_page_table(ptr_env->disk_env_pgdir, virtual_address, 0, &ptr_disk_page_table);
+	if (ptr_disk_page_table == 0) return 0;
+	return ptr_disk_page_table[PTX(virtual_address)];
+}
+
+//Link the frame of a page that is about to be evicted to its page file slot.
+//The page MUST be clean w.r.t. its slot (i.e. not modified, or just written by pf_update_env_page)
+//and the frame MUST be mapped only once, so that free_frame() keeps it cached.
+void pf_swap_cache_insert(struct Env* ptr_env, uint32 virtual_address, struct FrameInfo* ptr_frame_info)
+{
+	uint32 dfn = __pf_get_env_page_dfn(ptr_env, ROUNDDOWN(virtual_address, PAGE_SIZE));
+	if (dfn == 0 || ptr_frame_info->references != 1)
+		return;
+
+	bool lock_already_held = holding_spinlock(&MemFrameLists.mfllock);
+	if (!lock_already_held)
+	{
+		acquire_spinlock(&MemFrameLists.mfllock);
+	}
+	{
+		//drop any older frame that was linked to the same slot
+		if (disk_frames_info[dfn].swapLink != NULL)
+			disk_frames_info[dfn].swapLink->swapLink = NULL;
+
+		disk_frames_info[dfn].swapLink = ptr_frame_info;
+		ptr_frame_info->swapLink = &disk_frames_info[dfn];
+		SwapCacheStats.inserts++;
+	}
+	if (!lock_already_held)
+	{
+		release_spinlock(&MemFrameLists.mfllock);
+	}
+}
+
+//If a free frame still holds the contents of the given page, take it out of the free frame list
+//and return it (with 0 references) so the caller can map it instead of reading the page file.
+//Return NULL otherwise.
+struct FrameInfo* pf_swap_cache_lookup(struct Env* ptr_env, uint32 virtual_address)
+{
+	uint32 dfn = __pf_get_env_page_dfn(ptr_env, ROUNDDOWN(virtual_address, PAGE_SIZE));
+	if (dfn == 0)
+		return NULL;
+
+	struct FrameInfo *ptr_frame_info = NULL;
+	bool lock_already_held = holding_spinlock(&MemFrameLists.mfllock);
+	if (!lock_already_held)
+	{
+		acquire_spinlock(&MemFrameLists.mfllock);
+	}
+	{
+		ptr_frame_info = disk_frames_info[dfn].swapLink;
+		if (ptr_frame_info != NULL)
+		{
+			LIST_REMOVE(&MemFrameLists.free_frame_list, ptr_frame_info);
+			initialize_frame_info(ptr_frame_info);
+			disk_frames_info[dfn].swapLink = NULL;
+			SwapCacheStats.hits++;
+		}
+	}
+	if (!lock_already_held)
+	{
+		release_spinlock(&MemFrameLists.mfllock);
+	}
+	return ptr_frame_info;
+}
+
+//Break the link of the given page file slot (if any). The frame stays in the free frame list as a plain free frame.
+void pf_swap_cache_invalidate(uint32 dfn)
+{
+	bool lock_already_held = holding_spinlock(&MemFrameLists.mfllock);
+	if (!lock_already_held)
+	{
+		acquire_spinlock(&MemFrameLists.mfllock);
+	}
+	{
+		struct FrameInfo *ptr_frame_info = disk_frames_info[dfn].swapLink;
+		if (ptr_frame_info != NULL)
+		{
+			ptr_frame_info->swapLink = NULL;
+			disk_frames_info[dfn].swapLink = NULL;
+			SwapCacheStats.invalidations++;
+		}
+	}
+	if (!lock_already_held)
+	{
+		release_spinlock(&MemFrameLists.mfllock);
+	}
+}
+
+void pf_swap_cache_print_stats()
+{
+	cprintf("Swap cache: hits = %d, misses = %d, inserts = %d, reclaims = %d, invalidations = %d\n",
+			SwapCacheStats.hits, SwapCacheStats.misses, SwapCacheStats.inserts,
+			SwapCacheStats.reclaims, SwapCacheStats.invalidations);
+}
+
 ///========================== END OF PAGE FILE MANAGMENT =============================
 
 
@@ -7,6 +7,7 @@
 #include <inc/x86.h>
 #include <inc/environment_definitions.h>
 #include <kern/conc/spinlock.h>
+#include <kern/disk/block_device.h>
 
 #define SECTOR_SIZE 512
 #define PAGE_FILE_START_SECTOR ( (20<<20) /SECTOR_SIZE)  //start sector number of Page file in H.D.
@@ -15,6 +16,21 @@
 #define PAGE_FILE_SIZE (520 << 20)   	//page file size in MB
 #define PAGES_PER_FILE (PAGE_FILE_SIZE/PAGE_SIZE)
 
+//When a second disk is attached, the page file is striped over both disks (page by page):
+//frame dfn lives on disk (dfn % n) at slot (dfn / n). The second disk holds no boot data,
+//so its stripe starts at its first sector. On the RAM disk, the page file is limited to its size.
+//The backend is chosen at boot (kern/init.c), & can be switched while the page file is empty (pfdev)
+#define PAGE_FILE_SECOND_DISK_START_SECTOR 0
+#define MAX_PAGE_FILE_STRIPES 2
+struct
+{
+	uint8 backend;								//BLK_IDE or BLK_RAMDISK
+	struct BlockDevice* devices[MAX_PAGE_FILE_STRIPES];
+	uint32 startSector[MAX_PAGE_FILE_STRIPES];
+	uint32 numOfStripes;
+	uint32 numOfFrames;							//capacity (frame 0 is never used)
+} PageFileDevices;
+
 ///=============================================================================================
 struct FrameInfo* disk_frames_info;
 struct
@@ -24,6 +40,25 @@ struct
 } DiskFrameLists;
 
 ///=============================================================================================
+//Swap cache: a clean page that is evicted keeps its frame (at the tail of the free frame list)
+//linked to its page file slot, so that a re-fault on that slot maps the frame back without I/O.
+//The links are protected by MemFrameLists.mfllock
+struct
+{
+	uint32 hits;			// re-faults served by a resident frame (no disk read)
+	uint32 misses;			// page reads that had to go to the page file
+	uint32 inserts;			// evicted frames kept linked to their slots
+	uint32 reclaims;		// cached frames handed out again by allocate_frame()
+	uint32 invalidations;	// links dropped since their slot was rewritten or freed
+} SwapCacheStats;
+
+///=============================================================================================
+int pf_set_backend(uint8 backend);
+struct BlockDevice* pf_locate(uint32 dfn, uint32* df_start_sector);
+int allocate_disk_frame(uint32 *dfn);
+void free_disk_frame(uint32 dfn);
+int read_disk_page(uint32 dfn, void* va);
+int write_disk_page(uint32 dfn, void* va);
 int pf_add_empty_env_page( struct Env* ptr_env, uint32 virtual_address, uint8 initializeByZero);
 int pf_add_env_page( struct Env* ptr_env, uint32 virtual_address, void* dataSrc);
 int pf_update_env_page(struct Env* ptr_env, uint32 virtual_address, struct FrameInfo* modified_page_frame_info);
@@ -31,6 +66,11 @@ int pf_update_env_page(struct Env* ptr_env, uint32 virtual_address, struct Frame
 int pf_read_env_page(struct Env* ptr_env, void* virtual_address);
 void pf_remove_env_page(struct Env* ptr_env, uint32 virtual_address);
 ///=============================================================================================
+void pf_swap_cache_insert(struct Env* ptr_env, uint32 virtual_address, struct FrameInfo* ptr_frame_info);
+struct FrameInfo* pf_swap_cache_lookup(struct Env* ptr_env, uint32 virtual_address);
+void pf_swap_cache_invalidate(uint32 dfn);
+void pf_swap_cache_print_stats();
+///=============================================================================================
 
 int pf_calculate_allocated_pages(struct Env* ptr_env);
 int pf_calculate_free_frames();
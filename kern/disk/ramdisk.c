@@ -0,0 +1,71 @@
+/*
+ * ramdisk.c
+ *
+ * Block device backed by physical memory reserved at boot. The transfers are plain
+ * copies, so swapping to it is fast and does not depend on the emulated disk timing.
+ */
+
+#include "ramdisk.h"
+
+#include <inc/disk.h>
+#include <inc/string.h>
+#include <inc/assert.h>
+#include <kern/mem/boot_memory_manager.h>
+
+//Reserve the storage of the RAM disk out of the physical memory. It must be called at boot
+//time before the free frame list is set up, so its frames are never handed out.
+//It takes at most a quarter of the memory that's still free, so the kernel & the envs keep the rest;
+//with too little memory, there's no RAM disk (it's not registered, see blk_init())
+void ramdisk_reserve()
+{
+	uint32 size = ROUNDDOWN(boot_free_space() / 4, PAGE_SIZE);
+	if (size > RAMDISK_MAX_SIZE)
+		size = RAMDISK_MAX_SIZE;
+	if (size < RAMDISK_MIN_SIZE)
+	{
+		cprintf("*	RAM disk: not reserved, only %dK of physical memory is left\n", boot_free_space() / 1024);
+		ramdisk_storage = NULL;
+		ramdisk_size = 0;
+		return;
+	}
+	ramdisk_storage = boot_allocate_space(size, PAGE_SIZE);
+	ramdisk_size = size;
+}
+
+static int ramdisk_read(struct BlockDevice* dev, uint32 secno, void* dst, uint32 nsecs)
+{
+	if (secno + nsecs > dev->numOfSectors)
+		return -1;
+	memcpy(dst, dev->storage + secno * SECTSIZE, nsecs * SECTSIZE);
+	return 0;
+}
+
+static int ramdisk_write(struct BlockDevice* dev, uint32 secno, const void* src, uint32 nsecs)
+{
+	if (secno + nsecs > dev->numOfSectors)
+		return -1;
+	memcpy(dev->storage + secno * SECTSIZE, src, nsecs * SECTSIZE);
+	return 0;
+}
+
+//there's no queue: a request is served right away
+static int ramdisk_submit(struct BlockDevice* dev, uint32 secno, void* buffer, uint32 nsecs, uint8 write)
+{
+	return write ? ramdisk_write(dev, secno, buffer, nsecs) : ramdisk_read(dev, secno, buffer, nsecs);
+}
+
+static int ramdisk_flush(struct BlockDevice* dev)
+{
+	return 0;
+}
+
+void ramdisk_attach(struct BlockDevice* dev)
+{
+	assert(ramdisk_storage != NULL);
+	dev->storage = ramdisk_storage;
+	dev->numOfSectors = ramdisk_size / SECTSIZE;
+	dev->read = ramdisk_read;
+	dev->write = ramdisk_write;
+	dev->submit = ramdisk_submit;
+	dev->flush = ramdisk_flush;
+}
@@ -0,0 +1,26 @@
+/*
+ * ramdisk.h
+ *
+ * Block device backed by physical memory reserved at boot.
+ */
+
+#ifndef FOS_KERN_RAMDISK_H
+#define FOS_KERN_RAMDISK_H
+#ifndef FOS_KERNEL
+# error "This is a FOS kernel header; user programs should not #include it"
+#endif
+
+#include <inc/types.h>
+#include <kern/disk/block_device.h>
+
+#define RAMDISK_MAX_SIZE (32 << 20)	//max size of the RAM disk (in bytes)
+#define RAMDISK_MIN_SIZE (1 << 20)		//there's no RAM disk if less than this can be reserved
+
+uint8* ramdisk_storage;				//reserved by initialize_kernel_VM() (NULL if there's no RAM disk)
+uint32 ramdisk_size;				//its size (in bytes)
+
+///=============================================================================================
+void ramdisk_reserve();
+void ramdisk_attach(struct BlockDevice* dev);
+
+#endif //FOS_KERN_RAMDISK_H
@@ -0,0 +1,492 @@
+/*
+ * zswap.c
+ *
+ * Compressed in-memory swap tier: pages evicted by the page fault handler are
+ * compressed into a RAM pool instead of being written to the page file. They are
+ * written back to the disk only when the pool gets full (oldest first).
+ */
+
+#include "zswap.h"
+#include "pagefile_manager.h"
+
+#include <inc/mmu.h>
+#include <inc/error.h>
+#include <inc/string.h>
+#include <inc/assert.h>
+
+#include "../mem/kheap.h"
+#include "../mem/memory_manager.h"
+
+///============================== LZ COMPRESSOR ==================================
+//A small LZ77 compressor in the spirit of LZ4. The output is a series of sequences:
+//	token:		[literals length (4 bits) | match length - LZ_MIN_MATCH (4 bits)]
+//	[extra literals length bytes (if the nibble = 15): 255, 255, ..., < 255]
+//	literals
+//	offset:		2 bytes (little endian), back reference to the match
+//	[extra match length bytes (if the nibble = 15)]
+//The last sequence has literals only (no offset).
+
+#define LZ_MIN_MATCH 4
+
+//hash table of zswap_store(). Protected by Zswap.zlock
+static uint16 lz_hash_table[LZ_HASH_SIZE];
+
+static inline uint32 lz_read32(const uint8* p)
+{
+	return *(const uint32*)p;
+}
+
+static inline uint32 lz_hash(uint32 seq)
+{
+	return (seq * 2654435761U) >> (32 - LZ_HASH_BITS);
+}
+
+//write the extra bytes of a length whose nibble is 15. Return the new output position, or 0 if it doesn't fit
+static inline uint32 lz_put_length(uint8* dst, uint32 op, uint32 dstCap, uint32 len)
+{
+	for (; len >= 255; len -= 255)
+	{
+		if (op >= dstCap) return 0;
+		dst[op++] = 255;
+	}
+	if (op >= dstCap) return 0;
+	dst[op++] = len;
+	return op;
+}
+
+//emit one sequence (matchLen = 0 for the last one). Return the new output position, or 0 if it doesn't fit
+static uint32 lz_put_sequence(uint8* dst, uint32 op, uint32 dstCap, const uint8* literals, uint32 litLen, uint32 offset, uint32 matchLen)
+{
+	uint32 matchCode = matchLen ? matchLen - LZ_MIN_MATCH : 0;
+	if (op >= dstCap) return 0;
+	dst[op++] = ((litLen < 15 ? litLen : 15) << 4) | (matchCode < 15 ? matchCode : 15);
+	if (litLen >= 15 && (op = lz_put_length(dst, op, dstCap, litLen - 15)) == 0)
+		return 0;
+	if (op + litLen > dstCap) return 0;
+	memcpy(dst + op, literals, litLen);
+	op += litLen;
+	if (matchLen == 0)
+		return op;
+	if (op + 2 > dstCap) return 0;
+	dst[op++] = offset & 0xFF;
+	dst[op++] = offset >> 8;
+	if (matchCode >= 15 && (op = lz_put_length(dst, op, dstCap, matchCode - 15)) == 0)
+		return 0;
+	return op;
+}
+
+//Compress srcLen (<= 64 KB) bytes of src into dst, using the given hash table of LZ_HASH_SIZE
+//entries (the positions (+1) of the last occurrence of each hashed 4-byte sequence), owned by the
+//caller so concurrent compressors don't share it.
+//Return the compressed length, or 0 if it doesn't fit in dstCap bytes
+uint32 lz_compress(const uint8* src, uint32 srcLen, uint8* dst, uint32 dstCap, uint16* hashTable)
+{
+	uint32 ip = 0, anchor = 0, op = 0;
+	memset(hashTable, 0, LZ_HASH_SIZE * sizeof(uint16));
+
+	while (ip + LZ_MIN_MATCH <= srcLen)
+	{
+		uint32 seq = lz_read32(src + ip);
+		uint32 h = lz_hash(seq);
+		uint32 candidate = hashTable[h];
+		hashTable[h] = ip + 1;
+		if (candidate == 0 || lz_read32(src + candidate - 1) != seq)
+		{
+			ip++;
+			continue;
+		}
+		uint32 ref = candidate - 1;
+		uint32 matchLen = LZ_MIN_MATCH;
+		while (ip + matchLen < srcLen && src[ref + matchLen] == src[ip + matchLen])
+			matchLen++;
+
+		op = lz_put_sequence(dst, op, dstCap, src + anchor, ip - anchor, ip - ref, matchLen);
+		if (op == 0)
+			return 0;
+		ip += matchLen;
+		anchor = ip;
+	}
+	return lz_put_sequence(dst, op, dstCap, src + anchor, srcLen - anchor, 0, 0);
+}
+
+//Decompress srcLen bytes of src into dst.
+//Return the decompressed length, or 0 if the data is corrupted or doesn't fit in dstCap bytes
+uint32 lz_decompress(const uint8* src, uint32 srcLen, uint8* dst, uint32 dstCap)
+{
+	uint32 ip = 0, op = 0;
+	while (ip < srcLen)
+	{
+		uint8 token = src[ip++];
+		uint32 litLen = token >> 4;
+		if (litLen == 15)
+		{
+			uint8 b;
+			do
+			{
+				if (ip >= srcLen) return 0;
+				b = src[ip++];
+				litLen += b;
+			} while (b == 255);
+		}
+		if (ip + litLen > srcLen || op + litLen > dstCap) return 0;
+		memcpy(dst + op, src + ip, litLen);
+		ip += litLen;
+		op += litLen;
+		if (ip == srcLen)
+			break;
+
+		if (ip + 2 > srcLen) return 0;
+		uint32 offset = src[ip] | (src[ip + 1] << 8);
+		ip += 2;
+		uint32 matchLen = (token & 0xF);
+		if (matchLen == 15)
+		{
+			uint8 b;
+			do
+			{
+				if (ip >= srcLen) return 0;
+				b = src[ip++];
+				matchLen += b;
+			} while (b == 255);
+		}
+		matchLen += LZ_MIN_MATCH;
+		if (offset == 0 || offset > op || op + matchLen > dstCap) return 0;
+		//byte by byte since the match may overlap the output
+		uint8* ref = dst + op - offset;
+		for (uint32 i = 0; i < matchLen; i++)
+			dst[op + i] = ref[i];
+		op += matchLen;
+	}
+	return op;
+}
+
+///============================== COMPRESSED POOL ==================================
+#define UNIT_IS_USED(u) (Zswap.unitsBitmap[(u) / 32] & (1 << ((u) % 32)))
+
+static void __zswap_mark_units(uint32 first, uint32 n, uint8 used)
+{
+	for (uint32 u = first; u < first + n; u++)
+	{
+		if (used)
+			Zswap.unitsBitmap[u / 32] |= (1 << (u % 32));
+		else
+			Zswap.unitsBitmap[u / 32] &= ~(1 << (u % 32));
+	}
+}
+
+//next-fit search for n contiguous free units. Return the first one, or -1 if not found
+static int __zswap_alloc_units(uint32 n)
+{
+	uint32 u = Zswap.nextUnit, run = 0;
+	for (uint32 scanned = 0; scanned < Zswap.numOfUnits + n; scanned++, u++)
+	{
+		if (u == Zswap.numOfUnits)
+		{
+			u = 0;
+			run = 0;
+		}
+		if (UNIT_IS_USED(u))
+		{
+			run = 0;
+			continue;
+		}
+		if (++run == n)
+		{
+			uint32 first = u + 1 - n;
+			__zswap_mark_units(first, n, 1);
+			Zswap.nextUnit = (u + 1) % Zswap.numOfUnits;
+			return first;
+		}
+	}
+	return -1;
+}
+
+static inline uint32 __zswap_units_of(uint32 length)
+{
+	return ROUNDUP(length, ZSWAP_UNIT_SIZE) / ZSWAP_UNIT_SIZE;
+}
+
+static inline uint32 __zswap_hash(uint32 dfn)
+{
+	return dfn % ZSWAP_HASH_SIZE;
+}
+
+static struct ZswapEntry* __zswap_find(uint32 dfn)
+{
+	struct ZswapEntry* e = Zswap.hash[__zswap_hash(dfn)];
+	while (e != NULL && e->dfn != dfn)
+		e = e->hashNext;
+	return e;
+}
+
+static void __zswap_unhash(struct ZswapEntry* e)
+{
+	struct ZswapEntry** pp = &Zswap.hash[__zswap_hash(e->dfn)];
+	while (*pp != e)
+		pp = &(*pp)->hashNext;
+	*pp = e->hashNext;
+	e->hashNext = NULL;
+}
+
+//give the entry and its units back. The entry must be already unhashed and out of the LRU list
+static void __zswap_release(struct ZswapEntry* e)
+{
+	__zswap_mark_units(e->firstUnit, __zswap_units_of(e->length), 0);
+	ZswapStats.storedPages--;
+	ZswapStats.storedBytes -= e->length;
+	e->dfn = 0;
+	e->inWriteBack = 0;
+	LIST_INSERT_HEAD(&Zswap.free_list, e);
+}
+
+//drop the stored copy of the given entry (it's no longer valid or it's moved to memory).
+//An entry being written back is only orphaned, its writer releases it.
+static void __zswap_drop(struct ZswapEntry* e)
+{
+	__zswap_unhash(e);
+	if (e->inWriteBack)
+	{
+		e->dfn = 0;
+		return;
+	}
+	LIST_REMOVE(&Zswap.lru_list, e);
+	__zswap_release(e);
+}
+
+//Write the oldest stored page back to the page file to free pool space.
+//Called with Zswap.zlock held and returns with it held, but releases it during the disk write.
+//Return 0 if there's nothing to write back.
+static int __zswap_write_back_oldest(uint8* pageBuffer)
+{
+	struct ZswapEntry* e = LIST_LAST(&Zswap.lru_list);
+	if (e == NULL)
+		return 0;
+
+	LIST_REMOVE(&Zswap.lru_list, e);
+	e->inWriteBack = 1;
+	uint32 dfn = e->dfn;
+	uint32 len = lz_decompress(Zswap.pool + e->firstUnit * ZSWAP_UNIT_SIZE, e->length, pageBuffer, PAGE_SIZE);
+	assert(len == PAGE_SIZE);
+
+	//the entry stays hashed till the write completes, so a concurrent fault still loads it from the
+	//pool instead of reading the slot before it's written. It's written directly (not by
+	//write_disk_page(), which would invalidate the slot, i.e. unhash the entry, before the write)
+	release_spinlock(&Zswap.zlock);
+	{
+		uint32 sector;
+		struct BlockDevice* dev = pf_locate(dfn, &sector);
+		if (blk_submit(dev, sector, pageBuffer, SECTOR_PER_PAGE, 1) != 0)
+			panic("zswap: error writing back a page to the page file\n");
+	}
+	acquire_spinlock(&Zswap.zlock);
+
+	//the slot is on the disk now, unless the entry was loaded, rewritten or freed meanwhile
+	//(it's orphaned then, i.e. already unhashed)
+	if (e->dfn != 0)
+		__zswap_unhash(e);
+	__zswap_release(e);
+	ZswapStats.writeBacks++;
+	return 1;
+}
+
+///============================== INTERFACE ==================================
+//Allocate a pool of the given number of pages and start storing evicted pages in it
+int zswap_enable(uint32 poolPages)
+{
+#if USE_KHEAP
+	if (Zswap.enabled)
+		return 0;
+	if (poolPages == 0)
+		poolPages = ZSWAP_DEFAULT_POOL_PAGES;
+
+	init_spinlock(&Zswap.zlock, "zswap lock");
+	Zswap.numOfUnits = poolPages * PAGE_SIZE / ZSWAP_UNIT_SIZE;
+	Zswap.numOfEntries = poolPages * ZSWAP_ENTRIES_PER_POOL_PAGE;
+	Zswap.pool = kmalloc(poolPages * PAGE_SIZE);
+	Zswap.unitsBitmap = kmalloc(ROUNDUP(Zswap.numOfUnits, 32) / 8);
+	Zswap.entries = kmalloc(Zswap.numOfEntries * sizeof(struct ZswapEntry));
+	Zswap.buffer = kmalloc(PAGE_SIZE);
+	if (Zswap.pool == NULL || Zswap.unitsBitmap == NULL || Zswap.entries == NULL || Zswap.buffer == NULL)
+	{
+		if (Zswap.pool) kfree(Zswap.pool);
+		if (Zswap.unitsBitmap) kfree(Zswap.unitsBitmap);
+		if (Zswap.entries) kfree(Zswap.entries);
+		if (Zswap.buffer) kfree(Zswap.buffer);
+		Zswap.pool = NULL; Zswap.unitsBitmap = NULL; Zswap.entries = NULL; Zswap.buffer = NULL;
+		return E_NO_MEM;
+	}
+	memset(Zswap.unitsBitmap, 0, ROUNDUP(Zswap.numOfUnits, 32) / 8);
+	memset(Zswap.hash, 0, sizeof(Zswap.hash));
+	Zswap.nextUnit = 0;
+	LIST_INIT(&Zswap.free_list);
+	LIST_INIT(&Zswap.lru_list);
+	for (int i = 0; i < Zswap.numOfEntries; i++)
+	{
+		memset(&Zswap.entries[i], 0, sizeof(struct ZswapEntry));
+		LIST_INSERT_HEAD(&Zswap.free_list, &Zswap.entries[i]);
+	}
+	memset(&ZswapStats, 0, sizeof(ZswapStats));
+	Zswap.enabled = 1;
+	return 0;
+#else
+	return E_NO_MEM;
+#endif
+}
+
+//Write all the stored pages back to the page file and free the pool
+void zswap_disable()
+{
+#if USE_KHEAP
+	if (!Zswap.enabled)
+		return;
+	uint8* pageBuffer = kmalloc(PAGE_SIZE);
+	if (pageBuffer == NULL)
+		panic("zswap_disable: no kernel heap space for the write back buffer");
+
+	acquire_spinlock(&Zswap.zlock);
+	{
+		Zswap.enabled = 0;
+		while (__zswap_write_back_oldest(pageBuffer))
+			;
+	}
+	release_spinlock(&Zswap.zlock);
+
+	kfree(pageBuffer);
+	kfree(Zswap.pool);
+	kfree(Zswap.unitsBitmap);
+	kfree(Zswap.entries);
+	kfree(Zswap.buffer);
+	Zswap.pool = NULL; Zswap.unitsBitmap = NULL; Zswap.entries = NULL; Zswap.buffer = NULL;
+#endif
+}
+
+//Store the page at src as the new contents of the given page file slot.
+//Return 0 if it's stored, or E_NO_MEM if the caller should write it to disk instead
+int zswap_store(uint32 dfn, void* src)
+{
+	if (!Zswap.enabled)
+		return E_NO_MEM;
+
+	uint8* pageBuffer = NULL;
+	int ret = E_NO_MEM;
+	acquire_spinlock(&Zswap.zlock);
+	while (Zswap.enabled)
+	{
+		//drop the older copy of this slot (if any)
+		struct ZswapEntry* e = __zswap_find(dfn);
+		if (e != NULL)
+			__zswap_drop(e);
+
+		uint32 length = lz_compress(src, PAGE_SIZE, Zswap.buffer, ZSWAP_MAX_COMPRESSED_SIZE, lz_hash_table);
+		if (length == 0)
+		{
+			ZswapStats.rejects++;
+			break;
+		}
+
+		int first = -1;
+		e = LIST_FIRST(&Zswap.free_list);
+		if (e != NULL)
+			first = __zswap_alloc_units(__zswap_units_of(length));
+		if (first >= 0)
+		{
+			LIST_REMOVE(&Zswap.free_list, e);
+			e->dfn = dfn;
+			e->firstUnit = first;
+			e->length = length;
+			e->inWriteBack = 0;
+			memcpy(Zswap.pool + first * ZSWAP_UNIT_SIZE, Zswap.buffer, length);
+			e->hashNext = Zswap.hash[__zswap_hash(dfn)];
+			Zswap.hash[__zswap_hash(dfn)] = e;
+			LIST_INSERT_HEAD(&Zswap.lru_list, e);
+			ZswapStats.stores++;
+			ZswapStats.storedPages++;
+			ZswapStats.storedBytes += length;
+			ret = 0;
+			break;
+		}
+
+		//pool is full: write the oldest page back to disk and retry
+		if (pageBuffer == NULL)
+		{
+			release_spinlock(&Zswap.zlock);
+			pageBuffer = kmalloc(PAGE_SIZE);
+			acquire_spinlock(&Zswap.zlock);
+			if (pageBuffer == NULL)
+				break;
+			continue;
+		}
+		if (!__zswap_write_back_oldest(pageBuffer))
+			break;
+	}
+	release_spinlock(&Zswap.zlock);
+
+	if (pageBuffer != NULL)
+		kfree(pageBuffer);
+
+	if (ret == 0)
+	{
+		//the slot contents are changed, so no resident frame matches it anymore
+		pf_swap_cache_invalidate(dfn);
+	}
+	return ret;
+}
+
+//Decompress the stored copy of the given slot into dst and drop it from the pool.
+//Return 0 on success, or E_PAGE_NOT_EXIST_IN_PF if the slot is not stored here
+int zswap_load(uint32 dfn, void* dst)
+{
+	//still look it up while disabling (i.e. writing back the pool)
+	if (Zswap.pool == NULL)
+		return E_PAGE_NOT_EXIST_IN_PF;
+
+	int ret = E_PAGE_NOT_EXIST_IN_PF;
+	acquire_spinlock(&Zswap.zlock);
+	{
+		struct ZswapEntry* e = __zswap_find(dfn);
+		if (e != NULL)
+		{
+			uint32 len = lz_decompress(Zswap.pool + e->firstUnit * ZSWAP_UNIT_SIZE, e->length, dst, PAGE_SIZE);
+			assert(len == PAGE_SIZE);
+			__zswap_drop(e);
+			ZswapStats.loads++;
+			ret = 0;
+		}
+	}
+	release_spinlock(&Zswap.zlock);
+	return ret;
+}
+
+//Drop the stored copy of the given slot (if any) since the slot is rewritten or freed
+void zswap_invalidate(uint32 dfn)
+{
+	if (Zswap.pool == NULL)
+		return;
+
+	acquire_spinlock(&Zswap.zlock);
+	{
+		struct ZswapEntry* e = __zswap_find(dfn);
+		if (e != NULL)
+		{
+			if (!e->inWriteBack)
+				ZswapStats.invalidations++;
+			__zswap_drop(e);
+		}
+	}
+	release_spinlock(&Zswap.zlock);
+}
+
+void zswap_print_stats()
+{
+	uint32 reads = ZswapStats.loads + ZswapStats.diskReads;
+	cprintf("Zswap [%s]: stored pages = %d, compressed size = %d bytes", Zswap.enabled ? "ON" : "OFF",
+			ZswapStats.storedPages, ZswapStats.storedBytes);
+	if (ZswapStats.storedBytes > 0)
+	{
+		uint32 ratioX10 = (ZswapStats.storedPages * PAGE_SIZE) / ((ZswapStats.storedBytes + 9) / 10);
+		cprintf(" (ratio = %d.%d : 1)", ratioX10 / 10, ratioX10 % 10);
+	}
+	cprintf("\n\tstores = %d, rejects = %d, loads = %d, disk reads = %d, hit rate = %d%%, write backs = %d, invalidations = %d\n",
+			ZswapStats.stores, ZswapStats.rejects, ZswapStats.loads, ZswapStats.diskReads,
+			reads ? (ZswapStats.loads * 100) / reads : 0, ZswapStats.writeBacks, ZswapStats.invalidations);
+}
@@ -0,0 +1,79 @@
+/*
+ * zswap.h
+ *
+ * Compressed in-memory swap tier that sits in front of the IDE page file.
+ */
+
+#ifndef FOS_KERN_ZSWAP_H
+#define FOS_KERN_ZSWAP_H
+#ifndef FOS_KERNEL
+# error "This is a FOS kernel header; user programs should not #include it"
+#endif
+
+#include <inc/types.h>
+#include <inc/stdio.h>
+#include <inc/mmu.h>
+#include <inc/queue.h>
+#include <kern/conc/spinlock.h>
+
+#define ZSWAP_UNIT_SIZE 64							//allocation unit of the compressed pool (in bytes)
+#define ZSWAP_MAX_COMPRESSED_SIZE (PAGE_SIZE*3/4)	//pages that do not compress below this size go directly to disk
+#define ZSWAP_ENTRIES_PER_POOL_PAGE 16				//max number of stored pages per pool page
+#define ZSWAP_HASH_SIZE 1024						//number of buckets of the (dfn -> entry) hash table
+#define ZSWAP_DEFAULT_POOL_PAGES 256				//default pool size (1 MB)
+
+///=============================================================================================
+struct ZswapEntry
+{
+	LIST_ENTRY(ZswapEntry) prev_next_info;	//link in the free or the LRU list
+	struct ZswapEntry *hashNext;			//next entry in the same hash bucket
+	uint32 dfn;								//page file slot whose contents are stored (0 if it's orphaned)
+	uint32 firstUnit;						//first pool unit of the compressed data
+	uint16 length;							//length of the compressed data (in bytes)
+	uint8 inWriteBack;						//being written back to the page file
+};
+LIST_HEAD(ZswapEntry_List, ZswapEntry);
+
+struct
+{
+	uint8 enabled;
+	uint8* pool;							//compressed data
+	uint32* unitsBitmap;					//one bit per pool unit (1 = used)
+	uint32 numOfUnits;
+	uint32 nextUnit;						//where the next-fit search of the pool starts
+	uint8* buffer;							//compression output buffer
+	struct ZswapEntry* entries;
+	uint32 numOfEntries;
+	struct ZswapEntry_List free_list;		//unused entries
+	struct ZswapEntry_List lru_list;		//stored entries (head = most recently stored)
+	struct ZswapEntry* hash[ZSWAP_HASH_SIZE];
+	struct spinlock zlock;					//protects all the above
+} Zswap;
+
+struct
+{
+	uint32 stores;			//pages stored compressed instead of being written to disk
+	uint32 rejects;			//pages that did not compress well enough (went to disk)
+	uint32 loads;			//page reads served by decompression
+	uint32 diskReads;		//page reads that had to go to the page file
+	uint32 writeBacks;		//stored pages pushed to the page file to free pool space
+	uint32 invalidations;	//stored pages dropped since their slot was rewritten or freed
+	uint32 storedPages;		//currently stored pages
+	uint32 storedBytes;		//their total compressed size
+} ZswapStats;
+
+///=============================================================================================
+int zswap_enable(uint32 poolPages);
+void zswap_disable();
+int zswap_store(uint32 dfn, void* src);
+int zswap_load(uint32 dfn, void* dst);
+void zswap_invalidate(uint32 dfn);
+void zswap_print_stats();
+
+#define LZ_HASH_BITS 12
+#define LZ_HASH_SIZE (1 << LZ_HASH_BITS)		//entries of the hash table of lz_compress()
+
+uint32 lz_compress(const uint8* src, uint32 srcLen, uint8* dst, uint32 dstCap, uint16* hashTable);
+uint32 lz_decompress(const uint8* src, uint32 srcLen, uint8* dst, uint32 dstCap);
+
+#endif //FOS_KERN_ZSWAP_H
@@ -17,6 +17,9 @@
 #include <kern/cpu/sched.h>
 #include <kern/cpu/picirq.h>
 #include <kern/cpu/cpu.h>
+#include <kern/cpu/lapic.h>
+#include <kern/cpu/mp.h>
+#include <kern/conc/futex.h>
 #include <kern/mem/boot_memory_manager.h>
 #include <kern/mem/kheap.h>
 #include <kern/mem/memory_manager.h>
@@ -26,6 +29,8 @@
 #include <kern/tests/test_dynamic_allocator.h>
 #include <kern/tests/test_commands.h>
 #include <kern/disk/pagefile_manager.h>
+#include <kern/disk/io_scheduler.h>
+#include <kern/disk/block_device.h>
 
 extern int sys_calculate_free_frames();
 
@@ -66,6 +71,8 @@ void FOS_initialize()
 	{
 		//Initialize the Main CPU
 		cpu_init(0);
+		//Find the other CPUs (if any) in the MP tables. They're started after the scheduler is initialized
+		mp_init();
 	}
 	cprintf("[DONE]\n");
 
@@ -75,6 +82,7 @@ void FOS_initialize()
 		detect_memory();
 		initialize_kernel_VM();
 		initialize_paging();
+		lapic_init();
 		sharing_init();
 
 #if USE_KHEAP
@@ -95,6 +103,10 @@ void FOS_initialize()
 		setModifiedBufferLength(1000);
 
 		ide_init();
+		io_scheduler_init();
+		blk_init();
+		//Specify the backend of the page file (BLK_IDE or BLK_RAMDISK); it can be switched by pfdev
+		pf_set_backend(BLK_IDE);
 	}
 	//cprintf("* [DONE]\n");
 
@@ -103,6 +115,7 @@ void FOS_initialize()
 		// Lab 3 user environment initialization functions
 		env_init();
 		ts_init();
+		futex_init();
 		//2024: removed. called inside cpuinit()
 		//idt_init();
 	}
@@ -142,6 +155,12 @@ void FOS_initialize()
 		write_esp(new_sp);
 		cprintf("*	old SP = %x - updated SP = %x\n", old_sp, read_esp());
 	}
+	cprintf("* 7) APPLICATION PROCESSORS:\n");
+	{
+		//Start the other CPUs: each one runs its own scheduler on its own stack
+		boot_aps();
+		cprintf("*	%d CPU(s) are running\n", ncpu);
+	}
 	cprintf("********************************************************************\n");
 
 	// start the kernel command prompt.
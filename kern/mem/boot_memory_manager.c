@@ -7,7 +7,9 @@
 
 #include <kern/proc/user_environment.h>
 #include <kern/disk/pagefile_manager.h>
+#include <kern/disk/ramdisk.h>
 #include <kern/cpu/cpu.h>
+#include <kern/cpu/lapic.h>
 #include "memory_manager.h"
 
 
@@ -153,6 +155,10 @@ void initialize_kernel_VM()
 	disk_frames_info = boot_allocate_space(disk_array_size , PAGE_SIZE);
 	/*2023: this line is moved to the boot_allocate_space()*/ //memset(disk_frames_info , 0, disk_array_size);
 
+	//the RAM disk storage is taken out of the physical memory (sized by what's left of it), so the
+	//page file can be switched to it at any time (see pf_set_backend())
+	ramdisk_reserve();
+
 	// This allows the kernel & user to access any page table entry using a
 	// specified VA for each: VPT for kernel and UVPT for User.
 	setup_listing_to_all_page_tables_entries();
@@ -179,6 +185,10 @@ void initialize_kernel_VM()
 	//update permissions of the corresponding entry in page directory to make it USER with PERMISSION read only
 	ptr_page_directory[PDX(UENVS)] = ptr_page_directory[PDX(UENVS)]|(PERM_USER|(PERM_PRESENT & (~PERM_WRITEABLE)));
 
+	// Map the registers of the local APIC (if any, see mp_init()) in the top kernel page, uncached
+	// (before the mapping below, since it may allocate a page table)
+	if (lapic_pa != 0)
+		boot_map_range(ptr_page_directory, LAPIC_VA, PAGE_SIZE, lapic_pa, PERM_WRITEABLE | PTE_PCD | PTE_PWT) ;
 
 #if USE_KHEAP
 	{
@@ -189,7 +199,8 @@ void initialize_kernel_VM()
 	}
 #else
 	{
-		boot_map_range(ptr_page_directory, KERNEL_BASE, 0xFFFFFFFF - KERNEL_BASE, 0, PERM_WRITEABLE) ;
+		//the top page is kept for the local APIC registers
+		boot_map_range(ptr_page_directory, KERNEL_BASE, LAPIC_VA - KERNEL_BASE, 0, PERM_WRITEABLE) ;
 	}
 #endif
 	// Check that the initial page directory has been set up correctly.
@@ -231,6 +242,10 @@ void* boot_allocate_space(uint32 size, uint32 align)
 	//	Step 1: round ptr_free_mem up to be aligned properly
 	ptr_free_mem = ROUNDUP(ptr_free_mem, align) ;
 
+	//	Step 1.5: make sure that the allocated space is within the physical memory
+	if (size > boot_free_space())
+		panic("boot_allocate_space: out of physical memory (%d bytes requested, %d bytes left)", size, boot_free_space());
+
 	//	Step 2: save current value of ptr_free_mem as allocated space
 	void *ptr_allocated_mem;
 	ptr_allocated_mem = ptr_free_mem ;
@@ -249,6 +264,19 @@ void* boot_allocate_space(uint32 size, uint32 align)
 
 }
 
+//
+// Return the # of bytes of physical memory (detected by detect_memory()) that are still
+// available to boot_allocate_space(), i.e. above ptr_free_mem.
+//
+uint32 boot_free_space()
+{
+	extern char end_of_kernel[];
+	char* ptr = (ptr_free_mem == 0) ? end_of_kernel : ptr_free_mem;
+	uint32 usedPA = STATIC_KERNEL_PHYSICAL_ADDRESS(ptr);
+	uint32 maxPA = number_of_frames * PAGE_SIZE;
+	return (usedPA < maxPA) ? maxPA - usedPA : 0;
+}
+
 
 //
 // Map [virtual_address, virtual_address+size) of virtual address space to
@@ -38,6 +38,7 @@ struct
 void 	boot_map_range(uint32 *ptr_page_directory, uint32 virtual_address, uint32 size, uint32 physical_address, int perm);
 uint32* boot_get_page_table(uint32 *ptr_page_directory, uint32 virtual_address, int create);
 void* 	boot_allocate_space(uint32 size, uint32 align);
+uint32	boot_free_space();
 void 	initialize_kernel_VM();
 void 	initialize_paging();
 void	detect_memory();
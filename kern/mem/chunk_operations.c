@@ -217,6 +217,34 @@ void move_user_mem(struct Env* e, uint32 src_virtual_address, uint32 dst_virtual
 	panic("move_user_mem() is not implemented yet...!!");
 }
 
+//=====================================
+// 4) FIND FREE USER PAGES:
+//=====================================
+//VA of the first range of noOfPages free (not taken) pages in the user heap of the given env,
+//or 0 if none. Each page table is walked once (a missing one is 1024 free pages)
+uint32 find_free_user_pages(struct Env* e, uint32 noOfPages)
+{
+	if (_UHeapPlacementStrategy != UHP_PLACE_FIRSTFIT || noOfPages == 0)
+		return 0;
+	uint32 firstPointer = 0, c = 0;
+	uint32 *ptr_page_table = NULL;
+	for (uint32 va = (uint32)e->rlimit + PAGE_SIZE; va < USER_HEAP_MAX; va += PAGE_SIZE)
+	{
+		if (va == (uint32)e->rlimit + PAGE_SIZE || PTX(va) == 0)
+			get_page_table(e->env_page_directory, va, &ptr_page_table);
+		if (ptr_page_table != NULL && (ptr_page_table[PTX(va)] & PTR_TAKEN))
+		{
+			c = 0;
+			continue;
+		}
+		if (++c == 1)
+			firstPointer = va;
+		if (c == noOfPages)
+			return firstPointer;
+	}
+	return 0;
+}
+
 //=================================================================================//
 //========================== END USER CHUNKS MANIPULATION =========================//
 //=================================================================================//
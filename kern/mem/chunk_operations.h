@@ -30,5 +30,6 @@ void free_user_mem(struct Env* e, uint32 virtual_address, uint32 size);
 void allocate_user_mem(struct Env* e, uint32 virtual_address, uint32 size);
 void move_user_mem(struct Env* e, uint32 src_virtual_address, uint32 dst_virtual_address, uint32 size);
 void __free_user_mem_with_buffering(struct Env* e, uint32 virtual_address, uint32 size);
+uint32 find_free_user_pages(struct Env* e, uint32 noOfPages);
 
 #endif /* KERN_MEM_CHUNK_OPERATIONS_H_ */
@@ -3,6 +3,11 @@
 #include <inc/memlayout.h>
 #include <inc/dynamic_allocator.h>
 #include "memory_manager.h"
+#include <kern/conc/spinlock.h>
+
+//protects the kernel heap: its break, its page allocator & its block allocator (whose free list
+//is shared by all the CPUs, e.g. by the page faults that create the WS elements)
+static struct spinlock kheaplock;
 
 
 // Initialize the dynamic allocator of kernel heap with the given start address, size & limit
@@ -18,6 +23,7 @@ int initialize_kheap_dynamic_allocator(uint32 daStart, uint32 initSizeToAllocate
 	da_Start = (uint32 *)daStart;
 	brk = (uint32 *)((uint32)da_Start + initSizeToAllocate);
 	rlimit = (uint32 *)daLimit;
+	init_spinlock(&kheaplock, "kernel heap lock");
 	struct FrameInfo *ptr_frame_info;
 	int ret;
 	for (uint32 i = daStart; i < daStart + initSizeToAllocate; i += PAGE_SIZE)
@@ -68,7 +74,35 @@ void *sbrk(int numOfPages)
 
 // TODO: [PROJECT'24.MS2 - BONUS#2] [1] KERNEL HEAP - Fast Page Allocator
 
+//The unlocked bodies of kmalloc/kfree/krealloc (called with the kheaplock held)
+static void *__kmalloc(unsigned int size);
+static void __kfree(void *virtual_address);
+static void *__krealloc(void *virtual_address, uint32 new_size);
+
 void *kmalloc(unsigned int size)
+{
+	acquire_spinlock(&kheaplock);
+	void *va = __kmalloc(size);
+	release_spinlock(&kheaplock);
+	return va;
+}
+
+void kfree(void *virtual_address)
+{
+	acquire_spinlock(&kheaplock);
+	__kfree(virtual_address);
+	release_spinlock(&kheaplock);
+}
+
+void *krealloc(void *virtual_address, uint32 new_size)
+{
+	acquire_spinlock(&kheaplock);
+	void *va = __krealloc(virtual_address, new_size);
+	release_spinlock(&kheaplock);
+	return va;
+}
+
+static void *__kmalloc(unsigned int size)
 {
 	if (!size)
 		return NULL;
@@ -118,7 +152,7 @@ void *kmalloc(unsigned int size)
 	return NULL;
 }
 
-void kfree(void *virtual_address)
+static void __kfree(void *virtual_address)
 {
 	void *va = virtual_address;
 	if (va < sbrk(0) && (uint32 *)va > da_Start)
@@ -199,12 +233,12 @@ unsigned int kheap_virtual_address(unsigned int physical_address)
 //	A call with virtual_address = null is equivalent to kmalloc().
 //	A call with new_size = zero is equivalent to kfree().
 
-void *krealloc(void *virtual_address, uint32 new_size)
+static void *__krealloc(void *virtual_address, uint32 new_size)
 {
-	if(!virtual_address) return kmalloc(new_size);
+	if(!virtual_address) return __kmalloc(new_size);
 	if(!new_size)
 	{
-		kfree(virtual_address);
+		__kfree(virtual_address);
 		return NULL;
 	}
 
@@ -213,8 +247,8 @@ void *krealloc(void *virtual_address, uint32 new_size)
 	{
 		if(new_size > 2*1024)
 		{
-			kfree(va);
-			return kmalloc(new_size);
+			__kfree(va);
+			return __kmalloc(new_size);
 		}
 		return realloc_block_FF(va,new_size);
 	}
@@ -232,7 +266,7 @@ void *krealloc(void *virtual_address, uint32 new_size)
 	if(diff_no_pages == 0) return virtual_address;
 	if(diff_no_pages < 0)
 	{
-		kfree(virtual_address);
+		__kfree(virtual_address);
 		return NULL;
 	}
 
@@ -264,7 +298,7 @@ void *krealloc(void *virtual_address, uint32 new_size)
 				if (allocate_frame(&ptr_frame_info) == E_NO_MEM ||
 						map_frame(ptr_page_directory, ptr_frame_info, va, PERM_WRITEABLE) == E_NO_MEM)
 				{
-					kfree(virtual_address);
+					__kfree(virtual_address);
 					return NULL;
 				}
 			}
@@ -272,10 +306,10 @@ void *krealloc(void *virtual_address, uint32 new_size)
 		}
 		else
 		{
-			void *nva = kmalloc(new_size);
+			void *nva = __kmalloc(new_size);
 			if(!nva) return NULL;
 			memcpy(nva,virtual_address,old_nof_pages*PAGE_SIZE);
-			kfree(virtual_address);
+			__kfree(virtual_address);
 			return nva;
 		}
 	}
@@ -23,6 +23,7 @@ FUNCTIONS:	to_physical_address, get_frame_info, tlb_invalidate
 #include <kern/cpu/kclock.h>
 #include <kern/cpu/cpu.h>
 #include <kern/cpu/sched.h>
+#include <kern/cpu/mp.h>
 #include <kern/disk/pagefile_manager.h>
 #include "kheap.h"
 
@@ -34,6 +35,8 @@ void tlb_invalidate(uint32 *ptr_page_directory, void *virtual_address)
 	// Flush the entry only if we're modifying the current address space.
 	// For now, there is only one address space, so always invalidate.
 	invlpg(virtual_address);
+	//and on the other CPUs that may have it cached
+	tlb_shootdown(ptr_page_directory, (uint32)virtual_address);
 }
 
 ///******************************* MAPPING USER SPACE *******************************
@@ -87,9 +90,12 @@ void initialize_paging()
 
 	int range_end = ROUNDUP(PHYS_IO_MEM,PAGE_SIZE);
 
+	//the frame of the AP startup code (see boot_aps()) is in use as well
+	frames_info[MPENTRY_PADDR/PAGE_SIZE].references = 1;
 	for (i = 3; i < range_end/PAGE_SIZE; i++)
 	{
-
+		if (i == MPENTRY_PADDR/PAGE_SIZE)
+			continue;
 		initialize_frame_info(&(frames_info[i]));
 		//frames_info[i].references = 0;
 
@@ -177,6 +183,15 @@ int allocate_frame(struct FrameInfo **ptr_frame_info)
 	/**********************************************************
 	 ***********************************************************/
 
+	/*********************** SWAP CACHE ************************/
+	//the frame is reused, so its page file slot is no longer cached in memory
+	if((*ptr_frame_info)->swapLink != NULL)
+	{
+		(*ptr_frame_info)->swapLink->swapLink = NULL;
+		SwapCacheStats.reclaims++;
+	}
+	/***********************************************************/
+
 	initialize_frame_info(*ptr_frame_info);
 
 	if (!lock_already_held)
@@ -201,10 +216,20 @@ void free_frame(struct FrameInfo *ptr_frame_info)
 	}
 	{
 		/*2012: clear it to ensure that its members (env, isBuffered, ...) become NULL*/
+		struct FrameInfo *swapLink = ptr_frame_info->swapLink;
 		initialize_frame_info(ptr_frame_info);
 		/*=============================================================================*/
 		// Fill this function in
-		LIST_INSERT_HEAD(&MemFrameLists.free_frame_list, ptr_frame_info);
+		if (swapLink != NULL)
+		{
+			//swap-cached frame: keep its link and put it at the tail to be the last one reused
+			ptr_frame_info->swapLink = swapLink;
+			LIST_INSERT_TAIL(&MemFrameLists.free_frame_list, ptr_frame_info);
+		}
+		else
+		{
+			LIST_INSERT_HEAD(&MemFrameLists.free_frame_list, ptr_frame_info);
+		}
 		//LOG_STATMENT(cprintf("FN # %d FREED",to_frame_number(ptr_frame_info)));
 	}
 	if (!lock_already_held)
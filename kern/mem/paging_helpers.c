@@ -29,7 +29,7 @@ inline void pt_set_page_permissions(uint32* page_directory, uint32 virtual_addre
 	}
 
 	//[4] Invalidate the cache memory (TLB) [call tlb_invalidate(..)]
-	tlb_invalidate((void *)NULL, (void *)virtual_address);
+	tlb_invalidate(page_directory, (void *)virtual_address);
 }
 
 inline int pt_get_page_permissions(uint32* page_directory, uint32 virtual_address )
@@ -72,7 +72,7 @@ inline void pt_clear_page_table_entry(uint32* page_directory, uint32 virtual_add
 	}
 
 	//[4] Invalidate the cache memory (TLB) [call tlb_invalidate(..)]
-	tlb_invalidate((void *)NULL, (void *)virtual_address);
+	tlb_invalidate(page_directory, (void *)virtual_address);
 }
 
 /***********************************************************************************************/
@@ -96,7 +96,7 @@ inline uint32 pd_is_table_used(uint32* page_directory, uint32 virtual_address)
 inline void pd_set_table_unused(uint32* page_directory, uint32 virtual_address)
 {
 	page_directory[PDX(virtual_address)] &= (~PERM_USED);
-	tlb_invalidate((void *)NULL, (void *)virtual_address);
+	tlb_invalidate(page_directory, (void *)virtual_address);
 }
 
 inline void pd_clear_page_dir_entry(uint32* page_directory, uint32 virtual_address)
@@ -2,6 +2,7 @@
 #include "shared_memory_manager.h"
 
 #include <inc/mmu.h>
+#include <inc/x86.h>
 #include <inc/error.h>
 #include <inc/string.h>
 #include <inc/assert.h>
@@ -10,6 +11,9 @@
 
 #include <kern/proc/user_environment.h>
 #include <kern/trap/syscall.h>
+#include <kern/disk/pagefile_manager.h>
+#include <kern/disk/zswap.h>
+#include <kern/conc/futex.h>
 #include "kheap.h"
 #include "memory_manager.h"
 
@@ -17,16 +21,145 @@
 //============================== GIVEN FUNCTIONS ===================================//
 //==================================================================================//
 struct Share* get_share(int32 ownerID, char* name);
+struct Share* find_share(int32 ownerID, char* name);
+void free_share(struct Share* ptrShare);
+
+#if USE_KHEAP
+//Bucket of the given (ownerID, name): FNV-1a hash of the name, seeded by the owner
+static inline struct ShareBucket* share_bucket(int32 ownerID, char* name)
+{
+	uint32 hash = 2166136261u ^ (uint32)ownerID;
+	for (; *name != '\0'; name++)
+	{
+		hash ^= (uint8)*name;
+		hash *= 16777619;
+	}
+	return &AllShares.byName[(hash ^ (hash >> SHARE_HASH_BITS)) & (SHARE_BUCKETS - 1)];
+}
+
+//The mapping of the given env where the given VA is (its first page if exact), NULL if none.
+//If link is given, it's set to the link to the mapping in the list
+static struct ShareMapping* find_share_mapping(struct Env* e, uint32 va, bool exact, struct ShareMapping*** link)
+{
+	for (struct ShareMapping** iter = &e->shareMappings; *iter != NULL; iter = &(*iter)->next)
+	{
+		struct ShareMapping* m = *iter;
+		if (exact ? (va == m->va) : (va >= m->va && va < m->va + ROUNDUP(m->share->size, PAGE_SIZE)))
+		{
+			if (link != NULL)
+				*link = iter;
+			return m;
+		}
+	}
+	return NULL;
+}
+
+//Record that the given share is attached at the given VA of the given env
+static int add_share_mapping(struct Env* e, struct Share* ptrShare, uint32 va, uint32 perms)
+{
+	struct ShareMapping* m = kmalloc(sizeof(struct ShareMapping));
+	if (m == NULL)
+		return E_NO_SHARE;
+	m->share = ptrShare;
+	m->va = va;
+	m->perms = perms;
+	m->next = e->shareMappings;
+	e->shareMappings = m;
+	return 0;
+}
+
+//Reverse map entry of the mapping of a frame of a share at the given VA of the given env.
+//If there's no space for it (NULL), the frame is just not evictable while it's mapped there
+static struct RmapEntry* rmap_new(struct Env* e, uint32 va)
+{
+	struct RmapEntry* r = kmalloc(sizeof(struct RmapEntry));
+	if (r == NULL)
+		return NULL;
+	r->env = e;
+	r->va = va;
+	return r;
+}
+
+//Link the given entry (if any) in the reverse map of the given frame. Called with the rmaplock held
+static inline void rmap_link(struct FrameInfo* ptr_frame_info, struct RmapEntry* r)
+{
+	if (r == NULL)
+		return;
+	r->next = ptr_frame_info->rmap;
+	ptr_frame_info->rmap = r;
+}
+
+//Add the mapping of the given frame of a share at the given VA of the given env to its reverse map
+static void rmap_add(struct FrameInfo* ptr_frame_info, struct Env* e, uint32 va)
+{
+	struct RmapEntry* r = rmap_new(e, va);
+	acquire_spinlock(&ShareSwap.rmaplock);
+	rmap_link(ptr_frame_info, r);
+	release_spinlock(&ShareSwap.rmaplock);
+}
+
+//Map the given frame of a share in the given env. The readers of the share map its frames
+//concurrently, so the references of the frame are updated under the rmaplock (with its reverse map)
+static void share_map_frame(struct Env* e, struct FrameInfo* ptr_frame_info, uint32 va, uint32 perms)
+{
+	struct RmapEntry* r = rmap_new(e, va);
+	acquire_spinlock(&ShareSwap.rmaplock);
+	map_frame(e->env_page_directory, ptr_frame_info, va, perms);
+	rmap_link(ptr_frame_info, r);
+	release_spinlock(&ShareSwap.rmaplock);
+}
+
+//Remove the mappings of the given range of the given env from the reverse maps of their frames,
+//before the range is unmapped (under the rmaplock, so a reclaim never unmaps them meanwhile)
+static void share_unmap_range(struct Env* e, struct ShareMapping* m)
+{
+	struct RmapEntry* dropped = NULL;
+	uint32 endVA = m->va + ROUNDUP(m->share->size, PAGE_SIZE);
+	uint32* ptr_page_table = NULL;
+	acquire_spinlock(&ShareSwap.rmaplock);
+	for (uint32 va = m->va; va < endVA; va += PAGE_SIZE)
+	{
+		struct FrameInfo* ptr_frame_info = get_frame_info(e->env_page_directory, va, &ptr_page_table);
+		if (ptr_frame_info == NULL)
+			continue;
+		for (struct RmapEntry** iter = &ptr_frame_info->rmap; *iter != NULL; iter = &(*iter)->next)
+		{
+			struct RmapEntry* r = *iter;
+			if (r->env == e && r->va == va)
+			{
+				*iter = r->next;
+				r->next = dropped;
+				dropped = r;
+				break;
+			}
+		}
+	}
+	release_spinlock(&ShareSwap.rmaplock);
+	while (dropped != NULL)
+	{
+		struct RmapEntry* r = dropped;
+		dropped = r->next;
+		kfree(r);
+	}
+}
+#endif //USE_KHEAP
 
 //===========================
 // [1] INITIALIZE SHARES:
 //===========================
-//Initialize the list and the corresponding lock
+//Initialize the buckets and their locks
 void sharing_init()
 {
 #if USE_KHEAP
-	LIST_INIT(&AllShares.shares_list) ;
-	init_spinlock(&AllShares.shareslock, "shares lock");
+	for (int i = 0; i < SHARE_BUCKETS; i++)
+	{
+		LIST_INIT(&AllShares.byName[i].shares);
+		init_rwspinlock(&AllShares.byName[i].lock, "share bucket lock");
+	}
+	init_spinlock(&ShareSwap.rmaplock, "share rmap lock");
+	init_sleeplock(&ShareSwap.reclaimlock, "share reclaim lock");
+	ShareSwap.hand = 0;
+	ShareSwap.scanned = ShareSwap.referenced = ShareSwap.waited = ShareSwap.evicted = ShareSwap.restored = 0;
 #else
 	panic("not handled when KERN HEAP is disabled");
 #endif
@@ -43,13 +176,16 @@ int getSizeOfSharedObject(int32 ownerID, char* shareName)
 	//	a) If found, return size of shared object
 	//	b) Else, return E_SHARED_MEM_NOT_EXISTS
 	//
-	struct Share* ptr_share = get_share(ownerID, shareName);
-	if (ptr_share == NULL)
-		return E_SHARED_MEM_NOT_EXISTS;
-	else
-		return ptr_share->size;
-
-	return 0;
+	int size = E_SHARED_MEM_NOT_EXISTS;
+#if USE_KHEAP
+	struct ShareBucket* bucket = share_bucket(ownerID, shareName);
+	acquire_read_rwspinlock(&bucket->lock);
+	struct Share* ptr_share = find_share(ownerID, shareName);
+	if (ptr_share != NULL)
+		size = ptr_share->size;
+	release_read_rwspinlock(&bucket->lock);
+#endif //USE_KHEAP
+	return size;
 }
 
 //===========================================================
@@ -73,7 +209,7 @@ inline struct FrameInfo** create_frames_storage(int numOfFrames)
 // [2] Alloc & Initialize Share Object:
 //=====================================
 //Allocates a new shared object and initialize its member
-//It dynamically creates the "framesStorage"
+//It dynamically creates the "framesStorage" (empty: the frames are allocated on first touch)
 //Return: allocatedObject (pointer to struct Share) passed by reference
 struct Share* create_share(int32 ownerID, char* shareName, uint32 size, uint8 isWritable)
 {
@@ -88,6 +224,12 @@ struct Share* create_share(int32 ownerID, char* shareName, uint32 size, uint8 is
 		.framesStorage = create_frames_storage(ROUNDUP(size, PAGE_SIZE)/PAGE_SIZE),
 		.references = 1,
 	};
+	if(!shared->framesStorage)
+	{
+		kfree(shared);
+		return NULL;
+	}
+	init_rwsleeplock(&shared->lock, "share lock");
 	strcpy(shared->name,shareName);
 	return shared;
 }
@@ -95,36 +237,69 @@ struct Share* create_share(int32 ownerID, char* shareName, uint32 size, uint8 is
 //=============================
 // [3] Search for Share Object:
 //=============================
-//Search for the given shared object in the "shares_list"
+//Search for the given shared object in its bucket
 //Return:
 //	a) if found: ptr to Share object
 //	b) else: NULL
 struct Share* get_share(int32 ownerID, char* name)
+{
+	struct Share *ptr_share = NULL;
+#if USE_KHEAP
+	struct ShareBucket* bucket = share_bucket(ownerID, name);
+	acquire_read_rwspinlock(&bucket->lock);
+	ptr_share = find_share(ownerID, name);
+	release_read_rwspinlock(&bucket->lock);
+#endif //USE_KHEAP
+	return ptr_share;
+}
+
+//Same, with the lock of its bucket held by the caller (for read or write)
+struct Share* find_share(int32 ownerID, char* name)
 {
 	struct Share *iter = NULL;
 #if USE_KHEAP
-	if(!holding_spinlock(&AllShares.shareslock))
-		acquire_spinlock(&AllShares.shareslock);
-	LIST_FOREACH(iter,&AllShares.shares_list)
+	//not LIST_FOREACH: it saves its next element in the list head, which the concurrent readers share
+	for (iter = LIST_FIRST(&share_bucket(ownerID, name)->shares); iter != NULL; iter = LIST_NEXT(iter))
 	{
 		if(iter->ownerID == ownerID && !strcmp(name,iter->name))
-		{
-			release_spinlock(&AllShares.shareslock);
 			return iter;
-		}
 	}
-	if(holding_spinlock(&AllShares.shareslock))
-		release_spinlock(&AllShares.shareslock);
 #endif //USE_KHEAP
 	return NULL;
 }
 
+//Find the given share & take a reference to it while it's found, so it can't be freed meanwhile
+//(the concurrent getters only read the lock, so they take it atomically). NULL if it doesn't exist
+static struct Share* hold_share(int32 ownerID, char* name)
+{
+	struct Share* ptrShare = NULL;
+#if USE_KHEAP
+	struct ShareBucket* bucket = share_bucket(ownerID, name);
+	acquire_read_rwspinlock(&bucket->lock);
+	ptrShare = find_share(ownerID, name);
+	if (ptrShare != NULL)
+		xadd(&ptrShare->references, 1);
+	release_read_rwspinlock(&bucket->lock);
+#endif // USE_KHEAP
+	return ptrShare;
+}
+
+//Drop a reference to the given share, & free it if it's the last one
+static void put_share(struct Share* ptrShare)
+{
+#if USE_KHEAP
+	struct ShareBucket* bucket = share_bucket(ptrShare->ownerID, ptrShare->name);
+	acquire_write_rwspinlock(&bucket->lock);
+	if(!(--ptrShare->references)) free_share(ptrShare);
+	release_write_rwspinlock(&bucket->lock);
+#endif // USE_KHEAP
+}
+
 //=========================
 // [4] Create Share Object:
 //=========================
 int createSharedObject(int32 ownerID, char* shareName, uint32 size, uint8 isWritable, void* virtual_address)
 {
-	uint32 noOfPages = ROUNDUP(size, PAGE_SIZE) / PAGE_SIZE;
 	struct Env* myenv = get_cpu_proc(); //The calling environment
 	
 	if(get_share(ownerID,shareName)) return E_SHARED_MEM_EXISTS;
@@ -133,41 +308,27 @@ int createSharedObject(int32 ownerID, char* shareName, uint32 size, uint8 isWrit
 	if(!shared) return E_NO_SHARE;
 
 #if USE_KHEAP
-	if(!holding_spinlock(&AllShares.shareslock))
-		acquire_spinlock(&AllShares.shareslock);
-	LIST_INSERT_TAIL(&AllShares.shares_list,shared);
-	if(holding_spinlock(&AllShares.shareslock))
-		release_spinlock(&AllShares.shareslock);
-#endif // USE_KHEAP
-
-	// allocate space on kernel heap
-	void * sha = kmalloc(size);
-	if(!sha) return E_NO_SHARE;
-	shared->phva = sha;
-	// map it to virtual_address
-	uint32 *ptr_page_table = NULL;
-	struct FrameInfo *ptr_frame_info = NULL;
+	//check again & insert under the same write: two creators of the same name can't both succeed
+	struct ShareBucket* bucket = share_bucket(ownerID, shareName);
+	acquire_write_rwspinlock(&bucket->lock);
+	if(find_share(ownerID,shareName))
+	{
+		release_write_rwspinlock(&bucket->lock);
+		kfree(shared->framesStorage);
+		kfree(shared);
+		return E_SHARED_MEM_EXISTS;
+	}
+	LIST_INSERT_TAIL(&bucket->shares,shared);
+	release_write_rwspinlock(&bucket->lock);
 
-	uint32 perms = PERM_USER | PTR_TAKEN | PERM_PRESENT | PERM_WRITEABLE;
-	for (uint32 iter = (uint32)sha,i = 0; iter <= (uint32)sha + (noOfPages - 1)*PAGE_SIZE; iter += PAGE_SIZE,i++)
+	// nothing is mapped at virtual_address yet (it's reserved by smalloc()): its pages are
+	// populated on their first touch (see share_fault_handler())
+	if (add_share_mapping(myenv, shared, (uint32)virtual_address, PERM_USER | PERM_WRITEABLE) != 0)
 	{
-		ptr_frame_info = get_frame_info(ptr_page_directory, iter, &ptr_page_table);
-		shared->framesStorage[i] = ptr_frame_info; 
-		if (iter == (uint32)sha)
-		{
-			if (map_frame(myenv->env_page_directory, ptr_frame_info,(uint32)virtual_address, PTR_FIRST | perms) == E_NO_MEM)
-			{
-				kfree(sha);
-				return E_NO_SHARE;
-			}
-		}
-		else if (map_frame(myenv->env_page_directory, ptr_frame_info,(uint32)virtual_address, perms) == E_NO_MEM)
-		{
-			kfree(sha);
-			return E_NO_SHARE;
-		}
-		virtual_address += PAGE_SIZE;
+		put_share(shared);
+		return E_NO_SHARE;
 	}
+#endif // USE_KHEAP
 	
 	return shared->ID;
 }
@@ -179,25 +340,327 @@ int createSharedObject(int32 ownerID, char* shareName, uint32 size, uint8 isWrit
 int getSharedObject(int32 ownerID, char* shareName, void* virtual_address)
 {
 	struct Env* myenv = get_cpu_proc(); //The calling environment
-	struct Share* sharedObject = get_share(ownerID,shareName);
+	struct Share* sharedObject = NULL;
+#if USE_KHEAP
+	sharedObject = hold_share(ownerID,shareName);
+#endif // USE_KHEAP
 	if (sharedObject == NULL) return E_SHARED_MEM_NOT_EXISTS;
-	struct FrameInfo** frames = sharedObject->framesStorage;
-	int size = sharedObject->size;
 
-	int perms = PERM_USER | PERM_PRESENT | PTR_TAKEN;
+	uint32 perms = PERM_USER;
 	perms |= sharedObject->isWritable ? PERM_WRITEABLE : 0;
-	void* addr = (void*)((uint32)virtual_address);
-	if (map_frame(myenv->env_page_directory, frames[0],(uint32) addr , perms | PTR_FIRST)) return E_SHARED_MEM_NOT_EXISTS;
-	for (int i = 1; i < size / PAGE_SIZE; i++) 
+#if USE_KHEAP
+	if (add_share_mapping(myenv, sharedObject, (uint32)virtual_address, perms) != 0)
+	{
+		put_share(sharedObject);
+		return E_SHARED_MEM_NOT_EXISTS;
+	}
+#endif // USE_KHEAP
+
+	// map the frames populated so far (the others are mapped on their first touch; the range is
+	// reserved by the malloc() of sget(), so the available bits of its entries are kept)
+	uint32 noOfPages = ROUNDUP(sharedObject->size, PAGE_SIZE) / PAGE_SIZE;
+	acquire_read_rwsleeplock(&sharedObject->lock);
+	for (uint32 i = 0; i < noOfPages; i++)
 	{
-		addr += PAGE_SIZE;
-		if (map_frame(myenv->env_page_directory, frames[i],(uint32) addr, perms)) return E_SHARED_MEM_NOT_EXISTS;
+		if (sharedObject->framesStorage[i] != NULL)
+			share_map_frame(myenv, sharedObject->framesStorage[i], (uint32)virtual_address + i*PAGE_SIZE, perms);
 	}
+	release_read_rwsleeplock(&sharedObject->lock);
 
-	sharedObject->references++;
 	return sharedObject->ID;
 }
 
+//=========================
+// [6] Attach Share Object:
+//=========================
+//Reserve a free range of the user heap of the calling env for the given shared object & map all
+//its frames there, in a single walk of the page tables (each one is looked up once).
+//Return: its VA (& its size in *size), or NULL if it doesn't exist or there's no free range
+void* attachSharedObject(int32 ownerID, char* shareName, uint32* size)
+{
+	struct Env* myenv = get_cpu_proc(); //The calling environment
+	struct Share* sharedObject = hold_share(ownerID, shareName);
+	if (sharedObject == NULL) return NULL;
+
+	uint32 noOfPages = ROUNDUP(sharedObject->size, PAGE_SIZE) / PAGE_SIZE;
+	uint32 startVA = find_free_user_pages(myenv, noOfPages);
+	uint32 perms = PERM_USER;
+	perms |= sharedObject->isWritable ? PERM_WRITEABLE : 0;
+	if (startVA == 0 || add_share_mapping(myenv, sharedObject, startVA, perms) != 0)
+	{
+		put_share(sharedObject);
+		return NULL;
+	}
+
+	uint32 *ptr_page_table = NULL;
+	acquire_read_rwsleeplock(&sharedObject->lock);
+	for (uint32 i = 0, va = startVA; i < noOfPages; i++, va += PAGE_SIZE)
+	{
+		if (i == 0 || PTX(va) == 0)
+		{
+			if (get_page_table(myenv->env_page_directory, va, &ptr_page_table) == TABLE_NOT_EXIST)
+				ptr_page_table = create_page_table(myenv->env_page_directory, va);
+		}
+		//the range is free (nothing is mapped there): fill the entries directly. Like the pages
+		//allocated by allocate_user_mem(), each page counts as a reference to its table.
+		//The pages not populated yet are just reserved, & mapped on their first touch
+		uint32 entry = PTR_TAKEN | (i == 0 ? PTR_FIRST : 0);
+		struct FrameInfo *ptr_frame_info = sharedObject->framesStorage[i];
+		if (ptr_frame_info != NULL)
+		{
+			struct RmapEntry* r = rmap_new(myenv, va);
+			acquire_spinlock(&ShareSwap.rmaplock);
+			ptr_frame_info->references++;
+			ptr_frame_info->va = va;
+			rmap_link(ptr_frame_info, r);
+			release_spinlock(&ShareSwap.rmaplock);
+			entry = CONSTRUCT_ENTRY(to_physical_address(ptr_frame_info), entry | perms | PERM_PRESENT);
+		}
+		ptr_page_table[PTX(va)] = entry;
+		to_frame_info(kheap_physical_address((uint32)ptr_page_table))->references++;
+	}
+	release_read_rwsleeplock(&sharedObject->lock);
+
+	if (size != NULL)
+		*size = sharedObject->size;
+	return (void*)startVA;
+}
+
+//=====================================
+// [7] Page Fault on a Share Object:
+//=====================================
+//Called by the fault handler on a page of the user heap that's not present: if it's in a share
+//attached to the given env, map the frame of that page, allocating it if it's the first touch by
+//any env (zeroed) or if it's evicted (read back from its page file frame).
+//Return: 1 if handled, 0 if it's not a share page
+int share_fault_handler(struct Env* e, uint32 fault_va)
+{
+#if USE_KHEAP
+	struct ShareMapping* m = find_share_mapping(e, fault_va, 0, NULL);
+	if (m == NULL) return 0;
+	struct Share* ptrShare = m->share;
+	uint32 va = ROUNDDOWN(fault_va, PAGE_SIZE);
+	uint32 i = (va - m->va) / PAGE_SIZE;
+
+	//populated: just map it (the envs fault on the frames of a share concurrently)
+	acquire_read_rwsleeplock(&ptrShare->lock);
+	struct FrameInfo* ptr_frame_info = ptrShare->framesStorage[i];
+	if (ptr_frame_info != NULL)
+	{
+		share_map_frame(e, ptr_frame_info, va, m->perms);
+		release_read_rwsleeplock(&ptrShare->lock);
+		return 1;
+	}
+	release_read_rwsleeplock(&ptrShare->lock);
+
+	//first touch or evicted: populate it, unless another env has done it meanwhile
+	acquire_write_rwsleeplock(&ptrShare->lock);
+	ptr_frame_info = ptrShare->framesStorage[i];
+	if (ptr_frame_info == NULL)
+	{
+		if (allocate_frame(&ptr_frame_info) == E_NO_MEM)
+		{
+			release_write_rwsleeplock(&ptrShare->lock);
+			env_exit();
+			return 1;
+		}
+		//fill it through this mapping (writable till it's filled), before any other env sees it
+		map_frame(e->env_page_directory, ptr_frame_info, va, PERM_USER | PERM_WRITEABLE);
+		uint32 dfn = (ptrShare->swapSlots != NULL) ? ptrShare->swapSlots[i] : 0;
+		if (dfn != 0)
+		{
+			if (zswap_load(dfn, (void*)va) != 0)
+				read_disk_page(dfn, (void*)va);
+			ptrShare->swapSlots[i] = 0;
+			free_disk_frame(dfn);
+			ShareSwap.restored++;
+		}
+		else
+		{
+			memset((void*)va, 0, PAGE_SIZE);
+		}
+		pt_set_page_permissions(e->env_page_directory, va, 0, PERM_MODIFIED);
+		if (!(m->perms & PERM_WRITEABLE))
+			pt_set_page_permissions(e->env_page_directory, va, 0, PERM_WRITEABLE);
+		rmap_add(ptr_frame_info, e, va);
+		ptr_frame_info->references++;		//the reference of the share
+		ptrShare->framesStorage[i] = ptr_frame_info;
+	}
+	else
+	{
+		share_map_frame(e, ptr_frame_info, va, m->perms);
+	}
+	release_write_rwsleeplock(&ptrShare->lock);
+	return 1;
+#else
+	return 0;
+#endif // USE_KHEAP
+}
+
+//=====================================
+// [8] Detach an Env from its Shares:
+//=====================================
+//Drop the references of the given (exiting) env to the shares it's attached to
+//(its pages are unmapped with the rest of its memory, once they're out of the reverse maps)
+void sharing_env_free(struct Env* e)
+{
+#if USE_KHEAP
+	while (e->shareMappings != NULL)
+	{
+		struct ShareMapping* m = e->shareMappings;
+		e->shareMappings = m->next;
+		share_unmap_range(e, m);
+		put_share(m->share);
+		kfree(m);
+	}
+#endif // USE_KHEAP
+}
+
+//=========================================
+// [9] Reclaim the Idle Frames of the Shares:
+//=========================================
+#if USE_KHEAP
+//Write the given frame to the given page file frame (or keep it compressed in memory) through
+//PGFLTEMP of the current env, as pf_update_env_page() does
+static void share_write_frame(struct Env* cur_env, struct FrameInfo* ptr_frame_info, uint32 dfn)
+{
+	void* va = (void*)ROUNDDOWN((uint32)PGFLTEMP, PAGE_SIZE);
+	map_frame(cur_env->env_page_directory, ptr_frame_info, (uint32)PGFLTEMP, 0);
+	if (zswap_store(dfn, va) != 0)
+		write_disk_page(dfn, va);
+	// TEMPORARILY increase the references to prevent unmap_frame from removing the frame
+	ptr_frame_info->references += 1;
+	unmap_frame(cur_env->env_page_directory, (uint32)PGFLTEMP);
+	ptr_frame_info->references -= 1;
+}
+
+//Evict up to numOfFrames frames of the given share that no env has used since their previous scan
+//(second chance on the USED bits of all their mappings). Return: # of frames evicted
+static int share_evict_idle(struct Env* cur_env, struct Share* ptrShare, uint32 numOfFrames)
+{
+	uint32 evicted = 0;
+	uint32 noOfPages = ROUNDUP(ptrShare->size, PAGE_SIZE) / PAGE_SIZE;
+	acquire_write_rwsleeplock(&ptrShare->lock);
+	for (uint32 i = 0; i < noOfPages && evicted < numOfFrames; i++)
+	{
+		struct FrameInfo* ptr_frame_info = ptrShare->framesStorage[i];
+		if (ptr_frame_info == NULL)
+			continue;
+		ShareSwap.scanned++;
+
+		struct RmapEntry* dropped = NULL;
+		bool used = 0;
+		acquire_spinlock(&ShareSwap.rmaplock);
+		for (struct RmapEntry* r = ptr_frame_info->rmap; r != NULL; r = r->next)
+		{
+			if (pt_get_page_permissions(r->env->env_page_directory, r->va) & PERM_USED)
+			{
+				pt_set_page_permissions(r->env->env_page_directory, r->va, 0, PERM_USED);
+				used = 1;
+			}
+		}
+		//idle: unmap it from all the envs (their entries keep the available bits, so they fault on it)
+		if (!used)
+		{
+			for (struct RmapEntry* r = ptr_frame_info->rmap; r != NULL; r = r->next)
+				unmap_frame(r->env->env_page_directory, r->va);
+			dropped = ptr_frame_info->rmap;
+			ptr_frame_info->rmap = NULL;
+		}
+		release_spinlock(&ShareSwap.rmaplock);
+		while (dropped != NULL)
+		{
+			struct RmapEntry* r = dropped;
+			dropped = r->next;
+			kfree(r);
+		}
+		if (used)
+		{
+			ShareSwap.referenced++;
+			continue;
+		}
+
+		//still mapped out of the reverse map (a range being detached, or an entry that couldn't
+		//be allocated): keep it, the envs unmapped above just fault on it again
+		if (ptr_frame_info->references != 1)
+			continue;
+		//envs blocked on a futex word of it: keep it, their key is its physical address
+		if (futex_frame_has_waiters(to_physical_address(ptr_frame_info)))
+		{
+			ShareSwap.waited++;
+			continue;
+		}
+
+		if (ptrShare->swapSlots == NULL)
+		{
+			ptrShare->swapSlots = kmalloc(noOfPages * sizeof(uint32));
+			if (ptrShare->swapSlots == NULL)
+				break;
+			memset(ptrShare->swapSlots, 0, noOfPages * sizeof(uint32));
+		}
+		uint32 dfn;
+		if (allocate_disk_frame(&dfn) == E_NO_PAGE_FILE_SPACE)
+			break;
+		share_write_frame(cur_env, ptr_frame_info, dfn);
+		ptrShare->swapSlots[i] = dfn;
+		ptrShare->framesStorage[i] = NULL;
+		decrement_references(ptr_frame_info);		//the reference of the share: it's freed
+		evicted++;
+		ShareSwap.evicted++;
+	}
+	release_write_rwsleeplock(&ptrShare->lock);
+	return evicted;
+}
+#endif // USE_KHEAP
+
+//Called by the page faults of the envs while the free frames are scarce: evict up to numOfFrames
+//idle frames of the shares to the page file, scanning the buckets round robin from where the
+//previous reclaim stopped. Each frame is written once for all the envs mapping it.
+//Return: # of frames evicted
+int share_reclaim(uint32 numOfFrames)
+{
+	int evicted = 0;
+#if USE_KHEAP
+	struct Env* cur_env = get_cpu_proc();
+	if (cur_env == NULL)
+		return 0;
+	acquire_sleeplock(&ShareSwap.reclaimlock);
+	for (int n = 0; n < SHARE_BUCKETS && evicted < numOfFrames; n++)
+	{
+		struct ShareBucket* bucket = &AllShares.byName[ShareSwap.hand];
+		ShareSwap.hand = (ShareSwap.hand + 1) % SHARE_BUCKETS;
+
+		//hold the shares of the bucket, so they're not freed while they're scanned (unlocked)
+		struct Share* shares[SHARE_RECLAIM_BATCH];
+		int numOfShares = 0;
+		acquire_read_rwspinlock(&bucket->lock);
+		for (struct Share* iter = LIST_FIRST(&bucket->shares); iter != NULL && numOfShares < SHARE_RECLAIM_BATCH; iter = LIST_NEXT(iter))
+		{
+			xadd(&iter->references, 1);
+			shares[numOfShares++] = iter;
+		}
+		release_read_rwspinlock(&bucket->lock);
+
+		for (int k = 0; k < numOfShares; k++)
+		{
+			if (evicted < numOfFrames)
+				evicted += share_evict_idle(cur_env, shares[k], numOfFrames - evicted);
+			put_share(shares[k]);
+		}
+	}
+	release_sleeplock(&ShareSwap.reclaimlock);
+#endif // USE_KHEAP
+	return evicted;
+}
+
+void sharing_print_stats()
+{
+#if USE_KHEAP
+	cprintf("Shares: frames scanned = %d, spared (used) = %d, spared (futex waiters) = %d, evicted = %d, restored = %d\n",
+			ShareSwap.scanned, ShareSwap.referenced, ShareSwap.waited, ShareSwap.evicted, ShareSwap.restored);
+#endif // USE_KHEAP
+}
+
 //==================================================================================//
 //============================== BONUS FUNCTIONS ===================================//
 //==================================================================================//
@@ -205,15 +668,25 @@ int getSharedObject(int32 ownerID, char* shareName, void* virtual_address)
 //==========================
 // [B1] Delete Share Object:
 //==========================
-//delete the given shared object from the "shares_list"
-//it should free its framesStorage and the share object itself
+//delete the given shared object from its buckets
+//it should free its framesStorage, its swap slots and the share object itself
+//(the lock of its name bucket must be held for write)
 void free_share(struct Share* ptrShare)
 {
 #if USE_KHEAP
-	LIST_REMOVE(&AllShares.shares_list,ptrShare);
+	LIST_REMOVE(&share_bucket(ptrShare->ownerID, ptrShare->name)->shares,ptrShare);
 #endif // USE_KHEAP
-	kfree(ptrShare->phva);
+	uint32 noOfPages = ROUNDUP(ptrShare->size, PAGE_SIZE) / PAGE_SIZE;
+	for (uint32 i = 0; i < noOfPages; i++)
+	{
+		if (ptrShare->framesStorage[i] != NULL)
+			decrement_references(ptrShare->framesStorage[i]);
+		if (ptrShare->swapSlots != NULL)
+			free_disk_frame(ptrShare->swapSlots[i]);
+	}
 	kfree(ptrShare->framesStorage);
+	if (ptrShare->swapSlots != NULL)
+		kfree(ptrShare->swapSlots);
 	kfree(ptrShare);
 }
 //========================
@@ -229,33 +702,21 @@ int freeSharedObject(int32 sharedObjectID, void *startVA)
 	// if shared obj references == 0 free it
 	struct Env* myenv = get_cpu_proc(); //The calling environment
 
-	uint32 *ptr_page_table = NULL;
-	struct FrameInfo *ptr_frame_info = get_frame_info(myenv->env_page_directory, (uint32)startVA, &ptr_page_table);
-	if (!ptr_frame_info) return 0;
-
 	struct Share *iter = NULL;
 #if USE_KHEAP
-	if(!holding_spinlock(&AllShares.shareslock))
-		acquire_spinlock(&AllShares.shareslock);
-	LIST_FOREACH(iter,&AllShares.shares_list)
-	{
-		if(iter->framesStorage[0] == ptr_frame_info)
-		{
-			if(holding_spinlock(&AllShares.shareslock))
-				release_spinlock(&AllShares.shareslock);
-			goto FOUND_SHARED;
-		}
-	}
-	if(holding_spinlock(&AllShares.shareslock))
-		release_spinlock(&AllShares.shareslock);
-	return 0;
+	struct ShareMapping **link = NULL;
+	struct ShareMapping *m = find_share_mapping(myenv, (uint32)startVA, 1, &link);
+	if (m == NULL) return 0;
+	*link = m->next;
+	iter = m->share;
+	share_unmap_range(myenv, m);
+	kfree(m);
 #endif // USE_KHEAP
+	if (iter == NULL) return 0;
 
-FOUND_SHARED:
-
-	ptr_page_table = NULL;
-	ptr_frame_info = get_frame_info(myenv->env_page_directory, (uint32)startVA, &ptr_page_table);
-	if (!ptr_frame_info) return 1; // EXIT_FAILURE
+	uint32 *ptr_page_table = NULL;
+	get_page_table(myenv->env_page_directory, (uint32)startVA, &ptr_page_table);
+	if (!ptr_page_table) return 1; // EXIT_FAILURE
 
 	free_user_mem(myenv, (uint32)startVA, iter->size);
 	uint32 *ptr_page_table2 = NULL;
@@ -263,6 +724,6 @@ FOUND_SHARED:
 	// if page table empty free it;
 	if(table_FrameInfo->references == 1) kfree(ptr_page_table);
 
-	if(!(--iter->references)) free_share(iter);
+	put_share(iter);
 	return 0;
 }
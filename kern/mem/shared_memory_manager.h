@@ -10,6 +10,8 @@
 //#include <inc/memlayout.h>
 #include <inc/environment_definitions.h>
 #include <kern/conc/spinlock.h>
+#include <kern/conc/sleeplock.h>
+#include <kern/conc/rwlock.h>
 
 struct Share
 {
@@ -28,16 +30,39 @@ struct Share
 	//sharing permissions (0: ReadOnly, 1:Writable)
 	uint8 isWritable;
 
-	void *phva;
-
-	//to store frames to be shared
+	//to store frames to be shared: each one is allocated on the first touch of its page by any
+	//attached env (NULL till then, or while it's evicted), & the share holds a reference to it
+	//till it's freed
 	struct FrameInfo** framesStorage;
+	//page file frame of each evicted page (0 if none), allocated on the first eviction
+	uint32* swapSlots;
+	//protects the frames storage & the swap slots: read to map the frames (by the envs attaching or
+	//faulting on the share concurrently), written to populate or evict them (held across their I/O)
+	struct rwsleeplock lock;
 
-	// list link pointers
+	// list link pointers (in the bucket of its ownerID & name)
 	LIST_ENTRY(Share) prev_next_info;
 
 };
 
+//A range of the user heap of an env where a share is attached. The list of an env
+//(Env.shareMappings) is only used by the env itself, & by env_free()
+struct ShareMapping
+{
+	struct Share* share;
+	uint32 va;
+	uint32 perms;					//of its pages in this env
+	struct ShareMapping* next;
+};
+
+//A mapping of a frame of a share (in FrameInfo.rmap)
+struct RmapEntry
+{
+	struct Env* env;
+	uint32 va;
+	struct RmapEntry* next;
+};
+
 //List of all shared objects
 LIST_HEAD(Share_List, Share);		// Declares 'struct Share_List'
 
@@ -46,19 +71,53 @@ LIST_HEAD(Share_List, Share);		// Declares 'struct Share_List'
 	#define MAX_SHARES 100
 	struct Share shares[MAX_SHARES] ;
 #else
+	//The shares are hashed by (ownerID, name). Each bucket has its own lock: the lookups (sget,
+	//size queries) read it concurrently, the creation & the freeing of its shares write it.
+	//The share attached at a VA is found by the list of the env (Env.shareMappings)
+	#define SHARE_HASH_BITS 8
+	#define SHARE_BUCKETS (1 << SHARE_HASH_BITS)
+
+	struct ShareBucket
+	{
+		struct Share_List shares;		//linked by prev_next_info
+		struct rwspinlock lock;
+	};
+
 	struct
 	{
-		struct Share_List shares_list ;	//List of all share variables created by any process
-		struct spinlock shareslock;		//Use it to protect the shares_list in the kernel
+		struct ShareBucket byName[SHARE_BUCKETS];
 	}AllShares;
 
+	//The idle frames of the shares are evicted to the page file when the free frames are scarce
+	//(see share_reclaim()): each one is written once & unmapped from all the envs mapping it (by
+	//its reverse map), then read back by the first fault on it in any of them
+	#define SHARE_RECLAIM_THRESHOLD	64		//reclaim once the free frames are fewer than this
+	#define SHARE_RECLAIM_BATCH		16		//# of frames evicted per reclaim (at most)
+
+	struct
+	{
+		struct spinlock rmaplock;			//protects the reverse maps of all the frames of the shares
+		struct sleeplock reclaimlock;		//serializes the reclaimers
+		uint32 hand;						//bucket where the next reclaim starts
+		uint32 scanned;						//stats
+		uint32 referenced;					//frames spared since they're used since their previous scan
+		uint32 waited;						//frames spared since envs are blocked on their futex words
+		uint32 evicted;
+		uint32 restored;
+	}ShareSwap;
+
 	void sharing_init();
+	int share_reclaim(uint32 numOfFrames);
+	void sharing_print_stats();
 #endif
 
 int createSharedObject(int32 ownerID, char* shareName, uint32 size, uint8 isWritable, void* virtual_address);
 int getSizeOfSharedObject(int32 ownerID, char* shareName);
 int getSharedObject(int32 ownerID, char* shareName, void* virtual_address);
 int freeSharedObject(int32 sharedObjectID, void *startVA);
+void* attachSharedObject(int32 ownerID, char* shareName, uint32* size);
+int share_fault_handler(struct Env* e, uint32 fault_va);
+void sharing_env_free(struct Env* e);
 
 
 #endif /* FOS_SHARED_MEMORY_MANAGER_H */
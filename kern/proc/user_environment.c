@@ -15,6 +15,7 @@
 #include "../cmd/command_prompt.h"
 #include <kern/cpu/sched.h>
 #include <kern/cpu/cpu.h>
+#include <kern/cpu/sched_edf.h>
 #include "../disk/pagefile_manager.h"
 #include "../mem/kheap.h"
 #include "../mem/memory_manager.h"
@@ -93,6 +94,7 @@ void set_environment_entry_point(struct Env* e, uint8* ptr_program_start);
 //
 void env_init(void)
 {
+	init_rwspinlock(&envsLock, "envs lock");
 	int iEnv = NENV-1;
 	for(; iEnv >= 0; iEnv--)
 	{
@@ -463,7 +465,11 @@ void env_start(void)
 //
 void env_free(struct Env *e)
 {
+	//give its utilization back to the real-time class (if any)
+	sched_leave_EDF(e);
 #if USE_KHEAP
+	//drop its references to the shares it's attached to
+	sharing_env_free(e);
 
 	struct WorkingSetElement* wsElement;
 	while (!LIST_EMPTY(&(e->page_WS_list))) {
@@ -582,7 +588,10 @@ int envid2env(int32  envid, struct Env **env_store, bool checkperm)
 	// (i.e., does not refer to a _previous_ environment
 	// that used the same slot in the envs[] array).
 	e = &envs[ENVX(envid)];
-	if (e->env_status == ENV_FREE || e->env_id != envid) {
+	acquire_read_rwspinlock(&envsLock);
+	bool stale = (e->env_status == ENV_FREE || e->env_id != envid);
+	release_read_rwspinlock(&envsLock);
+	if (stale) {
 		*env_store = 0;
 		return E_BAD_ENV;
 	}
@@ -621,6 +630,25 @@ void yield(void)
 	//cprintf("\n[YIELD] release: lock status after release = %d\n", qlock.locked);
 }
 
+//Directed yield: donate the rest of the quantum of the current env to the given ready env
+//(e.g. the one just woken up by a semaphore signal), so it runs next on this CPU instead of
+//waiting behind the others in its ready queue
+void yield_to(struct Env* env)
+{
+	acquire_spinlock(&ProcessQueues.qlock);
+	{
+		struct Env* p = get_cpu_proc();
+		assert(p != NULL);
+		if (env != NULL && env != p && env->env_status == ENV_READY)
+		{
+			mycpu()->yieldTo = env;
+			p->env_status = ENV_READY;
+			sched();
+		}
+	}
+	release_spinlock(&ProcessQueues.qlock);
+}
+
 //=================================
 // 9) SWITCH TO THE SCHEDULER:
 //=================================
@@ -715,9 +743,16 @@ void switchuvm(struct Env *proc)
 //
 int allocate_environment(struct Env** e)
 {
+	acquire_write_rwspinlock(&envsLock);
 	if (!(*e = LIST_FIRST(&env_free_list)))
+	{
+		release_write_rwspinlock(&envsLock);
 		return E_NO_FREE_ENV;
+	}
+	//taken off the list right away, so two concurrent creations can't get the same env
+	LIST_REMOVE(&env_free_list, *e);
 	(*e)->env_status = ENV_UNKNOWN;
+	release_write_rwspinlock(&envsLock);
 	return 0;
 }
 
@@ -727,9 +762,11 @@ int allocate_environment(struct Env** e)
 // Free the given environment "e", simply by adding it to the free environment list.
 void free_environment(struct Env* e)
 {
+	acquire_write_rwspinlock(&envsLock);
 	memset(e, 0, sizeof(*e));
 	e->env_status = ENV_FREE;
 	LIST_INSERT_HEAD(&env_free_list, e);
+	release_write_rwspinlock(&envsLock);
 }
 
 //===============================================
@@ -1067,6 +1104,21 @@ void initialize_environment(struct Env* e, uint32* ptr_user_page_directory, unsi
 	e->nModifiedPages=0;
 	e->nNotModifiedPages=0;
 	e->nClocks = 0;
+	memset(&(e->schedStats), 0, sizeof(e->schedStats));
+	e->statStamp = 0;
+	e->statBlocked = e->statWoken = 0;
+	e->killed = 0;
+
+	//the default share of the stride scheduler (the children of an env inherit its tickets, see sys_create_env())
+	e->tickets = STRIDE_DEFAULT_TICKETS;
+	e->stride = STRIDE1 / e->tickets;
+	e->pass = 0;
+	e->strideIndex = -1;
+
+	//best-effort till it asks for a real-time class (sys_rt_set_params())
+	e->rtPeriod = 0;
+	e->rtThrottled = 0;
+	e->rtJobs = e->rtMisses = 0;
 
 	//2020
 	e->nPageIn = 0;
@@ -1074,6 +1126,7 @@ void initialize_environment(struct Env* e, uint32* ptr_user_page_directory, unsi
 	e->nNewPageAdded = 0;
 
 	//e->shared_free_address = USER_SHARED_MEM_START;
+	e->shareMappings = NULL;
 
 	//[PROJECT'24.DONE] call initialize_uheap_dynamic_allocator(...)
 	initialize_uheap_dynamic_allocator(e, USER_HEAP_START, USER_HEAP_START + DYN_ALLOC_MAX_SIZE);
@@ -1098,6 +1151,7 @@ void complete_environment_initialization(struct Env* e)
 	e->disk_env_tabledir = 0;
 	e->disk_env_tabledir_PA = 0;
 
+	acquire_write_rwspinlock(&envsLock);
 	int32 generation;
 	// Generate an env_id for this environment.
 	/*2022: UPDATED*/generation = (e->env_id + (1 << ENVGENSHIFT)) & ~(NEARPOW2NENV - 1);
@@ -1116,6 +1170,7 @@ void complete_environment_initialization(struct Env* e)
 		e->env_parent_id = cur_env->env_id;//curenv is the parent;
 	//========================================================
 	e->env_status = ENV_NEW;
+	release_write_rwspinlock(&envsLock);
 	e->env_runs = 0;
 
 	// Clear out all the saved register state,
@@ -1139,8 +1194,7 @@ void complete_environment_initialization(struct Env* e)
 
 	// You will set e->env_tf.tf_eip later.
 
-	// commit the allocation
-	LIST_REMOVE(&env_free_list ,e);
+	// the allocation is committed by allocate_environment()
 	return ;
 }
 
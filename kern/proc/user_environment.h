@@ -8,6 +8,7 @@
 #include <inc/types.h>
 #include <kern/cpu/sched_helpers.h>
 #include <kern/conc/spinlock.h>
+#include <kern/conc/rwlock.h>
 
 
 //========================================================
@@ -15,6 +16,10 @@ extern struct UserProgramInfo* ptr_UserPrograms;
 extern struct Env *envs;		// All environments
 //extern struct Env *curenv;	// Current environment
 
+//Protects the lookups of the envs by their IDs (envid2env(): read) against the allocation,
+//the freeing & the ID assignment of the envs (write)
+struct rwspinlock envsLock;
+
 ///===================================================================================
 struct Env* get_cpu_proc(void);			// get the the current running process on the CPU
 void set_cpu_proc(struct Env* p);		// set the process to be run on CPU
@@ -31,6 +36,7 @@ void env_free(struct Env *e);
 ///===================================================================================
 /*2024*/
 void yield(void);					//giveup the CPU
+void yield_to(struct Env* env);		//giveup the CPU to the given ready env, with the rest of the quantum (directed yield)
 void sched(void);					//enter the fos_scheduler while keeping the interrupt status of the process and restoring it after return
 void switchuvm(struct Env *proc);	//switch to the user virtual memory (TSS & Process Directory)
 void switchkvm(void);				//switch to the kernel virtual memory (Kern Directory)
@@ -86,6 +86,8 @@ struct UserProgramInfo userPrograms[] = {
 		{ "tsem2", "Tests the Semaphores only [multiprograms enter the same CS]", PTR_START_OF(tst_semaphore_2master)},
 		{ "sem2Slave", "[Slave program] of tst_semaphore_2master", PTR_START_OF(tst_semaphore_2slave)},
 		{ "tff3", "tests first fit (3): malloc, smalloc & sget", PTR_START_OF(tst_first_fit_3)},
+		{ "tring", "Benchmarks the SPSC & MPMC ring buffers over shared memory [cycles/msg]", PTR_START_OF(tst_ring_master)},
+		{ "ringSlave", "[Slave program] of tst_ring_master", PTR_START_OF(tst_ring_slave)},
 
 		{ "tshr1", "Tests the shared variables [create]", PTR_START_OF(tst_sharing_1)},
 		{ "tshr2", "Tests the shared variables [create, get and perms]", PTR_START_OF(tst_sharing_2master)},
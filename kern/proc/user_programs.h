@@ -62,6 +62,8 @@ DECLARE_START_OF(tst_semaphore_1master);
 DECLARE_START_OF(tst_semaphore_1slave);
 DECLARE_START_OF(tst_semaphore_2master);
 DECLARE_START_OF(tst_semaphore_2slave);
+DECLARE_START_OF(tst_ring_master);
+DECLARE_START_OF(tst_ring_slave);
 
 DECLARE_START_OF(tst_sharing_1);
 DECLARE_START_OF(tst_sharing_2master);
@@ -1,10 +1,17 @@
 #include <kern/proc/priority_manager.h>
 #include <inc/assert.h>
+#include <inc/error.h>
 #include <kern/proc/user_environment.h>
 #include <kern/cmd/command_prompt.h>
 #include <kern/disk/pagefile_manager.h>
 #include <kern/cpu/sched.h>
+#include <kern/cpu/sched_edf.h>
+#include <kern/cpu/timer_wheel.h>
+#include <kern/cpu/sched_stats.h>
+#include <kern/cpu/cpu.h>
+#include <kern/cpu/mp.h>
 #include "../mem/memory_manager.h"
+#include "../mem/kheap.h"
 
 extern int sys_calculate_free_frames();
 extern void sys_env_set_nice(int);
@@ -239,3 +246,569 @@ void test_bsd_nice_2()
 	}
 	cprintf("\nCongratulations!! test_bsd_nice_2 completed successfully.\n");
 }
+
+//Fixture of the tests below, which drive the scheduler with dummy envs: they must be run from the
+//prompt while there's no ready (or real-time) env. Returns the given # of zeroed dummy envs (with
+//the IDs 1, 2...), or NULL if there're ready envs (the test is skipped)
+static struct Env* sched_test_begin(char* testName, int numOfEnvs)
+{
+	if (sched_num_of_ready() > 0 || get_cpu_proc() != NULL || EDF.numOfEnvs > 0)
+	{
+		cprintf("%s: there're ready envs, kill them first\n", testName);
+		return NULL;
+	}
+	struct Env* tenvs = kmalloc(numOfEnvs * sizeof(struct Env));
+	if (tenvs == NULL)
+		panic("%s: no kernel heap space", testName);
+	memset(tenvs, 0, numOfEnvs * sizeof(struct Env));
+	for (int i = 0; i < numOfEnvs; i++)
+		tenvs[i].env_id = i + 1;
+	return tenvs;
+}
+
+//Free the dummy envs & restore the default scheduler
+static void sched_test_end(struct Env* tenvs)
+{
+	kfree(tenvs);
+	sched_init_RR(INIT_QUANTUM_IN_MS);
+}
+
+#define PRIRR_TEST_LEVELS 100
+#define PRIRR_TEST_ENVS 8
+
+//Check the bitmap of the non-empty ready queues and the batch aging of the priority RR
+//using dummy envs. It should be run from the prompt while there's no ready env
+void test_prirr_ready_bitmap()
+{
+	struct Env* tenvs = sched_test_begin("test_prirr_ready_bitmap", PRIRR_TEST_ENVS);
+	if (tenvs == NULL)
+		return;
+	uint32 starvThresh = 100;
+	sched_init_PRIRR(PRIRR_TEST_LEVELS, INIT_QUANTUM_IN_MS, starvThresh);
+
+	//levels around the word boundaries of the bitmap
+	int levels[PRIRR_TEST_ENVS] = {99, 64, 63, 33, 32, 31, 1, 99};
+	int sorted[PRIRR_TEST_ENVS] = {1, 31, 32, 33, 63, 64, 99, 99};
+
+	acquire_spinlock(&ProcessQueues.qlock);
+	{
+		for (int i = 0; i < PRIRR_TEST_ENVS; i++)
+		{
+			tenvs[i].priority = levels[i];
+			sched_insert_ready(&tenvs[i]);
+		}
+		//the envs should be picked in the order of their priorities
+		for (int i = 0; i < PRIRR_TEST_ENVS; i++)
+		{
+			int level = sched_highest_ready_level();
+			if (level != sorted[i])
+				panic("test_prirr_ready_bitmap: highest ready level = %d, expected %d", level, sorted[i]);
+			struct Env* e = sched_ready_dequeue(level);
+			assert(e != NULL && e->priority == level);
+			e->env_status = ENV_UNKNOWN;
+		}
+		if (sched_highest_ready_level() != -1 || ProcessQueues.ready_summary[0] != 0)
+			panic("test_prirr_ready_bitmap: bitmap is not empty after dequeuing all envs");
+
+		//the even envs have waited past the starvation threshold
+		for (int i = 0; i < PRIRR_TEST_ENVS; i++)
+		{
+			sched_insert_ready(&tenvs[i]);
+			if (i % 2 == 0)
+				tenvs[i].enqueueTime = (uint32)ticks - starvThresh;
+		}
+	}
+	release_spinlock(&ProcessQueues.qlock);
+
+	sched_age_PRIRR();
+
+	acquire_spinlock(&ProcessQueues.qlock);
+	{
+		//only the starved envs are promoted, by a single level
+		for (int i = 0; i < PRIRR_TEST_ENVS; i++)
+		{
+			int expected = levels[i] - (i % 2 == 0 ? 1 : 0);
+			if (tenvs[i].priority != expected ||
+					find_env_in_queue(&(ProcessQueues.env_ready_queues[expected]), tenvs[i].env_id) == NULL)
+				panic("test_prirr_ready_bitmap: env #%d is at priority %d after aging, expected %d", i, tenvs[i].priority, expected);
+		}
+		if (sched_highest_ready_level() != 0)
+			panic("test_prirr_ready_bitmap: promoted env is not found at priority 0");
+		for (int i = 0; i < PRIRR_TEST_ENVS; i++)
+			sched_remove_ready(&tenvs[i]);
+		if (sched_highest_ready_level() != -1)
+			panic("test_prirr_ready_bitmap: bitmap is not empty after removing all envs");
+	}
+	release_spinlock(&ProcessQueues.qlock);
+
+	sched_test_end(tenvs);
+	cprintf("\nCongratulations!! test_prirr_ready_bitmap completed successfully.\n");
+}
+
+//Check the demotion, the blocking and the boost of the MLFQ using two dummy envs
+//that act as the curenv. It should be run from the prompt while there's no ready env
+void test_mlfq_levels()
+{
+	struct Env* tenvs = sched_test_begin("test_mlfq_levels", 2);
+	if (tenvs == NULL)
+		return;
+	uint8 quantumOfEachLevel[3] = {5, 10, 20};
+	sched_init_MLFQ(3, quantumOfEachLevel);
+	struct Env *A = &tenvs[0], *B = &tenvs[1];
+
+	acquire_spinlock(&ProcessQueues.qlock);
+	{
+		sched_insert_ready(A);
+		sched_insert_ready(B);
+		struct Env* next = fos_scheduler_MLFQ();
+		if (next != A)
+			panic("test_mlfq_levels: the first env at the top level is not picked first");
+
+		//A uses its whole quantum: demoted
+		set_cpu_proc(A);
+		next = fos_scheduler_MLFQ();
+		if (next != B || A->priority != 1)
+			panic("test_mlfq_levels: preempted env is not demoted (level = %d)", A->priority);
+
+		//B blocks then it's woken up: it stays at the top level and it's picked before A
+		set_cpu_proc(NULL);
+		sched_insert_ready(B);
+		next = fos_scheduler_MLFQ();
+		if (next != B || B->priority != 0)
+			panic("test_mlfq_levels: blocked env does not keep its level (level = %d)", B->priority);
+
+		//CPU hogs sink to the bottom level and stay there
+		for (int i = 0; i < 6; i++)
+		{
+			set_cpu_proc(next);
+			next = fos_scheduler_MLFQ();
+		}
+		set_cpu_proc(NULL);
+		sched_insert_ready(next);
+		if (A->priority != 2 || B->priority != 2 || sched_highest_ready_level() != 2)
+			panic("test_mlfq_levels: envs are at levels %d & %d, expected the bottom level", A->priority, B->priority);
+	}
+	release_spinlock(&ProcessQueues.qlock);
+
+	sched_boost_MLFQ();
+
+	acquire_spinlock(&ProcessQueues.qlock);
+	{
+		if (A->priority != 0 || B->priority != 0 || ProcessQueues.ready_bitmap[0][0] != 1)
+			panic("test_mlfq_levels: envs are not boosted to the top level");
+		if (find_env_in_queue(&(ProcessQueues.env_ready_queues[0]), A->env_id) == NULL ||
+				find_env_in_queue(&(ProcessQueues.env_ready_queues[0]), B->env_id) == NULL)
+			panic("test_mlfq_levels: boosted envs are not found in the top level queue");
+		sched_remove_ready(A);
+		sched_remove_ready(B);
+	}
+	release_spinlock(&ProcessQueues.qlock);
+
+	sched_test_end(tenvs);
+	cprintf("\nCongratulations!! test_mlfq_levels completed successfully.\n");
+}
+
+//===================================================================
+void test_bsd_priorities()
+{
+	struct Env* tenvs = sched_test_begin("test_bsd_priorities", 2);
+	if (tenvs == NULL)
+		return;
+	sched_init_BSD(PRI_MAX - PRI_MIN + 1, 10);
+	struct Env *A = &tenvs[0], *B = &tenvs[1];
+	env_set_nice(B, 10);
+
+	acquire_spinlock(&ProcessQueues.qlock);
+	{
+		//priority = PRI_MAX - recent_cpu/4 - 2*nice, one level per priority
+		sched_insert_ready(A);
+		sched_insert_ready(B);
+		if (A->priority != PRI_MAX || B->priority != PRI_MAX - 20 || sched_highest_ready_level() != 0)
+			panic("test_bsd_priorities: priorities are %d & %d, expected %d & %d", A->priority, B->priority, PRI_MAX, PRI_MAX - 20);
+		struct Env* next = fos_scheduler_BSD();
+		if (next != A)
+			panic("test_bsd_priorities: the env of the highest priority is not picked first");
+
+		//A has got a lot of CPU: it falls below B
+		set_cpu_proc(A);
+		A->recent_cpu = fix_int(100);
+		A->priority = env_bsd_priority(A);
+		next = fos_scheduler_BSD();
+		if (next != B || A->priority != PRI_MAX - 25)
+			panic("test_bsd_priorities: the env of the highest priority is not picked (A's priority = %d)", A->priority);
+	}
+	release_spinlock(&ProcessQueues.qlock);
+
+	//a lower nice moves the ready env to its new level right away
+	env_set_nice(A, NICE_MIN);
+	acquire_spinlock(&ProcessQueues.qlock);
+	{
+		if (A->priority != PRI_MAX || sched_highest_ready_level() != 0 ||
+				find_env_in_queue(&(ProcessQueues.env_ready_queues[0]), A->env_id) == NULL)
+			panic("test_bsd_priorities: env is not moved after changing its nice (priority = %d)", A->priority);
+	}
+	release_spinlock(&ProcessQueues.qlock);
+
+	//one second elapses with B running and A ready: load_avg = 2/60
+	set_cpu_proc(B);
+	bsdSecTicks_ = bsdTicksPerSec_ - 1;
+	sched_update_BSD();
+	if (get_load_average() != 3)
+		panic("test_bsd_priorities: load average = %d/100, expected 3/100", get_load_average());
+	if (env_get_recent_cpu(B) != 100)
+		panic("test_bsd_priorities: recent_cpu of the running env = %d/100, expected 100/100", env_get_recent_cpu(B));
+
+	acquire_spinlock(&ProcessQueues.qlock);
+	{
+		set_cpu_proc(NULL);
+		sched_remove_ready(A);
+		if (sched_highest_ready_level() >= 0)
+			panic("test_bsd_priorities: bitmap is not empty after removing all envs");
+	}
+	release_spinlock(&ProcessQueues.qlock);
+
+	sched_test_end(tenvs);
+	cprintf("\nCongratulations!! test_bsd_priorities completed successfully.\n");
+}
+
+//===================================================================
+void test_edf_admission()
+{
+	struct Env* tenvs = sched_test_begin("test_edf_admission", 3);
+	if (tenvs == NULL)
+		return;
+	sched_init_RR(INIT_QUANTUM_IN_MS);
+	struct Env *A = &tenvs[0], *B = &tenvs[1], *C = &tenvs[2];
+
+	//admission: the total utilization must not exceed 1
+	if (sched_rt_set_params(A, 100, 30) != 0 || sched_rt_set_params(B, 50, 20) != 0)
+		panic("test_edf_admission: envs of total utilization 0.7 are not admitted");
+	if (sched_rt_set_params(C, 10, 4) != E_INVAL || C->rtPeriod != 0)
+		panic("test_edf_admission: an env that exceeds the total utilization is admitted");
+	if (sched_rt_set_params(C, 10, 11) != E_INVAL)
+		panic("test_edf_admission: a budget larger than its period is accepted");
+	if (sched_rt_set_params(C, 10, 3) != 0 || EDF.utilization != EDF_UTIL_SCALE)
+		panic("test_edf_admission: utilization = %d, expected %d", EDF.utilization, EDF_UTIL_SCALE);
+
+	acquire_spinlock(&ProcessQueues.qlock);
+	{
+		//earliest deadline first, ahead of the best-effort envs
+		sched_insert_ready(A);
+		sched_insert_ready(B);
+		sched_insert_ready(C);
+		if (sched_num_of_ready() != 0)
+			panic("test_edf_admission: real-time envs are inserted in the best-effort ready queues");
+		if (sched_next_EDF() != C || sched_next_EDF() != B || sched_next_EDF() != A || sched_next_EDF() != NULL)
+			panic("test_edf_admission: envs are not picked by their deadlines");
+
+		//a deadline passed while it was blocked: a miss, & its next job is released
+		uint32 oldDeadline = A->rtDeadline;
+		A->rtDeadline = TimerWheel.now;
+		sched_insert_ready(A);
+		if (A->rtMisses != 1 || A->rtJobs != 2 || A->rtDeadline != TimerWheel.now + 100 || A->rtRemaining != 30)
+			panic("test_edf_admission: the passed deadline is not caught up (misses = %d, jobs = %d)", A->rtMisses, A->rtJobs);
+		A->rtDeadline = oldDeadline;
+		sched_remove_ready(A);
+		if (LIST_SIZE(&EDF.readyQueue) != 0)
+			panic("test_edf_admission: env is not removed from the real-time ready queue");
+	}
+	release_spinlock(&ProcessQueues.qlock);
+
+	sched_leave_EDF(A);
+	sched_leave_EDF(B);
+	sched_leave_EDF(C);
+	if (EDF.numOfEnvs != 0 || EDF.utilization != 0)
+		panic("test_edf_admission: utilization = %d after all envs left", EDF.utilization);
+
+	sched_test_end(tenvs);
+	cprintf("\nCongratulations!! test_edf_admission completed successfully.\n");
+}
+
+//===================================================================
+void test_stride_heap()
+{
+	struct Env* tenvs = sched_test_begin("test_stride_heap", 3);
+	if (tenvs == NULL)
+		return;
+	sched_init_STRIDE(10);
+
+	int tickets[3] = {300, 200, 100};
+	int picks[3] = {0};
+	for (int i = 0; i < 3; i++)
+	{
+		tenvs[i].strideIndex = -1;
+		env_set_tickets(&tenvs[i], tickets[i]);
+	}
+
+	acquire_spinlock(&ProcessQueues.qlock);
+	{
+		for (int i = 0; i < 3; i++)
+			sched_insert_ready(&tenvs[i]);
+		if (sched_num_of_ready() != 3 || StrideSched.size[0] != 3)
+			panic("test_stride_heap: envs are not inserted in the stride heap");
+
+		//600 quantums: each env gets its share of the tickets (deterministic, up to a quantum)
+		for (int q = 0; q < 600; q++)
+		{
+			struct Env* next = fos_scheduler_STRIDE();
+			if (next == NULL)
+				panic("test_stride_heap: no env is picked");
+			picks[next - tenvs]++;
+			set_cpu_proc(next);
+		}
+		for (int i = 0; i < 3; i++)
+		{
+			if (picks[i] < tickets[i] - 1 || picks[i] > tickets[i] + 1)
+				panic("test_stride_heap: env of %d tickets got %d quantums of 600, expected %d", tickets[i], picks[i], tickets[i]);
+		}
+
+		//an env removed from the middle of the heap is not picked any more
+		struct Env* cur = get_cpu_proc();
+		set_cpu_proc(NULL);
+		sched_insert_ready(cur);
+		sched_remove_ready(&tenvs[1]);
+		for (int q = 0; q < 10; q++)
+		{
+			struct Env* next = fos_scheduler_STRIDE();
+			if (next == &tenvs[1])
+				panic("test_stride_heap: a removed env is picked");
+			set_cpu_proc(next);
+		}
+
+		//a new env starts from the virtual time (not from pass 0)
+		tenvs[1].pass = 0;
+		sched_insert_ready(&tenvs[1]);
+		if (tenvs[1].pass != StrideSched.virtualTime[0])
+			panic("test_stride_heap: a new env starts from pass %u, expected the virtual time %u", tenvs[1].pass, StrideSched.virtualTime[0]);
+
+		set_cpu_proc(NULL);
+		for (int i = 0; i < 3; i++)
+		{
+			if (tenvs[i].strideIndex >= 0)
+				sched_remove_ready(&tenvs[i]);
+		}
+		if (sched_num_of_ready() != 0 || StrideSched.size[0] != 0)
+			panic("test_stride_heap: heap is not empty after removing all envs");
+	}
+	release_spinlock(&ProcessQueues.qlock);
+
+	sched_test_end(tenvs);
+	cprintf("\nCongratulations!! test_stride_heap completed successfully.\n");
+}
+
+//===================================================================
+void test_sched_stats()
+{
+	if (sched_lat_bucket(0) != 0 || sched_lat_bucket(3) != 0 || sched_lat_bucket(4) != 1 ||
+			sched_lat_bucket(15) != 1 || sched_lat_bucket(16) != 2 || sched_lat_bucket(0xFFFFFFFF) != SCHED_LAT_BUCKETS - 1)
+		panic("test_sched_stats: wrong latency buckets");
+
+	struct Env* e = kmalloc(sizeof(struct Env));
+	if (e == NULL)
+		panic("test_sched_stats: no kernel heap space");
+	memset(e, 0, sizeof(struct Env));
+	//the counters of all the CPUs are kept as they are
+	struct SchedStats saved = GlobalSchedStats;
+	sched_stat_idle();
+
+	acquire_spinlock(&ProcessQueues.qlock);
+	{
+		//new -> ready -> running: a wake-to-run latency
+		sched_stat_ready(e);
+		if (!e->statWoken || e->statStamp == 0)
+			panic("test_sched_stats: a new env doesn't start its wake-to-run latency");
+		sched_stat_dispatch(e);
+		if (e->schedStats.dispatches != 1 || e->schedStats.wakeups != 1 || e->statWoken ||
+				GlobalSchedStats.wakeups != saved.wakeups + 1 || GlobalSchedStats.switches != saved.switches + 1)
+			panic("test_sched_stats: dispatch of a new env is not counted");
+
+		//preempted: ready again (no wakeup), then run again right after leaving (a timed switch)
+		for (volatile int i = 0; i < 100000; i++);
+		e->env_status = ENV_READY;
+		sched_stat_leave(e);
+		if (e->schedStats.runTime == 0 || e->statBlocked)
+			panic("test_sched_stats: the run time of the preempted env is not counted");
+		sched_stat_ready(e);
+		sched_stat_dispatch(e);
+		if (e->schedStats.wakeups != 1 || GlobalSchedStats.timedSwitches != saved.timedSwitches + 1)
+			panic("test_sched_stats: a preempted env is counted as woken up (or its switch is not timed)");
+
+		//blocked -> woken up: blocked time & a second latency
+		e->env_status = ENV_BLOCKED;
+		sched_stat_leave(e);
+		sched_stat_idle();
+		for (volatile int i = 0; i < 100000; i++);
+		sched_stat_ready(e);
+		sched_stat_dispatch(e);
+		uint32 n = 0;
+		for (int b = 0; b < SCHED_LAT_BUCKETS; b++)
+			n += e->schedStats.wakeLatencyHist[b];
+		if (e->schedStats.blockedTime == 0 || e->schedStats.wakeups != 2 || n != 2 ||
+				GlobalSchedStats.timedSwitches != saved.timedSwitches + 1)
+			panic("test_sched_stats: blocked time = %d, wakeups = %d, latencies = %d", e->schedStats.blockedTime, e->schedStats.wakeups, n);
+		mycpu()->statLeave = 0;
+		GlobalSchedStats = saved;
+	}
+	release_spinlock(&ProcessQueues.qlock);
+
+	kfree(e);
+	cprintf("\nCongratulations!! test_sched_stats completed successfully.\n");
+}
+
+#define SMP_TEST_ENVS 16
+uint8 firstTimeTestSMP = 1;
+int smpEnvIDs[SMP_TEST_ENVS];
+uint32 smpSteals, smpShootdowns;
+
+//SMP smoke test: a job of many envs made ready on the boot CPU must spread over the other CPUs (the
+//idle ones steal them) & exit on them. Run it twice: it loads & runs the envs, then checks them once
+//they've all exited
+void test_smp_steals()
+{
+	if (ncpu < 2)
+	{
+		cprintf("test_smp_steals: needs more than one CPU (cpu: count in .bochsrc, or make qemu)\n");
+		return;
+	}
+	if (firstTimeTestSMP)
+	{
+		firstTimeTestSMP = 0;
+		smpSteals = MPStats.steals;
+		smpShootdowns = TLBShootdown.shootdowns;
+		for (int i = 0; i < SMP_TEST_ENVS; i++)
+		{
+			struct Env *env = env_create("dummy_process", 500, 0, 0);
+			if (env == NULL)
+				panic("Loading programs failed\n");
+			smpEnvIDs[i] = env->env_id;
+			sched_new_env(env);
+		}
+		cprintf("> Running... (After all running programs finish, Run the same command again.)\n");
+		execute_command("runall");
+		return;
+	}
+
+	cprintf("> Checking...\n");
+	int numOfExited = 0;
+	uint32 cpusUsed = 0;
+	acquire_spinlock(&ProcessQueues.qlock);
+	{
+		for (struct Env* e = LIST_FIRST(&ProcessQueues.env_exit_queue); e != NULL; e = LIST_NEXT(e))
+		{
+			for (int i = 0; i < SMP_TEST_ENVS; i++)
+			{
+				if (e->env_id == smpEnvIDs[i])
+				{
+					numOfExited++;
+					cpusUsed |= 1 << e->cpu;
+				}
+			}
+		}
+	}
+	release_spinlock(&ProcessQueues.qlock);
+	firstTimeTestSMP = 1;
+
+	if (numOfExited != SMP_TEST_ENVS)
+		panic("test_smp_steals: %d envs of %d have exited", numOfExited, SMP_TEST_ENVS);
+	if (MPStats.steals == smpSteals)
+		panic("test_smp_steals: no ready env is stolen by an idle CPU");
+	if ((cpusUsed & (cpusUsed - 1)) == 0)
+		panic("test_smp_steals: all the envs have run on a single CPU");
+	cprintf("steals = %d, TLB shootdowns = %d, CPUs used = %x\n",
+			MPStats.steals - smpSteals, TLBShootdown.shootdowns - smpShootdowns, cpusUsed);
+	cprintf("\nCongratulations!! test_smp_steals completed successfully.\n");
+}
+
+#define WHEEL_TEST_ENVS 7
+
+//Cascades & expiries of the timer wheel at the boundaries of its levels, using dummy envs.
+//The wheel is driven by the test (1 ms at a time) while the clock of this CPU is held off,
+//so it should be run from the prompt (on the boot CPU) while no env is sleeping
+void test_timer_wheel()
+{
+	if (mycpu() != &CPUS[0] || TimerWheel.numOfSleepers > 0)
+	{
+		cprintf("test_timer_wheel: there're sleeping envs (or not on the boot CPU)\n");
+		return;
+	}
+	struct Env* tenvs = sched_test_begin("test_timer_wheel", WHEEL_TEST_ENVS);
+	if (tenvs == NULL)
+		return;
+	sched_init_RR(INIT_QUANTUM_IN_MS);
+
+	//ms after the start of the test (the turn of level 2) at which each env sleeps & for how long:
+	//	4091 at 10: on the slot of the current index of level 1 (a whole turn ahead), alone till 64
+	//	63 & 64 / 4095 & 4096 at 64: the last deadline of a level & the first one of the next level
+	//	4160 at 64: cascaded twice (level 2 -> 1 -> 0)
+	//	54 at 74: the same deadline as the one of 64 at 64, but put on level 0 directly
+	uint32 sleepAt[WHEEL_TEST_ENVS] = {10, 64, 64, 64, 64, 64, 74};
+	uint32 sleepFor[WHEEL_TEST_ENVS] = {4091, 63, 64, 4095, 4096, 4160, 54};
+	uint32 expectedCascades = 7;
+	uint8 woken[WHEEL_TEST_ENVS] = {0};
+	int numOfWoken = 0;
+
+	//hold off the clock of this CPU: it's the only one that advances the wheel
+	pushcli();
+	uint32 wakeups = TimerWheel.wakeups;
+	uint32 cascades = TimerWheel.cascades;
+	//start at the turn of level 2, so the levels are aligned with the deadlines above
+	timer_wheel_advance(TW_SLOTS * TW_SLOTS - (TimerWheel.now & (TW_SLOTS * TW_SLOTS - 1)));
+	uint32 start = TimerWheel.now;
+
+	for (uint32 t = 0; numOfWoken < WHEEL_TEST_ENVS; t++)
+	{
+		for (int i = 0; i < WHEEL_TEST_ENVS; i++)
+		{
+			if (sleepAt[i] == t)
+				timer_wheel_block(&tenvs[i], sleepFor[i]);
+		}
+
+		acquire_spinlock(&ProcessQueues.qlock);
+		{
+			uint32 expected = TW_NO_EXPIRY;
+			for (int i = 0; i < WHEEL_TEST_ENVS; i++)
+			{
+				if (!woken[i] && sleepAt[i] <= t && sleepAt[i] + sleepFor[i] - t < expected)
+					expected = sleepAt[i] + sleepFor[i] - t;
+			}
+			uint32 next = timer_wheel_next_expiry();
+			if (next != expected)
+				panic("test_timer_wheel: next expiry is after %d ms at %d, expected %d", next, t, expected);
+		}
+		release_spinlock(&ProcessQueues.qlock);
+
+		timer_wheel_advance(1);
+		uint32 now = TimerWheel.now - start;
+
+		acquire_spinlock(&ProcessQueues.qlock);
+		{
+			for (int i = 0; i < WHEEL_TEST_ENVS; i++)
+			{
+				if (woken[i] || sleepAt[i] > t)
+					continue;
+				uint32 deadline = sleepAt[i] + sleepFor[i];
+				if (tenvs[i].env_status == ENV_READY)
+				{
+					if (now != deadline)
+						panic("test_timer_wheel: env #%d is woken up at %d, its deadline is %d", i, now, deadline);
+					sched_remove_ready(&tenvs[i]);
+					woken[i] = 1;
+					numOfWoken++;
+				}
+				else if (now >= deadline)
+				{
+					panic("test_timer_wheel: env #%d is still sleeping at %d, its deadline is %d", i, now, deadline);
+				}
+			}
+		}
+		release_spinlock(&ProcessQueues.qlock);
+	}
+	popcli();
+
+	if (TimerWheel.numOfSleepers != 0 || TimerWheel.wakeups - wakeups != WHEEL_TEST_ENVS)
+		panic("test_timer_wheel: %d envs are woken up, %d are still sleeping", TimerWheel.wakeups - wakeups, TimerWheel.numOfSleepers);
+	if (TimerWheel.cascades - cascades != expectedCascades)
+		panic("test_timer_wheel: %d cascades, expected %d", TimerWheel.cascades - cascades, expectedCascades);
+	sched_test_end(tenvs);
+	cprintf("\nCongratulations!! test_timer_wheel completed successfully.\n");
+}
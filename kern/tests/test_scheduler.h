@@ -15,5 +15,13 @@
 void test_bsd_nice_0();
 void test_bsd_nice_1();
 void test_bsd_nice_2();
+void test_prirr_ready_bitmap();
+void test_mlfq_levels();
+void test_bsd_priorities();
+void test_edf_admission();
+void test_stride_heap();
+void test_sched_stats();
+void test_smp_steals();
+void test_timer_wheel();
 
 #endif
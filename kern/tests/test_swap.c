@@ -0,0 +1,602 @@
+/*
+ * test_swap.c
+ *
+ * Tests of the swap tiers in front of the page file.
+ */
+
+#include <kern/tests/test_swap.h>
+#include <kern/disk/pagefile_manager.h>
+#include <kern/disk/zswap.h>
+#include <kern/disk/io_scheduler.h>
+#include <kern/disk/block_device.h>
+#include <kern/mem/kheap.h>
+#include <kern/mem/memory_manager.h>
+#include <kern/mem/shared_memory_manager.h>
+#include <kern/conc/futex.h>
+#include <kern/proc/user_environment.h>
+#include <kern/cpu/sched.h>
+#include <kern/cpu/sched_helpers.h>
+
+extern struct Share* get_share(int32 ownerID, char* name);
+
+#define NUM_OF_PATTERNS 4
+
+//fill the page with one of the test patterns. Return whether it's expected to be compressible
+static int fill_page(uint8* page, int pattern, uint32 seed)
+{
+	uint32 rnd = seed * 1103515245 + 12345;
+	for (int i = 0; i < PAGE_SIZE; i++)
+	{
+		rnd = rnd * 1103515245 + 12345;
+		switch (pattern)
+		{
+		case 0: page[i] = 0; break;								//zero-filled
+		case 1: page[i] = (i / 8 + seed) & 0xFF; break;			//sorted data
+		case 2: page[i] = (rnd >> 16) % 50 ? 0 : (rnd >> 8); break;	//sparse data
+		default: page[i] = rnd >> 16; break;					//random data
+		}
+	}
+	return pattern != 3;
+}
+
+int test_lz_compression()
+{
+	uint8* src = kmalloc(PAGE_SIZE);
+	uint8* cmp = kmalloc(PAGE_SIZE);
+	uint8* dst = kmalloc(PAGE_SIZE);
+	//its own hash table: the one of zswap_store() is protected by the zlock
+	uint16* hashTable = kmalloc(LZ_HASH_SIZE * sizeof(uint16));
+	if (src == NULL || cmp == NULL || dst == NULL || hashTable == NULL)
+		panic("test_lz_compression: no kernel heap space");
+
+	for (int pattern = 0; pattern < NUM_OF_PATTERNS; pattern++)
+	{
+		int compressible = fill_page(src, pattern, pattern + 1);
+		uint32 len = lz_compress(src, PAGE_SIZE, cmp, ZSWAP_MAX_COMPRESSED_SIZE, hashTable);
+		if (!compressible)
+		{
+			if (len != 0)
+				panic("test_lz_compression: random data is compressed to %d bytes, expected to be rejected", len);
+			continue;
+		}
+		if (len == 0)
+			panic("test_lz_compression: pattern #%d is not compressed", pattern);
+		if (pattern == 0 && len > ZSWAP_UNIT_SIZE)
+			panic("test_lz_compression: zero page is compressed to %d bytes, expected <= %d", len, ZSWAP_UNIT_SIZE);
+
+		memset(dst, 0xAA, PAGE_SIZE);
+		if (lz_decompress(cmp, len, dst, PAGE_SIZE) != PAGE_SIZE || memcmp(src, dst, PAGE_SIZE) != 0)
+			panic("test_lz_compression: pattern #%d is corrupted after decompression", pattern);
+		cprintf("pattern #%d: %d bytes => %d bytes\n", pattern, PAGE_SIZE, len);
+	}
+
+	//corrupted input must be rejected, not overflow the output
+	fill_page(src, 1, 7);
+	uint32 len = lz_compress(src, PAGE_SIZE, cmp, PAGE_SIZE, hashTable);
+	if (lz_decompress(cmp, len, dst, PAGE_SIZE / 2) != 0)
+		panic("test_lz_compression: decompression exceeded the output capacity");
+
+	kfree(src);
+	kfree(cmp);
+	kfree(dst);
+	kfree(hashTable);
+	cprintf("Congratulations!! test LZ compression completed successfully.\n");
+	return 0;
+}
+
+#define NUM_OF_TEST_PAGES 20
+
+int test_zswap_pool()
+{
+	if (Zswap.enabled)
+	{
+		cprintf("test_zswap_pool: compressed swap is already enabled, disable it first (nozswap)\n");
+		return 0;
+	}
+	uint8* page = kmalloc(PAGE_SIZE);
+	uint8* expected = kmalloc(PAGE_SIZE);
+	if (page == NULL || expected == NULL)
+		panic("test_zswap_pool: no kernel heap space");
+
+	//a one-page pool fits a single sorted page, so storing more forces write backs
+	if (zswap_enable(1) != 0)
+		panic("test_zswap_pool: failed to enable the compressed swap");
+
+	uint32 dfns[NUM_OF_TEST_PAGES];
+	for (int i = 0; i < NUM_OF_TEST_PAGES; i++)
+	{
+		if (allocate_disk_frame(&dfns[i]) != 0)
+			panic("test_zswap_pool: page file is full");
+		fill_page(page, i % 3, i);
+		if (zswap_store(dfns[i], page) != 0)
+			panic("test_zswap_pool: failed to store page #%d", i);
+	}
+	if (ZswapStats.writeBacks == 0)
+		panic("test_zswap_pool: pool is full but no page is written back");
+
+	//every page must come back intact, either from the pool or from the page file
+	int fromPool = 0;
+	for (int i = 0; i < NUM_OF_TEST_PAGES; i++)
+	{
+		fill_page(expected, i % 3, i);
+		memset(page, 0xAA, PAGE_SIZE);
+		if (zswap_load(dfns[i], page) == 0)
+			fromPool++;
+		else
+			read_disk_page(dfns[i], page);
+		if (memcmp(page, expected, PAGE_SIZE) != 0)
+			panic("test_zswap_pool: page #%d is corrupted", i);
+	}
+	if (fromPool == 0)
+		panic("test_zswap_pool: no page is loaded from the pool");
+	if (ZswapStats.storedPages != 0 || ZswapStats.storedBytes != 0)
+		panic("test_zswap_pool: pool is not empty after loading all pages");
+
+	zswap_print_stats();
+	zswap_disable();
+	for (int i = 0; i < NUM_OF_TEST_PAGES; i++)
+		free_disk_frame(dfns[i]);
+	kfree(page);
+	kfree(expected);
+	cprintf("Congratulations!! test compressed swap pool completed successfully.\n");
+	return 0;
+}
+
+int test_io_queue()
+{
+	if (PageFileDevices.devices[0]->type != BLK_IDE)
+	{
+		cprintf("test_io_queue: the page file is not on the IDE disks\n");
+		return 0;
+	}
+	uint8* page = kmalloc(PAGE_SIZE);
+	uint8* expected = kmalloc(PAGE_SIZE);
+	if (page == NULL || expected == NULL)
+		panic("test_io_queue: no kernel heap space");
+
+	uint32 dfns[NUM_OF_TEST_PAGES];
+	uint32 completed[IDE_MAX_DISKS];
+	for (int d = 0; d < IDE_MAX_DISKS; d++)
+		completed[d] = IOQueues[d].stats.completed;
+	for (int i = 0; i < NUM_OF_TEST_PAGES; i++)
+	{
+		//consecutive frames to exercise all the stripes
+		if (allocate_disk_frame(&dfns[i]) != 0)
+			panic("test_io_queue: page file is full");
+		fill_page(page, i % NUM_OF_PATTERNS, i);
+		write_disk_page(dfns[i], page);
+	}
+	//read them back in the reverse order
+	for (int i = NUM_OF_TEST_PAGES - 1; i >= 0; i--)
+	{
+		fill_page(expected, i % NUM_OF_PATTERNS, i);
+		memset(page, 0xAA, PAGE_SIZE);
+		if (read_disk_page(dfns[i], page) != 0)
+			panic("test_io_queue: failed to read page #%d", i);
+		if (memcmp(page, expected, PAGE_SIZE) != 0)
+			panic("test_io_queue: page #%d is corrupted", i);
+	}
+	uint32 total = 0;
+	for (int d = 0; d < IDE_MAX_DISKS; d++)
+	{
+		uint32 n = IOQueues[d].stats.completed - completed[d];
+		//the frames are spread over the striped disks
+		if (d < PageFileDevices.numOfStripes && n == 0)
+			panic("test_io_queue: no request is served by disk %d of the page file", d);
+		if (LIST_SIZE(&IOQueues[d].queue) != 0 || IOQueues[d].busy)
+			panic("test_io_queue: queue of disk %d is not idle after all requests are completed", d);
+		total += n;
+	}
+	if (total != 2 * NUM_OF_TEST_PAGES)
+		panic("test_io_queue: %d requests are completed, expected %d", total, 2 * NUM_OF_TEST_PAGES);
+
+	io_print_stats();
+	for (int i = 0; i < NUM_OF_TEST_PAGES; i++)
+		free_disk_frame(dfns[i]);
+	kfree(page);
+	kfree(expected);
+	cprintf("Congratulations!! test disk request queue completed successfully.\n");
+	return 0;
+}
+
+#define NUM_OF_ELEVATOR_REQUESTS 7
+
+//C-LOOK order & merging of the queue. The requests (of a single sector each) are queued while the
+//test holds the dispatching of the disk (q->busy), then it dispatches them itself batch by batch
+int test_io_elevator()
+{
+	uint32 dfn, base;
+	if (allocate_disk_frame(&dfn) != 0)
+		panic("test_io_elevator: page file is full");
+	struct BlockDevice* dev = pf_locate(dfn, &base);
+	if (dev->type != BLK_IDE)
+	{
+		free_disk_frame(dfn);
+		cprintf("test_io_elevator: the page file is not on the IDE disks\n");
+		return 0;
+	}
+	struct IOQueue* q = &IOQueues[dev->unit];
+	uint8* page = kmalloc(PAGE_SIZE);
+	uint8* buffers = kmalloc(NUM_OF_ELEVATOR_REQUESTS * SECTSIZE);
+	if (page == NULL || buffers == NULL)
+		panic("test_io_elevator: no kernel heap space");
+
+	//initial contents of the frame: sector i is filled with 'A' + i
+	for (int s = 0; s < SECTOR_PER_PAGE; s++)
+		memset(page + s * SECTSIZE, 'A' + s, SECTSIZE);
+	if (blk_write(dev, base, page, SECTOR_PER_PAGE) != 0)
+		panic("test_io_elevator: failed to write the test frame");
+
+	//{sector (in the frame), direction} in their submission order. The head is put at sector 4:
+	//	5W & 6W are served first in a single command (7R is of the other direction)
+	//	then 7R, then it wraps around to 1W & 2W in a single command (3R is of the other direction)
+	//	then 3R & 3W, each on its own and in their submission order (the read must see the old contents)
+	uint32 sectors[NUM_OF_ELEVATOR_REQUESTS] = {5, 1, 6, 2, 7, 3, 3};
+	uint8 writes[NUM_OF_ELEVATOR_REQUESTS] = {IO_WRITE, IO_WRITE, IO_WRITE, IO_WRITE, IO_READ, IO_READ, IO_WRITE};
+	int expectedOrder[NUM_OF_ELEVATOR_REQUESTS] = {0, 2, 4, 1, 3, 5, 6};
+	int expectedBatches[] = {2, 1, 2, 1, 1};
+	uint32 expectedHead[] = {7, 8, 3, 4, 4};
+	int numOfBatches = sizeof(expectedBatches) / sizeof(expectedBatches[0]);
+
+	struct IORequest reqs[NUM_OF_ELEVATOR_REQUESTS];
+	for (int i = 0; i < NUM_OF_ELEVATOR_REQUESTS; i++)
+	{
+		//the writes write 'a' + i
+		memset(buffers + i * SECTSIZE, writes[i] ? 'a' + i : 0, SECTSIZE);
+		io_init_request(&reqs[i], base + sectors[i], buffers + i * SECTSIZE, 1, writes[i]);
+	}
+
+	int order[NUM_OF_ELEVATOR_REQUESTS];
+	int batchSizes[NUM_OF_ELEVATOR_REQUESTS];
+	uint32 heads[NUM_OF_ELEVATOR_REQUESTS];
+	int served = 0, batches = 0;
+	uint32 merges, dispatches;
+	acquire_spinlock(&q->iolock);
+	{
+		if (q->busy || LIST_SIZE(&q->queue) != 0)
+			panic("test_io_elevator: queue of disk %d is not idle", q->disk);
+		//hold the dispatching, so the requests pile up in the queue
+		q->busy = 1;
+		q->headPos = base + 4;
+		merges = q->stats.merges;
+		dispatches = q->stats.dispatches;
+		for (int i = 0; i < NUM_OF_ELEVATOR_REQUESTS; i++)
+			io_enqueue(q, &reqs[i]);
+
+		struct IORequest* batch[IO_MAX_MERGED_REQUESTS];
+		int count;
+		while ((count = io_dispatch(q, batch, NULL)) > 0)
+		{
+			if (batches == NUM_OF_ELEVATOR_REQUESTS || served + count > NUM_OF_ELEVATOR_REQUESTS)
+				panic("test_io_elevator: more requests are served than queued");
+			batchSizes[batches] = count;
+			heads[batches++] = q->headPos - base;
+			for (int i = 0; i < count; i++)
+				order[served++] = batch[i] - reqs;
+		}
+		merges = q->stats.merges - merges;
+		dispatches = q->stats.dispatches - dispatches;
+		q->busy = 0;
+	}
+	release_spinlock(&q->iolock);
+
+	if (served != NUM_OF_ELEVATOR_REQUESTS)
+		panic("test_io_elevator #1: %d requests are served, expected %d", served, NUM_OF_ELEVATOR_REQUESTS);
+	for (int i = 0; i < NUM_OF_ELEVATOR_REQUESTS; i++)
+	{
+		if (order[i] != expectedOrder[i])
+			panic("test_io_elevator #2: request #%d is served at %d, expected request #%d (sector %d)",
+					order[i], i, expectedOrder[i], sectors[expectedOrder[i]]);
+		if (!reqs[i].done || reqs[i].status != 0)
+			panic("test_io_elevator #2: request #%d is not completed successfully", i);
+	}
+	if (batches != numOfBatches)
+		panic("test_io_elevator #3: requests are served in %d commands, expected %d", batches, numOfBatches);
+	for (int b = 0; b < numOfBatches; b++)
+	{
+		if (batchSizes[b] != expectedBatches[b])
+			panic("test_io_elevator #3: command #%d serves %d requests, expected %d", b, batchSizes[b], expectedBatches[b]);
+		if (heads[b] != expectedHead[b])
+			panic("test_io_elevator #4: head is at sector %d after command #%d, expected %d", heads[b], b, expectedHead[b]);
+	}
+	if (merges != 2 || dispatches != numOfBatches)
+		panic("test_io_elevator #5: %d merges & %d dispatches are counted, expected 2 & %d", merges, dispatches, numOfBatches);
+
+	//the reads see the contents before the writes of the same sector that are submitted after them
+	for (int i = 0; i < NUM_OF_ELEVATOR_REQUESTS; i++)
+	{
+		if (writes[i])
+			continue;
+		uint8* buf = buffers + i * SECTSIZE;
+		for (int j = 0; j < SECTSIZE; j++)
+			if (buf[j] != 'A' + sectors[i])
+				panic("test_io_elevator #6: read of sector %d doesn't see its contents before the later write", sectors[i]);
+	}
+	//the frame holds the last write of each sector
+	if (blk_read(dev, base, page, SECTOR_PER_PAGE) != 0)
+		panic("test_io_elevator: failed to read the test frame");
+	for (int s = 0; s < SECTOR_PER_PAGE; s++)
+	{
+		uint8 expected = 'A' + s;
+		for (int i = 0; i < NUM_OF_ELEVATOR_REQUESTS; i++)
+			if (writes[i] && sectors[i] == s)
+				expected = 'a' + i;
+		for (int j = 0; j < SECTSIZE; j++)
+			if (page[s * SECTSIZE + j] != expected)
+				panic("test_io_elevator #7: sector %d holds '%c', expected '%c'", s, page[s * SECTSIZE + j], expected);
+	}
+
+	free_disk_frame(dfn);
+	kfree(page);
+	kfree(buffers);
+	cprintf("Congratulations!! test disk elevator completed successfully.\n");
+	return 0;
+}
+
+//read, write, submit & flush the page file frames on its current backend
+static void test_page_file_devices(uint8* page, uint8* expected)
+{
+
+	uint32 dfns[NUM_OF_TEST_PAGES];
+	for (int i = 0; i < NUM_OF_TEST_PAGES; i++)
+	{
+		if (allocate_disk_frame(&dfns[i]) != 0)
+			panic("test_block_device: page file is full");
+	}
+
+	//write synchronously, read through the queue
+	for (int i = 0; i < NUM_OF_TEST_PAGES; i++)
+	{
+		uint32 secno;
+		struct BlockDevice* dev = pf_locate(dfns[i], &secno);
+		fill_page(page, i % NUM_OF_PATTERNS, i);
+		if (blk_write(dev, secno, page, SECTOR_PER_PAGE) != 0)
+			panic("test_block_device: failed to write page #%d to %s", i, dev->name);
+	}
+	for (int i = 0; i < PageFileDevices.numOfStripes; i++)
+	{
+		if (blk_flush(PageFileDevices.devices[i]) != 0)
+			panic("test_block_device: failed to flush %s", PageFileDevices.devices[i]->name);
+	}
+	for (int i = 0; i < NUM_OF_TEST_PAGES; i++)
+	{
+		uint32 secno;
+		struct BlockDevice* dev = pf_locate(dfns[i], &secno);
+		fill_page(expected, i % NUM_OF_PATTERNS, i);
+		memset(page, 0xAA, PAGE_SIZE);
+		if (blk_submit(dev, secno, page, SECTOR_PER_PAGE, 0) != 0)
+			panic("test_block_device: failed to read page #%d from %s", i, dev->name);
+		if (memcmp(page, expected, PAGE_SIZE) != 0)
+			panic("test_block_device: page #%d is corrupted on %s", i, dev->name);
+	}
+
+	//and the other way around
+	for (int i = 0; i < NUM_OF_TEST_PAGES; i++)
+	{
+		uint32 secno;
+		struct BlockDevice* dev = pf_locate(dfns[i], &secno);
+		fill_page(page, (i + 1) % NUM_OF_PATTERNS, i);
+		if (blk_submit(dev, secno, page, SECTOR_PER_PAGE, 1) != 0)
+			panic("test_block_device: failed to submit page #%d to %s", i, dev->name);
+	}
+	for (int i = 0; i < NUM_OF_TEST_PAGES; i++)
+	{
+		uint32 secno;
+		struct BlockDevice* dev = pf_locate(dfns[i], &secno);
+		fill_page(expected, (i + 1) % NUM_OF_PATTERNS, i);
+		memset(page, 0xAA, PAGE_SIZE);
+		if (blk_read(dev, secno, page, SECTOR_PER_PAGE) != 0)
+			panic("test_block_device: failed to read page #%d from %s", i, dev->name);
+		if (memcmp(page, expected, PAGE_SIZE) != 0)
+			panic("test_block_device: page #%d is corrupted on %s", i, dev->name);
+	}
+
+	for (int i = 0; i < NUM_OF_TEST_PAGES; i++)
+		free_disk_frame(dfns[i]);
+}
+
+int test_block_device()
+{
+	uint8 backend = PageFileDevices.backend;
+	if (pf_set_backend(backend) != 0)
+	{
+		cprintf("test_block_device: the page file is in use, kill all the environments first\n");
+		return 0;
+	}
+	uint8* page = kmalloc(PAGE_SIZE);
+	uint8* expected = kmalloc(PAGE_SIZE);
+	if (page == NULL || expected == NULL)
+		panic("test_block_device: no kernel heap space");
+
+	//both backends, each with the page file on it (the RAM disk isn't there with too little memory)
+	uint8 backends[] = { BLK_IDE, BLK_RAMDISK };
+	for (int b = 0; b < sizeof(backends) / sizeof(backends[0]); b++)
+	{
+		if (backends[b] == BLK_RAMDISK && blk_find(BLK_RAMDISK, 0) == NULL)
+		{
+			cprintf("test_block_device: no RAM disk is reserved, its checks are skipped\n");
+			continue;
+		}
+		if (pf_set_backend(backends[b]) != 0)
+			panic("test_block_device: failed to switch the page file to backend %d", backends[b]);
+		if (PageFileDevices.devices[0]->type != backends[b])
+			panic("test_block_device: the page file is on %s, expected backend %d", PageFileDevices.devices[0]->name, backends[b]);
+		test_page_file_devices(page, expected);
+	}
+	if (pf_set_backend(backend) != 0)
+		panic("test_block_device: failed to switch the page file back to backend %d", backend);
+
+	blk_print_stats();
+	kfree(page);
+	kfree(expected);
+	cprintf("Congratulations!! test block devices completed successfully.\n");
+	return 0;
+}
+
+//Physical address of the given VA of the given env (0 if it's not mapped)
+static uint32 env_physical_address(struct Env* e, uint32 va)
+{
+	uint32* ptr_page_table = NULL;
+	struct FrameInfo* ptr_frame_info = get_frame_info(e->env_page_directory, va, &ptr_page_table);
+	return ptr_frame_info == NULL ? 0 : to_physical_address(ptr_frame_info) + PGOFF(va);
+}
+
+int test_share_futex_eviction()
+{
+	char shareName[] = "futexShare";
+	uint32 ownerVA = USER_HEAP_START;
+	uint32 waiterVA = USER_HEAP_START + PAGE_SIZE;
+	uint32 wordOffset = 16;
+
+	struct Env* owner = env_create("fos_helloWorld", 20, 10, 0);
+	struct Env* waiter = env_create("fos_helloWorld", 20, 10, 0);
+	if (owner == NULL || waiter == NULL)
+		panic("test_share_futex_eviction: failed to create the envs");
+
+	//the owner creates the share & touches its page, the waiter attaches it at another VA
+	set_cpu_proc(owner);
+	lcr3(owner->env_cr3);
+	if (createSharedObject(owner->env_id, shareName, PAGE_SIZE, 1, (void*)ownerVA) < 0)
+		panic("test_share_futex_eviction: failed to create the share");
+	share_fault_handler(owner, ownerVA);
+	set_cpu_proc(waiter);
+	lcr3(waiter->env_cr3);
+	if (getSharedObject(owner->env_id, shareName, (void*)waiterVA) < 0)
+		panic("test_share_futex_eviction: failed to get the share");
+
+	//block the waiter on a word of it, as futex_wait() does
+	uint32 key = env_physical_address(waiter, waiterVA + wordOffset);
+	if (key == 0 || key != env_physical_address(owner, ownerVA + wordOffset))
+		panic("test_share_futex_eviction: the share is not mapped to the same frame in both envs");
+	struct FutexBucket* bucket = futex_bucket(key);
+	acquire_spinlock(&bucket->lock);
+	acquire_spinlock(&ProcessQueues.qlock);
+	waiter->futexKey = key;
+	waiter->env_status = ENV_BLOCKED;
+	waiter->channel = &bucket->chan;
+	enqueue(&bucket->chan.queue, waiter);
+	release_spinlock(&ProcessQueues.qlock);
+	release_spinlock(&bucket->lock);
+
+	//the first scan clears the USED bits of the touches above, the second one finds it idle
+	set_cpu_proc(owner);
+	lcr3(owner->env_cr3);
+	uint32 waited = ShareSwap.waited;
+	share_reclaim(SHARE_RECLAIM_BATCH);
+	share_reclaim(SHARE_RECLAIM_BATCH);
+	if (env_physical_address(owner, ownerVA) != 0)
+		panic("test_share_futex_eviction: the idle frame of the share is not unmapped");
+	if (get_share(owner->env_id, shareName)->framesStorage[0] == NULL || ShareSwap.waited == waited)
+		panic("test_share_futex_eviction: the frame is evicted while an env is blocked on it");
+
+	//the owner faults on it again & signals the word: the waiter must be woken up
+	share_fault_handler(owner, ownerVA);
+	if (env_physical_address(owner, ownerVA + wordOffset) != key)
+		panic("test_share_futex_eviction: the word is moved to another frame");
+	int woken = futex_wake((volatile uint32*)(ownerVA + wordOffset), 1, 0);
+	if (woken != 1 || waiter->env_status != ENV_READY)
+		panic("test_share_futex_eviction: the blocked env is not woken up (%d woken)", woken);
+
+	sharing_print_stats();
+	set_cpu_proc(NULL);
+	lcr3(phys_page_directory);
+	sched_kill_env(waiter->env_id);
+	sched_new_env(owner);
+	sched_kill_env(owner->env_id);
+	cprintf("Congratulations!! test futex waiters on an evicted share completed successfully.\n");
+	return 0;
+}
+
+//Block the given env on the given channel, as sleep() does
+static void block_on_channel(struct Env* e, struct Channel* chan)
+{
+	acquire_spinlock(&ProcessQueues.qlock);
+	e->env_status = ENV_BLOCKED;
+	e->channel = chan;
+	enqueue(&chan->queue, e);
+	release_spinlock(&ProcessQueues.qlock);
+}
+
+int test_share_rwsleeplock()
+{
+	struct rwsleeplock lk;
+	init_rwsleeplock(&lk, "test rw sleep lock");
+
+	//[1] the readers share it, a writer holds it alone
+	acquire_read_rwsleeplock(&lk);
+	acquire_read_rwsleeplock(&lk);
+	if (lk.readers != 2 || lk.writer)
+		panic("test_share_rwsleeplock #1: 2 readers are expected to hold it (readers = %d, writer = %d)", lk.readers, lk.writer);
+	release_read_rwsleeplock(&lk);
+	release_read_rwsleeplock(&lk);
+	acquire_write_rwsleeplock(&lk);
+	if (!lk.writer || lk.readers != 0)
+		panic("test_share_rwsleeplock #1: a writer is expected to hold it alone (readers = %d)", lk.readers);
+
+	//[2] a writer & 2 readers are blocked behind the holding writer: its release wakes up the
+	//waiting writer only, & the release of that one wakes up both readers
+	struct Env* writer = env_create("fos_helloWorld", 20, 10, 0);
+	struct Env* reader1 = env_create("fos_helloWorld", 20, 10, 0);
+	struct Env* reader2 = env_create("fos_helloWorld", 20, 10, 0);
+	if (writer == NULL || reader1 == NULL || reader2 == NULL)
+		panic("test_share_rwsleeplock: failed to create the envs");
+	lk.waitingWriters++;
+	block_on_channel(writer, &lk.writersChan);
+	block_on_channel(reader1, &lk.readersChan);
+	block_on_channel(reader2, &lk.readersChan);
+	release_write_rwsleeplock(&lk);
+	if (writer->env_status != ENV_READY || reader1->env_status != ENV_BLOCKED || reader2->env_status != ENV_BLOCKED)
+		panic("test_share_rwsleeplock #2: only the waiting writer is expected to be woken up");
+	//the woken writer takes it, as its acquire_write_rwsleeplock() does once it runs
+	lk.waitingWriters--;
+	lk.writer = 1;
+	release_write_rwsleeplock(&lk);
+	if (reader1->env_status != ENV_READY || reader2->env_status != ENV_READY)
+		panic("test_share_rwsleeplock #2: both readers are expected to be woken up");
+
+	//[3] the share lock is written to populate a frame (on its first touch), & read to map a
+	//populated one (by the getter & the faults of the other envs)
+	char shareName[] = "rwShare";
+	uint32 ownerVA = USER_HEAP_START;
+	uint32 otherVA = USER_HEAP_START + 2*PAGE_SIZE;
+	struct Env* owner = reader1;
+	struct Env* other = reader2;
+	set_cpu_proc(owner);
+	lcr3(owner->env_cr3);
+	if (createSharedObject(owner->env_id, shareName, 2*PAGE_SIZE, 1, (void*)ownerVA) < 0)
+		panic("test_share_rwsleeplock: failed to create the share");
+	struct Share* share = get_share(owner->env_id, shareName);
+	uint32 reads = share->lock.readAcquisitions, writes = share->lock.writeAcquisitions;
+	share_fault_handler(owner, ownerVA);
+	set_cpu_proc(other);
+	lcr3(other->env_cr3);
+	if (getSharedObject(owner->env_id, shareName, (void*)otherVA) < 0)
+		panic("test_share_rwsleeplock: failed to get the share");
+	set_cpu_proc(owner);
+	lcr3(owner->env_cr3);
+	share_fault_handler(owner, ownerVA + PAGE_SIZE);
+	set_cpu_proc(other);
+	lcr3(other->env_cr3);
+	share_fault_handler(other, otherVA + PAGE_SIZE);
+
+	//2 first touches (a read that misses, then a write each), the getter & the fault on a populated frame
+	if (share->lock.writeAcquisitions - writes != 2 || share->lock.readAcquisitions - reads != 4)
+		panic("test_share_rwsleeplock #3: expected 2 writes & 4 reads of the share lock, actual %d writes & %d reads",
+				share->lock.writeAcquisitions - writes, share->lock.readAcquisitions - reads);
+	if (share->lock.readers != 0 || share->lock.writer)
+		panic("test_share_rwsleeplock #3: the share lock is still held");
+	for (int i = 0; i < 2; i++)
+	{
+		uint32 pa = env_physical_address(other, otherVA + i*PAGE_SIZE);
+		if (pa == 0 || pa != env_physical_address(owner, ownerVA + i*PAGE_SIZE))
+			panic("test_share_rwsleeplock #3: page #%d of the share is not mapped to the same frame in both envs", i);
+	}
+
+	set_cpu_proc(NULL);
+	lcr3(phys_page_directory);
+	sched_kill_env(writer->env_id);
+	sched_kill_env(reader1->env_id);
+	sched_kill_env(reader2->env_id);
+	cprintf("Congratulations!! test readers & writers of the share lock completed successfully.\n");
+	return 0;
+}
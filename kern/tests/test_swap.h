@@ -0,0 +1,22 @@
+/*
+ * test_swap.h
+ *
+ * Tests of the swap tiers in front of the page file.
+ */
+
+#ifndef KERN_TESTS_TEST_SWAP_H_
+#define KERN_TESTS_TEST_SWAP_H_
+#ifndef FOS_KERNEL
+# error "This is a FOS kernel header; user programs should not #include it"
+#endif
+#include <inc/types.h>
+
+int test_lz_compression();
+int test_zswap_pool();
+int test_io_queue();
+int test_io_elevator();
+int test_block_device();
+int test_share_futex_eviction();
+int test_share_rwsleeplock();
+
+#endif /* KERN_TESTS_TEST_SWAP_H_ */
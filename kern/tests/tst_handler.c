@@ -19,6 +19,7 @@
 #include "../tests/test_commands.h"
 #include "../tests/test_dynamic_allocator.h"
 #include "../tests/test_scheduler.h"
+#include "../tests/test_swap.h"
 
 struct Test tests[] = {
 		{"3functions", "Env Load: test the creation of new dir, tables and pages WS", tst_three_creation_functions},
@@ -38,6 +39,8 @@ struct Test tests[] = {
 		{"pg", "Test paging manipulation for a specific page", tst_paging_manipulation},
 		{"chunks","Test chunk manipulations", tst_chunks },
 		{"kheap", "Test KHEAP functions", tst_kheap},
+		{"swap", "Test the swap tiers in front of the page file", tst_swap},
+		{"sched", "Test the scheduler queues (ready bitmap, aging...)", tst_sched},
 
 };
 
@@ -490,6 +493,101 @@ int tst_kheap(int number_of_arguments, char **arguments)
 	return 0;
 }
 
+int tst_swap(int number_of_arguments, char **arguments)
+{
+	if (number_of_arguments != 2)
+	{
+		cprintf("Invalid number of arguments! USAGE: tst swap <testname>\n") ;
+		return 0;
+	}
+	// LZ compressor of the compressed swap: tst swap lz
+	if(strcmp(arguments[1], "lz") == 0)
+	{
+		test_lz_compression();
+	}
+	// Compressed swap pool (store, load & write back): tst swap zswap
+	else if(strcmp(arguments[1], "zswap") == 0)
+	{
+		test_zswap_pool();
+	}
+	// Disk request queue (write & read back through the elevator): tst swap ioq
+	else if(strcmp(arguments[1], "ioq") == 0)
+	{
+		test_io_queue();
+	}
+	// C-LOOK order & merging of the disk request queue: tst swap elevator
+	else if(strcmp(arguments[1], "elevator") == 0)
+	{
+		test_io_elevator();
+	}
+	// Block devices of the page file (read, write, submit & flush) on both backends: tst swap blk
+	else if(strcmp(arguments[1], "blk") == 0)
+	{
+		test_block_device();
+	}
+	// Futex waiters on a share while its frames are evicted: tst swap futex
+	else if(strcmp(arguments[1], "futex") == 0)
+	{
+		test_share_futex_eviction();
+	}
+	// Readers & writers of the share lock (writer preference, populate vs. map): tst swap rwlock
+	else if(strcmp(arguments[1], "rwlock") == 0)
+	{
+		test_share_rwsleeplock();
+	}
+	return 0;
+}
+
+int tst_sched(int number_of_arguments, char **arguments)
+{
+	if (number_of_arguments != 2)
+	{
+		cprintf("Invalid number of arguments! USAGE: tst sched <testname>\n") ;
+		return 0;
+	}
+	// Ready queues bitmap & batch aging of the priority RR: tst sched prirr
+	if(strcmp(arguments[1], "prirr") == 0)
+	{
+		test_prirr_ready_bitmap();
+	}
+	// Demotion, blocking & boost of the MLFQ: tst sched mlfq
+	else if(strcmp(arguments[1], "mlfq") == 0)
+	{
+		test_mlfq_levels();
+	}
+	// Priorities, levels & load average of the BSD: tst sched bsd
+	else if(strcmp(arguments[1], "bsd") == 0)
+	{
+		test_bsd_priorities();
+	}
+	// Admission, deadline order & misses of the real-time class: tst sched edf
+	else if(strcmp(arguments[1], "edf") == 0)
+	{
+		test_edf_admission();
+	}
+	// Min-heap by pass & shares by tickets of the stride scheduler: tst sched stride
+	else if(strcmp(arguments[1], "stride") == 0)
+	{
+		test_stride_heap();
+	}
+	// Ready/running/blocked times, wake-to-run latencies & switches of the scheduler stats: tst sched stats
+	else if(strcmp(arguments[1], "stats") == 0)
+	{
+		test_sched_stats();
+	}
+	// Steals across the CPUs of a multi-env job (run twice: load & run, then check): tst sched smp
+	else if(strcmp(arguments[1], "smp") == 0)
+	{
+		test_smp_steals();
+	}
+	// Cascades & expiries of the timer wheel at the boundaries of its levels: tst sched wheel
+	else if(strcmp(arguments[1], "wheel") == 0)
+	{
+		test_timer_wheel();
+	}
+	return 0;
+}
+
 
 //END======================================================
 
@@ -50,6 +50,8 @@ int tst_dyn_alloc(int number_of_arguments, char **arguments);
 int tst_paging_manipulation(int number_of_arguments, char **arguments);
 int tst_chunks(int number_of_arguments, char **arguments);
 int tst_kheap(int number_of_arguments, char **arguments);
+int tst_swap(int number_of_arguments, char **arguments);
+int tst_sched(int number_of_arguments, char **arguments);
 
 
 
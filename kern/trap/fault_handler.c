@@ -11,6 +11,7 @@
 #include <kern/cpu/cpu.h>
 #include <kern/disk/pagefile_manager.h>
 #include <kern/mem/memory_manager.h>
+#include <kern/mem/shared_memory_manager.h>
 #define PTR_TAKEN 0x400 // if set then it's the first pointer
 
 //2014 Test Free(): Set it to bypass the PAGE FAULT on an instruction with this length and continue executing the next one
@@ -59,14 +60,6 @@ uint32 getModifiedBufferLength() { return _ModifiedBufferLength;}
 //==================
 // [1] MAIN HANDLER:
 //==================
-/*2022*/
-uint32 last_eip = 0;
-uint32 before_last_eip = 0;
-uint32 last_fault_va = 0;
-uint32 before_last_fault_va = 0;
-int8 num_repeated_fault  = 0;
-
-struct Env* last_faulted_env = NULL;
 void fault_handler(struct Trapframe *tf)
 {
 	/******************************************************/
@@ -78,25 +71,27 @@ void fault_handler(struct Trapframe *tf)
 
 	//If same fault va for 3 times, then panic
 	//UPDATE: 3 FAULTS MUST come from the same environment (or the kernel)
+	//They are tracked per CPU, as the CPUs fault concurrently (and an env runs on one CPU at a time)
 	struct Env* cur_env = get_cpu_proc();
-	if (last_fault_va == fault_va && last_faulted_env == cur_env)
+	struct cpu* c = mycpu();
+	if (c->lastFaultVA == fault_va && c->lastFaultedEnv == cur_env)
 	{
-		num_repeated_fault++ ;
-		if (num_repeated_fault == 3)
+		c->numRepeatedFaults++ ;
+		if (c->numRepeatedFaults == 3)
 		{
 			print_trapframe(tf);
-			panic("Failed to handle fault! fault @ at va = %x from eip = %x causes va (%x) to be faulted for 3 successive times\n", before_last_fault_va, before_last_eip, fault_va);
+			panic("Failed to handle fault! fault @ at va = %x from eip = %x causes va (%x) to be faulted for 3 successive times\n", c->beforeLastFaultVA, c->beforeLastFaultEIP, fault_va);
 		}
 	}
 	else
 	{
-		before_last_fault_va = last_fault_va;
-		before_last_eip = last_eip;
-		num_repeated_fault = 0;
+		c->beforeLastFaultVA = c->lastFaultVA;
+		c->beforeLastFaultEIP = c->lastFaultEIP;
+		c->numRepeatedFaults = 0;
 	}
-	last_eip = (uint32)tf->tf_eip;
-	last_fault_va = fault_va ;
-	last_faulted_env = cur_env;
+	c->lastFaultEIP = (uint32)tf->tf_eip;
+	c->lastFaultVA = fault_va ;
+	c->lastFaultedEnv = cur_env;
 	/******************************************************/
 	//2017: Check stack overflow for Kernel
 	int userTrap = 0;
@@ -105,7 +100,6 @@ void fault_handler(struct Trapframe *tf)
 	}
 	if (!userTrap)
 	{
-		struct cpu* c = mycpu();
 		//cprintf("trap from KERNEL\n");
 		if (cur_env && fault_va >= (uint32)cur_env->kstack && fault_va < (uint32)cur_env->kstack + PAGE_SIZE)
 			panic("User Kernel Stack: overflow exception!");
@@ -172,11 +166,22 @@ void fault_handler(struct Trapframe *tf)
 		// we have normal page fault =============================================================
 		faulted_env->pageFaultsCounter ++ ;
 
+#if USE_KHEAP
+		// the free frames are scarce: evict the idle frames of the shares first (written once for all
+		// the envs mapping them), before any frame is allocated for this fault
+		if (userTrap && LIST_SIZE(&MemFrameLists.free_frame_list) < SHARE_RECLAIM_THRESHOLD)
+			share_reclaim(SHARE_RECLAIM_BATCH);
+#endif
+
 		//		cprintf("[%08s] user PAGE fault va %08x\n", curenv->prog_name, fault_va);
 		//		cprintf("\nPage working set BEFORE fault handler...\n");
 		//		env_page_ws_print(curenv);
 
-		if(isBufferingEnabled())
+		// a page of a shared object is mapped to the frame of the share (allocated on its first touch)
+		if(fault_va >= USER_HEAP_START && fault_va < USER_HEAP_MAX && share_fault_handler(faulted_env, fault_va))
+		{
+		}
+		else if(isBufferingEnabled())
 		{
 			__page_fault_handler_with_buffering(faulted_env, fault_va);
 		}
@@ -232,17 +237,15 @@ void page_fault_handler(struct Env * faulted_env, uint32 fault_va)
 	{
 		//cprintf("PLACEMENT=========================WS Size = %d\n", wsSize );
 		// Placement
-		// Allocate space for the faulted page
-		int x= pf_read_env_page(faulted_env, (void*) fault_va);
-		if(x == E_PAGE_NOT_EXIST_IN_PF)
+		// Re-use the frame that still holds the page (swap cache), if any
+		struct FrameInfo *frame_info = pf_swap_cache_lookup(faulted_env, fault_va);
+		if (frame_info != NULL)
 		{
-			if(!((fault_va >= USTACKBOTTOM && fault_va < USTACKTOP) || (fault_va >= USER_HEAP_START &&fault_va < USER_HEAP_MAX)))
-			{
-				env_exit();
-				return;
-			}
+			map_frame(faulted_env->env_page_directory, frame_info, fault_va, PERM_WRITEABLE | PERM_USER);
 		}
-			struct FrameInfo *frame_info;
+		else
+		{
+			// Allocate space for the faulted page
 			int ret = allocate_frame(&frame_info);
 
 			if (ret==E_NO_MEM)
@@ -252,7 +255,19 @@ void page_fault_handler(struct Env * faulted_env, uint32 fault_va)
 			}
 
 			map_frame(faulted_env->env_page_directory, frame_info, fault_va, PERM_WRITEABLE | PERM_USER);
-		
+
+			int x= pf_read_env_page(faulted_env, (void*) fault_va);
+			if(x == E_PAGE_NOT_EXIST_IN_PF)
+			{
+				if(!((fault_va >= USTACKBOTTOM && fault_va < USTACKTOP) || (fault_va >= USER_HEAP_START &&fault_va < USER_HEAP_MAX)))
+				{
+					unmap_frame(faulted_env->env_page_directory, fault_va);
+					env_exit();
+					return;
+				}
+			}
+		}
+
 
 #if USE_KHEAP
 			struct WorkingSetElement *new_element = env_page_ws_list_create_element(faulted_env,fault_va);
@@ -310,12 +325,17 @@ void page_fault_handler(struct Env * faulted_env, uint32 fault_va)
 		
 		if ((perms & PERM_MODIFIED) )
 			pf_update_env_page(faulted_env, victim->virtual_address, victim_frame);
-		
+
+		//the victim frame now matches its page file slot: keep it cached instead of discarding it
+		pf_swap_cache_insert(faulted_env, victim->virtual_address, victim_frame);
+
 		faulted_env->page_last_WS_element = (LIST_NEXT(victim)) ? LIST_NEXT(victim) : LIST_FIRST(&(faulted_env->page_WS_list)); //I dont think we can replace the stack page
 
 
-		struct FrameInfo* p;
-		allocate_frame(&p);
+		struct FrameInfo* p = pf_swap_cache_lookup(faulted_env, fault_va);
+		uint8 cached = (p != NULL);
+		if (!cached)
+			allocate_frame(&p);
 
 		struct WorkingSetElement * new= env_page_ws_list_create_element(faulted_env, fault_va);
 		if(LIST_PREV(victim))
@@ -330,7 +350,8 @@ void page_fault_handler(struct Env * faulted_env, uint32 fault_va)
 			LIST_INSERT_HEAD(&(faulted_env->page_WS_list),new);
 		}
 		map_frame(faulted_env->env_page_directory, p, fault_va, PERM_WRITEABLE | PERM_USER);
-		pf_read_env_page(faulted_env,(void *)fault_va);
+		if (!cached)
+			pf_read_env_page(faulted_env,(void *)fault_va);
 	}
 }
 
@@ -11,8 +11,12 @@
 #include "syscall.h"
 #include <kern/cons/console.h>
 #include <kern/conc/channel.h>
+#include <kern/conc/futex.h>
 #include <kern/cpu/sched.h>
 #include <kern/cpu/cpu.h>
+#include <kern/cpu/timer_wheel.h>
+#include <kern/cpu/sched_edf.h>
+#include <kern/cpu/sched_stats.h>
 #include <kern/disk/pagefile_manager.h>
 #include <kern/mem/memory_manager.h>
 #include <kern/mem/shared_memory_manager.h>
@@ -365,26 +369,8 @@ bool sys_is_user_page_first(volatile uint32 * env_page_directory, uint32 va)
 
 uint32 sys_user_get_free_pages(volatile uint32 * env_page_directory,uint32 noOfPages)
 {
-	uint32 firstPointer;
-	if (_UHeapPlacementStrategy == UHP_PLACE_FIRSTFIT)
-	{
-		uint32 c = 0;
-		for (uint32 va = (uint32)cur_env->rlimit + PAGE_SIZE; va < USER_HEAP_MAX; va += PAGE_SIZE) //searching for enough space with FF
-		{
-			if (sys_is_user_page_taken(env_page_directory,va)) // if its taken or not
-			{
-				c = 0;	  // reset the counter
-				continue; // if its taken , continue
-			}
-			c++; // to count the number of back-to-back free pages found
-			if (c == 1)
-				firstPointer = va; // save the address of the first page
-
-			if (c == noOfPages)
-				return firstPointer; // if we got the number we need , no need for more search
-		}
-	}
-	return 0;
+	//the directory is always the one of the curenv
+	return find_free_user_pages(cur_env, noOfPages);
 }
 
 
@@ -434,6 +420,13 @@ int sys_freeSharedObject(int32 sharedObjectID, void *startVA)
 	return freeSharedObject(sharedObjectID, startVA);
 }
 
+void* sys_attach_shared(int32 ownerID, char* shareName, uint32* size)
+{
+	if (size != NULL && (uint32)size >= USER_LIMIT)
+		return NULL;
+	return attachSharedObject(ownerID, shareName, size);
+}
+
 /*********************************/
 /* USER ENVIRONMENT SYSTEM CALLS */
 /*********************************/
@@ -515,6 +508,11 @@ int sys_create_env(char* programName, unsigned int page_WS_size,unsigned int LRU
 	}
 	//cprintf("\nENV %d is created\n", env->env_id);
 
+	//the child inherits the CPU share (stride tickets) of its parent
+	struct Env* cur_env = get_cpu_proc();
+	if (cur_env != NULL)
+		env_set_tickets(env, env_get_tickets(cur_env));
+
 	//2015
 	sched_new_env(env);
 
@@ -550,35 +548,32 @@ void sys_bypassPageFault(uint8 instrLength)
 	bypassInstrLength = instrLength;
 }
 
-void sys_enqueue(struct Env_Queue* queue, struct Env* env)
-{
-	enqueue(queue,env);
-	env->env_status = ENV_BLOCKED; 
-	acquire_spinlock(&ProcessQueues.qlock);
-	sched();
-	release_spinlock(&ProcessQueues.qlock);
-}
-
-struct Env* sys_dequeue(struct Env_Queue* queue)
-{
-	return dequeue(queue);
-}
-
-void sys_init_queue(struct Env_Queue* queue)
-{
-	init_queue(queue);
-}
-
-struct Env* sys_get_cpu_proc()
+//Copy the scheduler counters of all the CPUs and/or those of the given env (0 = the current one).
+//They're snapshot under the qlock, then copied out without it (the user pages may fault & sleep)
+int sys_get_sched_stats(int32 envId, struct SchedStats* stats, struct EnvSchedStats* envStats)
 {
-	return get_cpu_proc();
-}
+	if ((stats != NULL && (uint32)stats > USER_LIMIT - sizeof(struct SchedStats)) ||
+		(envStats != NULL && (uint32)envStats > USER_LIMIT - sizeof(struct EnvSchedStats)))
+		return E_INVAL;
+	struct Env* e = NULL;
+	if (envStats != NULL && (envid2env(envId, &e, 0) < 0 || e == NULL))
+		return E_BAD_ENV;
 
-void sys_sched_insert_ready(struct Env* env)
-{
+	struct SchedStats globalStats;
+	struct EnvSchedStats localStats;
 	acquire_spinlock(&ProcessQueues.qlock);
-	sched_insert_ready(env);
+	{
+		globalStats = GlobalSchedStats;
+		if (envStats != NULL)
+			localStats = e->schedStats;
+	}
 	release_spinlock(&ProcessQueues.qlock);
+
+	if (stats != NULL)
+		*stats = globalStats;
+	if (envStats != NULL)
+		*envStats = localStats;
+	return 0;
 }
 /**************************************************************************/
 /************************* SYSTEM CALLS HANDLER ***************************/
@@ -678,6 +673,10 @@ uint32 syscall(uint32 syscallno, uint32 a1, uint32 a2, uint32 a3, uint32 a4, uin
 		return sys_getSizeOfSharedObject((int32)a1, (char*)a2);
 		break;
 
+	case SYS_attach_shared:
+		return (uint32)sys_attach_shared((int32)a1, (char*)a2, (uint32*)a3);
+		break;
+
 	case SYS_create_env:
 		return sys_create_env((char*)a1, (uint32)a2, (uint32)a3, (uint32)a4);
 		break;
@@ -779,27 +778,32 @@ uint32 syscall(uint32 syscallno, uint32 a1, uint32 a2, uint32 a3, uint32 a4, uin
 	case SYS_user_get_free_pages:
 		return sys_user_get_free_pages((volatile uint32 *)a1,a2);
 
-	case SYS_enqueue:
-		sys_enqueue((struct Env_Queue* )a1, (struct Env*) a2);
-		return 0; 
-
-	case SYS_dequeue:
-		return (uint32) sys_dequeue((struct Env_Queue*) a1);
+	case SYS_env_set_priority:
+		env_set_priority(a1,a2);
+		return 0;
 
-	case SYS_init_queue:
-		sys_init_queue((struct Env_Queue*) a1);
+	case SYS_sleep:
+		timer_wheel_sleep(a1);
 		return 0;
 
-	case SYS_get_current_proc:
-		return (uint32) sys_get_cpu_proc();
+	case SYS_rt_set_params:
+		return sched_rt_set_params(cur_env, a1, a2);
 
-	case SYS_insert_ready:
-		sys_sched_insert_ready((struct Env*) a1);
+	case SYS_rt_wait_period:
+		sched_rt_wait_period();
 		return 0;
 
-	case SYS_env_set_priority:
-		env_set_priority(a1,a2);
-		return 0;
+	case SYS_get_sched_stats:
+		return sys_get_sched_stats((int32)a1, (struct SchedStats*)a2, (struct EnvSchedStats*)a3);
+
+	case SYS_futex_wait:
+		return futex_wait((volatile uint32*)a1, a2);
+
+	case SYS_futex_wake:
+		return futex_wake((volatile uint32*)a1, (int)a2, (uint8)a3);
+
+	case SYS_ring_doorbell:
+		return futex_doorbell((volatile uint32*)a1, (int)a2);
 
 
 
@@ -13,6 +13,8 @@
 #include <kern/cpu/sched.h>
 #include <kern/cpu/cpu.h>
 #include <kern/cpu/picirq.h>
+#include <kern/cpu/lapic.h>
+#include <kern/cpu/mp.h>
 #include <kern/disk/pagefile_manager.h>
 #include <kern/mem/memory_manager.h>
 
@@ -60,6 +62,10 @@ extern  void (*ALL_FAULTS45)();
 extern  void (*ALL_FAULTS46)();
 extern  void (*ALL_FAULTS47)();
 
+extern  void (*IPI_TLB_HANDLER)();
+extern  void (*IPI_RESCHED_HANDLER)();
+extern  void (*LAPIC_SPURIOUS_HANDLER)();
+
 
 
 static const char *trapname(int trapno)
@@ -95,6 +101,10 @@ static const char *trapname(int trapno)
 		return "Clock Interrupt";
 	else if (trapno == IRQ1_KB)
 		return "Keyboard Interrupt";
+	else if (trapno == T_IPI_TLB)
+		return "TLB Shootdown IPI";
+	else if (trapno == T_IPI_RESCHED)
+		return "Reschedule IPI";
 	return "(unknown trap)";
 }
 
@@ -175,6 +185,11 @@ void idt_init(void)
 	SETGATE(idt[46], 0, GD_KT , &ALL_FAULTS46, 3) ;
 	SETGATE(idt[47], 0, GD_KT , &ALL_FAULTS47, 3) ;
 
+	//Inter-processor interrupts (sent by the kernel only)
+	SETGATE(idt[T_IPI_TLB       ], 0, GD_KT , &IPI_TLB_HANDLER, 0) ;
+	SETGATE(idt[T_IPI_RESCHED   ], 0, GD_KT , &IPI_RESCHED_HANDLER, 0) ;
+	SETGATE(idt[T_LAPIC_SPURIOUS], 0, GD_KT , &LAPIC_SPURIOUS_HANDLER, 0) ;
+
 	// Load the IDT
 	//asm volatile("lidt idt_pd");
 	lidt(idt, sizeof(idt));
@@ -223,6 +238,18 @@ void irq_dispatch(struct Trapframe *tf)
 	void (*handler)(struct Trapframe *tf);
 	int IRQNum = tf->tf_trapno - IRQ_OFFSET;
 	handler = irq_handlers[IRQNum] ;
+
+	//The APs only receive the interrupts of their local APIC timers (on IRQ0_Clock).
+	//Unlike the PIC (in auto EOI mode), the local APIC blocks this vector till its EOI,
+	//so it's sent before the handler which may switch to another env
+	if (mycpu() != &CPUS[0])
+	{
+		lapic_eoi();
+		if (handler)
+			handler(tf);
+		return;
+	}
+
 	if (handler)
 	{
 		handler(tf);
@@ -285,6 +312,22 @@ static void trap_dispatch(struct Trapframe *tf)
 		}
 		//cprintf("ret val form syscall = %d\n", ret);
 	}
+	else if (tf->tf_trapno == T_IPI_TLB)
+	{
+		tlb_shootdown_poll();
+		lapic_eoi();
+	}
+	else if (tf->tf_trapno == T_IPI_RESCHED)
+	{
+		//It wakes up the idle scheduler of this CPU to check its ready queues, or cuts the stretched
+		//clock of its running env as an env has got ready on this CPU
+		kclock_unstretch();
+		lapic_eoi();
+	}
+	else if (tf->tf_trapno == T_LAPIC_SPURIOUS)
+	{
+		//Spurious interrupts need no EOI
+	}
 	else if(tf->tf_trapno == T_DBLFLT)
 	{
 		panic("double fault!!");
@@ -353,6 +396,13 @@ void trap(struct Trapframe *tf)
 	//cprintf("will be returned to the trapret() \n");
 	/*2024: will be returned to the trapret() in trapentry.S which return to the caller*/
 
+	//An env killed while it's running on this CPU (by another one) exits instead of returning to
+	//the user mode. It's done here, as it holds no locks on its way back (see sched_kill_env())
+	if (userTrap && cur_env->killed)
+	{
+		env_exit();
+	}
+
 	//[4] Make sure that the interrupt is disabled before executing the trapret()
 	uint32 IEN = read_eflags() & FL_IF;
 	assert(IEN == 0);
@@ -17,6 +17,9 @@
 
 static int diskno = 0;
 
+//command block base port of each IDE channel (disk i is the master of channel i)
+static const uint16 ide_port[IDE_MAX_DISKS] = { 0x1F0, 0x170 };
+
 void disk_interrupt_handler(struct Trapframe *tf)
 {
 	int r;
@@ -80,23 +83,43 @@ void ide_init()
 //	return 0;
 //}
 
-static int ide_wait_ready(bool check_error)
+static int ide_wait_ready_on(int disk, bool check_error)
 {
 	int r;
 
-	while (((r = inb(0x1F7)) & (IDE_BSY|IDE_DRDY)) != IDE_DRDY)
+	while (((r = inb(ide_port[disk] + 7)) & (IDE_BSY|IDE_DRDY)) != IDE_DRDY)
 	/* do nothing */;
 
 
 	if (check_error && (r & (IDE_DF|IDE_ERR)) != 0)
 	{
-		panic("ERROR @ ide_wait_ready() = %x(%d)\n",r,r);
+		panic("ERROR @ ide_wait_ready() = %x(%d) on disk %d\n",r,r,disk);
 		LOG_STATMENT(cprintf("ERROR @ ide_wait_ready() = %x(%d)\n",r,r););
 		return -1;
 	}
 	return 0;
 }
 
+static int ide_wait_ready(bool check_error)
+{
+	return ide_wait_ready_on(0, check_error);
+}
+
+//Return whether a disk is attached as the master of the given channel
+bool ide_probe_disk(int disk)
+{
+	uint16 port = ide_port[disk];
+	int r, x;
+
+	//an absent controller leaves the bus floating (reads as 0xFF)
+	if (inb(port + 7) == 0xFF)
+		return 0;
+	outb(port + 6, 0xE0 | ((diskno&1)<<4));
+	for (x = 0; x < 1000 && ((r = inb(port + 7)) & (IDE_BSY|IDE_DRDY|IDE_DF|IDE_ERR)) != IDE_DRDY; x++)
+		/* do nothing */;
+	return (x < 1000);
+}
+
 int	ide_read(uint32 secno, void *dst, uint32 nsecs)
 {
 	int r;
@@ -159,3 +182,54 @@ int ide_write(uint32 secno, const void *src, uint32 nsecs)
 	return 0;
 }
 
+//Issue a read (write = 0) or write (write = 1) command of nsecs sectors starting at secno on the given disk.
+//The sectors are then transferred one by one (possibly from/to different buffers)
+//using ide_read_sector()/ide_write_sector(). Each disk is on its own channel, so
+//commands on different disks can be in flight at the same time
+int ide_start(int disk, uint32 secno, uint32 nsecs, bool write)
+{
+	assert(disk >= 0 && disk < IDE_MAX_DISKS);
+	assert(nsecs > 0 && nsecs <= 256);
+	uint16 port = ide_port[disk];
+
+	ide_wait_ready_on(disk, 0);
+
+	outb(port + 2, nsecs == 256 ? 0 : nsecs);
+	outb(port + 3, secno & 0xFF);
+	outb(port + 4, (secno >> 8) & 0xFF);
+	outb(port + 5, (secno >> 16) & 0xFF);
+	outb(port + 6, 0xE0 | ((diskno&1)<<4) | ((secno>>24)&0x0F));
+	outb(port + 7, write ? 0x30 : 0x20);
+
+	return 0;
+}
+
+int ide_read_sector(int disk, void *dst)
+{
+	int r;
+	if ((r = ide_wait_ready_on(disk, 1)) < 0)
+		return r;
+	insl(ide_port[disk], dst, SECTSIZE/4);
+	return 0;
+}
+
+int ide_write_sector(int disk, const void *src)
+{
+	int r;
+	if ((r = ide_wait_ready_on(disk, 1)) < 0)
+		return r;
+	outsl(ide_port[disk], src, SECTSIZE/4);
+	return 0;
+}
+
+//Make the completed writes of the given disk durable (FLUSH CACHE)
+int ide_flush(int disk)
+{
+	assert(disk >= 0 && disk < IDE_MAX_DISKS);
+	uint16 port = ide_port[disk];
+
+	ide_wait_ready_on(disk, 0);
+	outb(port + 6, 0xE0 | ((diskno&1)<<4));
+	outb(port + 7, 0xE7);
+	return ide_wait_ready_on(disk, 1);
+}
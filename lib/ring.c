@@ -0,0 +1,214 @@
+// User-level ring buffers (message queues) over shared memory
+
+#include "inc/lib.h"
+
+//Compiler barrier: x86 keeps the stores (& the loads) in their order, so it's enough to publish a
+//slot after its message is written, & to read the message after its slot is seen published
+#define ring_barrier() __asm __volatile("" : : : "memory")
+
+static inline uint8* ring_slot(struct __ringdata* r, uint32 pos)
+{
+	return r->slots + (pos & (r->numOfSlots - 1)) * r->slotSize;
+}
+
+//Sequence # of the given MPMC slot: pos + 1 once its message is written, pos + numOfSlots once it's read
+static inline volatile uint32* ring_seq(uint8* slot)
+{
+	return (volatile uint32*)slot;
+}
+
+//Copy a message word by word (the slots are word aligned), instead of the byte loop of memcpy()
+static inline void ring_copy(void* dst, const void* src, uint32 size)
+{
+	if ((((uint32)dst | (uint32)src | size) & (sizeof(uint32) - 1)) == 0)
+	{
+		uint32* d = dst;
+		const uint32* s = src;
+		for (size /= sizeof(uint32); size > 0; size--)
+			*d++ = *s++;
+	}
+	else
+		memcpy(dst, src, size);
+}
+
+static int ring_empty(struct __ringdata* r)
+{
+	uint32 head = r->head;
+	if (r->kind == RING_SPSC)
+		return r->tail == head;
+	return (int32)(*ring_seq(ring_slot(r, head)) - (head + 1)) < 0;
+}
+
+static int ring_full(struct __ringdata* r)
+{
+	uint32 tail = r->tail;
+	if (r->kind == RING_SPSC)
+		return tail - r->head == r->numOfSlots;
+	return (int32)(*ring_seq(ring_slot(r, tail)) - tail) < 0;
+}
+
+//Block on the given doorbell, unless the ring is no longer blocked once the sleeper is announced
+//(xadd is a full barrier: the other side either sees the sleeper or its change is seen here)
+static void ring_wait(struct __ringdata* r, struct __ringbell* b, int (*blocked)(struct __ringdata*))
+{
+	uint32 bell = b->bell;
+	xadd(&(b->sleepers), 1);
+	if (blocked(r))
+		sys_futex_wait(&(b->bell), bell);
+	xadd(&(b->sleepers), (uint32)-1);
+}
+
+static void ring_doorbell(struct __ringbell* b)
+{
+	//E_INVAL: its page is not in the memory (evicted meanwhile): touch it & ring again
+	while (sys_ring_doorbell(&(b->bell), 1) == E_INVAL)
+		(void)b->bell;
+}
+
+struct ring create_ring(char *ringName, uint32 numOfSlots, uint32 msgSize, uint8 kind)
+{
+	struct ring r = { .ringdata = NULL };
+	if (numOfSlots == 0 || (numOfSlots & (numOfSlots - 1)) != 0 || msgSize == 0 || kind > RING_MPMC)
+		return r;
+
+	uint32 slotSize = ROUNDUP(msgSize + (kind == RING_MPMC ? sizeof(uint32) : 0), sizeof(uint32));
+	struct __ringdata *ringdata = smalloc(ringName, sizeof(struct __ringdata) + numOfSlots * slotSize, 1);
+	if (ringdata == NULL)
+		return r;
+	ringdata->numOfSlots = numOfSlots;
+	ringdata->msgSize = msgSize;
+	ringdata->slotSize = slotSize;
+	ringdata->kind = kind;
+	strcpy(ringdata->name, ringName);
+	ringdata->tail = ringdata->head = 0;
+	ringdata->notEmpty.bell = ringdata->notEmpty.sleepers = 0;
+	ringdata->notFull.bell = ringdata->notFull.sleepers = 0;
+	if (kind == RING_MPMC)
+	{
+		for (uint32 i = 0; i < numOfSlots; i++)
+			*ring_seq(ring_slot(ringdata, i)) = i;
+	}
+	r.ringdata = ringdata;
+	return r;
+}
+
+struct ring get_ring(int32 ownerEnvID, char* ringName)
+{
+	return (struct ring){
+		.ringdata = sget(ownerEnvID, ringName),
+	};
+}
+
+//Append the given message to the ring without blocking. Returns 0 if it's full.
+//SPSC: the consumer is woken up only if this message makes the ring non-empty. MPMC: a producer
+//can't tell whether the slots ahead of its own are read, so it rings whenever a consumer sleeps
+int ring_try_push(struct ring ring, const void* msg)
+{
+	struct __ringdata* r = ring.ringdata;
+	if (r->kind == RING_SPSC)
+	{
+		uint32 tail = r->tail;
+		if (tail - r->head == r->numOfSlots)
+			return 0;
+		ring_copy(ring_slot(r, tail), msg, r->msgSize);
+		ring_barrier();
+		r->tail = tail + 1;
+		__sync_synchronize();
+		//a sleeping consumer doesn't move the head: it's still at this message
+		if (r->notEmpty.sleepers > 0 && r->head == tail)
+			ring_doorbell(&(r->notEmpty));
+		return 1;
+	}
+
+	uint8* slot;
+	uint32 pos = r->tail;
+	for (;;)
+	{
+		slot = ring_slot(r, pos);
+		int32 dif = (int32)(*ring_seq(slot) - pos);
+		if (dif == 0)
+		{
+			if (cmpxchg(&(r->tail), pos, pos + 1) == pos)
+				break;
+			pos = r->tail;
+		}
+		else if (dif < 0)
+			return 0;
+		else
+			pos = r->tail;
+	}
+	ring_copy(slot + sizeof(uint32), msg, r->msgSize);
+	ring_barrier();
+	*ring_seq(slot) = pos + 1;
+	__sync_synchronize();
+	if (r->notEmpty.sleepers > 0)
+		ring_doorbell(&(r->notEmpty));
+	return 1;
+}
+
+//Take the oldest message of the ring into msg without blocking. Returns 0 if it's empty.
+//The producers are woken up the same way (once it's no longer full)
+int ring_try_pop(struct ring ring, void* msg)
+{
+	struct __ringdata* r = ring.ringdata;
+	if (r->kind == RING_SPSC)
+	{
+		uint32 head = r->head;
+		if (r->tail == head)
+			return 0;
+		ring_barrier();
+		ring_copy(msg, ring_slot(r, head), r->msgSize);
+		ring_barrier();
+		r->head = head + 1;
+		__sync_synchronize();
+		if (r->notFull.sleepers > 0 && r->tail - head == r->numOfSlots)
+			ring_doorbell(&(r->notFull));
+		return 1;
+	}
+
+	uint8* slot;
+	uint32 pos = r->head;
+	for (;;)
+	{
+		slot = ring_slot(r, pos);
+		int32 dif = (int32)(*ring_seq(slot) - (pos + 1));
+		if (dif == 0)
+		{
+			if (cmpxchg(&(r->head), pos, pos + 1) == pos)
+				break;
+			pos = r->head;
+		}
+		else if (dif < 0)
+			return 0;
+		else
+			pos = r->head;
+	}
+	ring_barrier();
+	ring_copy(msg, slot + sizeof(uint32), r->msgSize);
+	ring_barrier();
+	*ring_seq(slot) = pos + r->numOfSlots;
+	__sync_synchronize();
+	if (r->notFull.sleepers > 0)
+		ring_doorbell(&(r->notFull));
+	return 1;
+}
+
+//Same, blocking while the ring is full
+void ring_push(struct ring ring, const void* msg)
+{
+	while (!ring_try_push(ring, msg))
+		ring_wait(ring.ringdata, &(ring.ringdata->notFull), ring_full);
+}
+
+//Same, blocking while the ring is empty
+void ring_pop(struct ring ring, void* msg)
+{
+	while (!ring_try_pop(ring, msg))
+		ring_wait(ring.ringdata, &(ring.ringdata->notEmpty), ring_empty);
+}
+
+//# of messages in the ring (a snapshot, for stats)
+uint32 ring_count(struct ring ring)
+{
+	return ring.ringdata->tail - ring.ringdata->head;
+}
@@ -5,10 +5,10 @@ struct semaphore create_semaphore(char *semaphoreName, uint32 value)
 {
 #if 1
 	struct __semdata *semdata = smalloc(semaphoreName,sizeof(struct __semdata),1) ;
-	sys_init_queue(&(semdata->queue));
 	strcpy(semdata->name,semaphoreName);
 	semdata->count=value;
-	semdata->lock=0;
+	semdata->waiters=0;
+	semdata->directedYield=0;
 	return (struct semaphore) {
 		.semdata = semdata,
 	};
@@ -20,8 +20,7 @@ struct semaphore create_semaphore(char *semaphoreName, uint32 value)
 
 	/* semdata->count=value; */
 	/* strcpy(semdata->name,semaphoreName); */
-	/* semdata->lock=0; */
-	/* sys_init_queue(&(semdata->queue)); */
+	/* semdata->waiters=0; */
 	/* return *s; */
 #endif
 }
@@ -40,25 +39,42 @@ struct semaphore get_semaphore(int32 ownerEnvID, char* semaphoreName)
 
 void wait_semaphore(struct semaphore sem)
 {
-	while(xchg(&(sem.semdata->lock),1)!=0);
-	if(--(sem.semdata->count)<0)
+	struct __semdata* semdata = sem.semdata;
+	for (;;)
 	{
-		struct Env *env= sys_get_cpu_proc();
-		sem.semdata->lock=0;
-		sys_enqueue(&(sem.semdata->queue),env);
+		//fast path: take a unit of the count without entering the kernel
+		uint32 c = semdata->count;
+		if (c > 0)
+		{
+			if (cmpxchg(&(semdata->count), c, c - 1) == c)
+				return;
+			continue;
+		}
+		//block while it's still 0. A signal in between either sees this waiter, or changes the
+		//count before the kernel checks it (then sys_futex_wait() returns right away)
+		xadd(&(semdata->waiters), 1);
+		sys_futex_wait(&(semdata->count), 0);
+		xadd(&(semdata->waiters), -1);
 	}
-	sem.semdata->lock=0;
 }
 
 void signal_semaphore(struct semaphore sem)
 {
-	while(xchg(&(sem.semdata->lock),1)!=0);
-	if(++(sem.semdata->count)<=0)
+	struct __semdata* semdata = sem.semdata;
+	xadd(&(semdata->count), 1);
+	if (semdata->waiters > 0)
 	{
-		struct Env *env= sys_dequeue(&(sem.semdata->queue));		
-		sys_sched_insert_ready(env);
+		//donate the rest of the quantum to the woken env, instead of leaving it behind the ready ones
+		if (semdata->directedYield)
+			sys_futex_wake_yield(&(semdata->count));
+		else
+			sys_futex_wake(&(semdata->count), 1);
 	}
-	sem.semdata->lock=0;
+}
+
+void semaphore_set_directed_yield(struct semaphore sem, uint8 enabled)
+{
+	sem.semdata->directedYield = enabled;
 }
 
 int semaphore_count(struct semaphore sem)
@@ -140,6 +140,13 @@ int sys_freeSharedObject(int32 sharedObjectID, void *startVA)
 	return syscall(SYS_free_shared_object,(uint32) sharedObjectID, (uint32) startVA, 0, 0, 0);
 }
 
+//Map the given shared object at a free range of the user heap picked by the kernel, in a single
+//call. Returns its VA (& its size in *size), or NULL
+void* sys_attach_shared(int32 ownerID, char* shareName, uint32* size)
+{
+	return (void*) syscall(SYS_attach_shared,(uint32) ownerID, (uint32) shareName, (uint32) size, 0, 0);
+}
+
 int sys_create_env(char* programName, unsigned int page_WS_size,unsigned int LRU_second_list_size,unsigned int percent_WS_pages_to_remove)
 {
 	return syscall(SYS_create_env,(uint32)programName, (uint32)page_WS_size,(uint32)LRU_second_list_size, (uint32)percent_WS_pages_to_remove, 0);
@@ -325,32 +332,47 @@ uint32 sys_user_get_free_pages(volatile uint32 * env_page_directory,uint32 noOfP
 	return syscall(SYS_user_get_free_pages, (uint32)env_page_directory, noOfPages,0, 0, 0);
 }
 
-void sys_enqueue(struct Env_Queue* queue, struct Env* env)
+void sys_env_set_priority(int32 envId,int priority)
 {
-	syscall(SYS_enqueue, (uint32) queue,(uint32) env ,0, 0, 0);
+	syscall(SYS_env_set_priority,(uint32) envId,(uint32) priority ,0, 0, 0);
 }
 
-struct Env* sys_dequeue(struct Env_Queue* queue)
-{	
-	return (struct Env* ) syscall(SYS_dequeue, (uint32) queue,0 ,0, 0, 0);
+void sys_sleep(uint32 milliSeconds)
+{
+	syscall(SYS_sleep, milliSeconds, 0, 0, 0, 0);
 }
 
-void sys_init_queue(struct Env_Queue* queue)
-{	
-	syscall(SYS_init_queue, (uint32) queue,0 ,0, 0, 0);
+int sys_rt_set_params(uint32 periodInMS, uint32 budgetInMS)
+{
+	return syscall(SYS_rt_set_params, periodInMS, budgetInMS, 0, 0, 0);
 }
 
-struct Env* sys_get_cpu_proc()
-{	
-	return (struct Env* )syscall(SYS_get_current_proc,0 ,0 ,0, 0, 0);
+void sys_rt_wait_period()
+{
+	syscall(SYS_rt_wait_period, 0, 0, 0, 0, 0);
 }
 
-void sys_sched_insert_ready(struct Env* env)
-{	
-	syscall(SYS_insert_ready, (uint32) env,0 ,0, 0, 0);
+int sys_get_sched_stats(int32 envId, struct SchedStats* stats, struct EnvSchedStats* envStats)
+{
+	return syscall(SYS_get_sched_stats, (uint32) envId, (uint32) stats, (uint32) envStats, 0, 0);
 }
 
-void sys_env_set_priority(int32 envId,int priority)
+int sys_futex_wait(volatile uint32* addr, uint32 expected)
 {
-	syscall(SYS_env_set_priority,(uint32) envId,(uint32) priority ,0, 0, 0);
+	return syscall(SYS_futex_wait, (uint32) addr, expected, 0, 0, 0);
+}
+
+int sys_futex_wake(volatile uint32* addr, int n)
+{
+	return syscall(SYS_futex_wake, (uint32) addr, (uint32) n, 0, 0, 0);
+}
+
+int sys_futex_wake_yield(volatile uint32* addr)
+{
+	return syscall(SYS_futex_wake, (uint32) addr, 1, 1, 0, 0);
+}
+
+int sys_ring_doorbell(volatile uint32* bell, int n)
+{
+	return syscall(SYS_ring_doorbell, (uint32) bell, (uint32) n, 0, 0, 0);
 }
@@ -98,16 +98,9 @@ void* smalloc(char *sharedVarName, uint32 size, uint8 isWritable)
 //========================================
 void* sget(int32 ownerEnvID, char *sharedVarName)
 {
-	int size = sys_getSizeOfSharedObject(ownerEnvID, sharedVarName);
-	if(size == 0) return NULL;
-
-	void* ptr = malloc(size);
-	if (ptr == NULL) return NULL;
-
-	int ret = sys_getSharedObject(ownerEnvID, sharedVarName, ptr);
-	if (ret != E_SHARED_MEM_NOT_EXISTS) return ptr;
-	free(ptr);
-	return NULL;
+	//the kernel picks the range of the user heap & maps the whole object there
+	uint32 size = 0;
+	return sys_attach_shared(ownerEnvID, sharedVarName, &size);
 }
 
 //==================================================================================//
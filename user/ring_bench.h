@@ -0,0 +1,28 @@
+/*
+ * ring_bench.h
+ *
+ *  Shared by the master & the consumers of the ring buffers benchmark (tst_ring_master.c)
+ */
+
+#ifndef RING_BENCH_H_
+#define RING_BENCH_H_
+
+#define RING_BENCH_MSGS			(1 << 20)		//per run (a power of 2: the cycles/msg is a shift)
+#define RING_BENCH_SLOTS		1024
+#define RING_BENCH_CONSUMERS	2				//of the MPMC run
+#define RING_BENCH_STOP			0xFFFFFFFF		//seq of the last message to each consumer
+
+struct RingMsg
+{
+	uint32 seq;
+	uint32 value;
+};
+
+//Control block of a run (shared object "ringctl")
+struct RingBench
+{
+	uint8 kind;						//ring of the current run: RING_SPSC or RING_MPMC
+	volatile uint32 sum;			//of the values received by all the consumers
+	volatile uint32 errors;			//messages received out of order (SPSC)
+};
+#endif /* RING_BENCH_H_ */
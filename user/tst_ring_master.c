@@ -0,0 +1,57 @@
+// Benchmark of the ring buffers over shared memory (lib/ring.c): passes RING_BENCH_MSGS messages
+// through a SPSC ring (to 1 consumer) then a MPMC ring (to RING_BENCH_CONSUMERS consumers), & checks
+// that they all arrive (in order for SPSC)
+// Master program: create the rings, run the consumers, produce the messages & time them
+#include <inc/lib.h>
+#include <user/ring_bench.h>
+
+static uint32 run(struct RingBench* ctl, struct semaphore done, char* ringName, uint8 kind, int numOfConsumers)
+{
+	struct ring r = create_ring(ringName, RING_BENCH_SLOTS, sizeof(struct RingMsg), kind);
+	if (r.ringdata == NULL)
+		panic("tst_ring: failed to create the ring %s", ringName);
+	ctl->kind = kind;
+	ctl->sum = ctl->errors = 0;
+
+	for (int i = 0; i < numOfConsumers; i++)
+	{
+		int id = sys_create_env("ringSlave", (myEnv->page_WS_max_size), (myEnv->SecondListSize), (myEnv->percentage_of_WS_pages_to_be_removed));
+		sys_run_env(id);
+	}
+
+	uint32 sum = 0;
+	struct RingMsg msg;
+	uint64 start = read_tsc();
+	for (uint32 i = 0; i < RING_BENCH_MSGS; i++)
+	{
+		msg.seq = i;
+		msg.value = i * 2654435761u;
+		sum += msg.value;
+		ring_push(r, &msg);
+	}
+	msg.seq = RING_BENCH_STOP;
+	for (int i = 0; i < numOfConsumers; i++)
+		ring_push(r, &msg);
+	for (int i = 0; i < numOfConsumers; i++)
+		wait_semaphore(done);
+	uint64 cycles = read_tsc() - start;
+
+	if (ctl->sum != sum || ctl->errors != 0)
+		panic("tst_ring: %s lost or reordered messages (sum = %x, expected = %x, out of order = %d)", ringName, ctl->sum, sum, ctl->errors);
+	return (uint32)(cycles >> 20);
+}
+
+void
+_main(void)
+{
+	struct RingBench* ctl = smalloc("ringctl", sizeof(struct RingBench), 1);
+	struct semaphore done = create_semaphore("ringdone", 0);
+
+	uint32 spsc = run(ctl, done, "spsc", RING_SPSC, 1);
+	cprintf("SPSC ring: %d msgs, %d cycles/msg (TSC)\n", RING_BENCH_MSGS, spsc);
+	uint32 mpmc = run(ctl, done, "mpmc", RING_MPMC, RING_BENCH_CONSUMERS);
+	cprintf("MPMC ring: %d msgs to %d consumers, %d cycles/msg (TSC)\n", RING_BENCH_MSGS, RING_BENCH_CONSUMERS, mpmc);
+
+	cprintf("Congratulations!! Test of the ring buffers completed successfully!!\n\n\n");
+	return;
+}
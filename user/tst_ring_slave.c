@@ -0,0 +1,32 @@
+// Benchmark of the ring buffers over shared memory (lib/ring.c)
+// Slave program: consume the messages of the current run till its stop message
+#include <inc/lib.h>
+#include <user/ring_bench.h>
+
+void
+_main(void)
+{
+	int32 parentenvID = sys_getparentenvid();
+
+	struct RingBench* ctl = sget(parentenvID, "ringctl");
+	struct semaphore done = get_semaphore(parentenvID, "ringdone");
+	uint8 kind = ctl->kind;
+	struct ring r = get_ring(parentenvID, kind == RING_SPSC ? "spsc" : "mpmc");
+
+	uint32 sum = 0, next = 0, errors = 0;
+	struct RingMsg msg;
+	for (;;)
+	{
+		ring_pop(r, &msg);
+		if (msg.seq == RING_BENCH_STOP)
+			break;
+		if (kind == RING_SPSC && msg.seq != next++)
+			errors++;
+		sum += msg.value;
+	}
+	xadd(&(ctl->sum), sum);
+	xadd(&(ctl->errors), errors);
+
+	signal_semaphore(done);
+	return;
+}